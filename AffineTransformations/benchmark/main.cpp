@@ -0,0 +1,253 @@
+/*******************************************************************************************************
+ main.cpp
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2014 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2014 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2014 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkSkewEstimator.h"
+#include "DkImageStorage.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+
+namespace nmp {
+
+/**
+*	Errors & timings of one estimation mode.
+**/
+class DkSkewBenchmarkResult {
+
+public:
+	QString mode;
+	QVector<double> errors;		// |estimated - applied| in degree
+	QVector<double> latencies;	// ms
+
+	QJsonObject toJson() const;
+	static double percentile(QVector<double> vals, double p);
+	static double mean(const QVector<double>& vals);
+};
+
+double DkSkewBenchmarkResult::percentile(QVector<double> vals, double p) {
+
+	if (vals.empty())
+		return 0.0;
+
+	std::sort(vals.begin(), vals.end());
+	int idx = qBound(0, (int)std::ceil(p * vals.size()) - 1, vals.size() - 1);
+
+	return vals[idx];
+}
+
+double DkSkewBenchmarkResult::mean(const QVector<double>& vals) {
+
+	if (vals.empty())
+		return 0.0;
+
+	double sum = 0;
+	for (double v : vals)
+		sum += v;
+
+	return sum / vals.size();
+}
+
+QJsonObject DkSkewBenchmarkResult::toJson() const {
+
+	QJsonObject err;
+	err["mean"] = mean(errors);
+	err["p95"] = percentile(errors, 0.95);
+	err["max"] = percentile(errors, 1.0);
+
+	QJsonObject lat;
+	lat["mean"] = mean(latencies);
+	lat["p95"] = percentile(latencies, 0.95);
+
+	QJsonObject o;
+	o["mode"] = mode;
+	o["errorDeg"] = err;
+	o["latencyMs"] = lat;
+
+	return o;
+}
+
+QStringList collectImages(const QStringList& paths) {
+
+	QStringList filters;
+	for (const QByteArray& f : QImageReader::supportedImageFormats())
+		filters << "*." + QString::fromLatin1(f);
+
+	QStringList files;
+
+	for (const QString& p : paths) {
+
+		QFileInfo fi(p);
+
+		if (fi.isDir()) {
+			QStringList dirFiles;
+			QDirIterator it(fi.absoluteFilePath(), filters, QDir::Files);
+
+			while (it.hasNext())
+				dirFiles << it.next();
+
+			dirFiles.sort();
+			files << dirFiles;
+		}
+		else if (fi.isFile())
+			files << fi.absoluteFilePath();
+	}
+
+	return files;
+}
+
+};
+
+/**
+*	Rotates deskewed document images by known angles and compares the
+*	full resolution estimation with the proxy estimation.
+**/
+int main(int argc, char** argv) {
+
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("skewBenchmark");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmarks the skew estimation (full resolution vs. proxy) on deskewed document images that are rotated by known angles.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("paths", "Deskewed images or directories.", "[paths...]");
+
+	QCommandLineOption anglesOpt(QStringList() << "a" << "angles", "Comma separated list of angles in degree.", "angles", "-5,-2.5,-1,-0.3,0.3,1,2.5,5");
+	QCommandLineOption proxyOpt(QStringList() << "p" << "proxy", "Long side of the proxy in px.", "px", "1500");
+	QCommandLineOption outputOpt(QStringList() << "o" << "output", "JSON output file (default: stdout).", "file");
+	parser.addOption(anglesOpt);
+	parser.addOption(proxyOpt);
+	parser.addOption(outputOpt);
+	parser.process(app);
+
+	QStringList files = nmp::collectImages(parser.positionalArguments());
+
+	if (files.isEmpty()) {
+		qWarning() << "no images found";
+		parser.showHelp(1);
+	}
+
+	QVector<double> angles;
+	for (const QString& a : parser.value(anglesOpt).split(",", QString::SkipEmptyParts))
+		angles << a.toDouble();
+
+	QVector<nmp::DkSkewBenchmarkResult> results(2);
+	results[0].mode = "full";
+	results[1].mode = "proxy";
+
+	QVector<double> agreement;	// |proxy - full|
+	QJsonArray samples;
+
+	for (const QString& filePath : files) {
+
+		QImage img(filePath);
+
+		if (img.isNull()) {
+			qWarning() << "could not load" << filePath;
+			continue;
+		}
+
+		cv::Mat mImg = nmc::DkImage::qImage2Mat(img);
+		cv::Point2f center(mImg.cols * 0.5f, mImg.rows * 0.5f);
+
+		for (double a : angles) {
+
+			// opencv rotates counter-clockwise - the estimator should return a
+			cv::Mat rImg;
+			cv::warpAffine(mImg, rImg, cv::getRotationMatrix2D(center, a, 1.0), mImg.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(255));
+
+			double est[2];
+
+			for (int mIdx = 0; mIdx < results.size(); mIdx++) {
+
+				nmp::DkSkewEstimator skewEstimator;
+				skewEstimator.setProxySize(mIdx == 1 ? parser.value(proxyOpt).toInt() : 0);
+
+				QElapsedTimer dt;
+				dt.start();
+				est[mIdx] = skewEstimator.compute(rImg).angle;
+
+				results[mIdx].latencies << dt.nsecsElapsed() / 1e6;
+				results[mIdx].errors << qAbs(est[mIdx] - a);
+			}
+
+			agreement << qAbs(est[1] - est[0]);
+
+			QJsonObject s;
+			s["file"] = QFileInfo(filePath).fileName();
+			s["angle"] = a;
+			s["full"] = est[0];
+			s["proxy"] = est[1];
+			samples.append(s);
+		}
+	}
+
+	QJsonArray modes;
+	for (const nmp::DkSkewBenchmarkResult& r : results)
+		modes.append(r.toJson());
+
+	QJsonObject agree;
+	agree["mean"] = nmp::DkSkewBenchmarkResult::mean(agreement);
+	agree["p95"] = nmp::DkSkewBenchmarkResult::percentile(agreement, 0.95);
+	agree["max"] = nmp::DkSkewBenchmarkResult::percentile(agreement, 1.0);
+
+	QJsonObject report;
+	report["numImages"] = files.size();
+	report["proxySize"] = parser.value(proxyOpt).toInt();
+	report["modes"] = modes;
+	report["proxyVsFullDeg"] = agree;
+	report["samples"] = samples;
+
+	QByteArray json = QJsonDocument(report).toJson();
+
+	if (parser.isSet(outputOpt)) {
+
+		QFile file(parser.value(outputOpt));
+		if (!file.open(QIODevice::WriteOnly)) {
+			qWarning() << "could not write to" << parser.value(outputOpt);
+			return 1;
+		}
+		file.write(json);
+	}
+	else
+		QTextStream(stdout) << json;
+
+	return 0;
+}
@@ -0,0 +1,250 @@
+/*******************************************************************************************************
+ DkAffineResampler.cpp
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2014 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2014 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2014 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkAffineResampler.h"
+
+#include <QAtomicInt>
+#include <QStringList>
+#include <QtCore/qmath.h>
+
+#include <cfloat>
+#include <climits>
+
+namespace nmp {
+
+/*-----------------------------------DkWarpKernel ---------------------------------------------*/
+
+/**
+*	Resamples bands of destination rows.
+*	Every band reads the source's bounding box of its footprint only. Hence, OpenCV's 
+*	short map coordinates do not overflow as long as a footprint is smaller than SHRT_MAX.
+**/
+class DkWarpKernel : public cv::ParallelLoopBody {
+
+public:
+	DkWarpKernel(const cv::Mat& src, cv::Mat& dst, const cv::Mat& invMap, int bandHeight, int interpolation, const cv::Scalar& bgVal, QAtomicInt* overflow) :
+		src(src), dst(dst), invMap(invMap), bandHeight(bandHeight), interpolation(interpolation), bgVal(bgVal), overflow(overflow) {}
+
+	void operator()(const cv::Range& range) const override {
+
+		// the kernel's support (Lanczos4 needs 4 pixels on either side)
+		const int margin = 5;
+
+		for (int bIdx = range.start; bIdx < range.end; bIdx++) {
+
+			// the result is dropped anyway
+			if (overflow->load())
+				return;
+
+			int y0 = bIdx * bandHeight;
+			int y1 = qMin(y0 + bandHeight, dst.rows);
+			cv::Mat band = dst.rowRange(y0, y1);
+
+			// shift the map to the band's first row
+			cv::Mat m = invMap.clone();
+			m.at<double>(0, 2) += m.at<double>(0, 1) * y0;
+			m.at<double>(1, 2) += m.at<double>(1, 1) * y0;
+
+			// source footprint of the band
+			double xMin = DBL_MAX, yMin = DBL_MAX, xMax = -DBL_MAX, yMax = -DBL_MAX;
+			double cx[4] = {0.0, (double)band.cols, 0.0, (double)band.cols};
+			double cy[4] = {0.0, 0.0, (double)band.rows, (double)band.rows};
+
+			for (int cIdx = 0; cIdx < 4; cIdx++) {
+				double sx = m.at<double>(0, 0) * cx[cIdx] + m.at<double>(0, 1) * cy[cIdx] + m.at<double>(0, 2);
+				double sy = m.at<double>(1, 0) * cx[cIdx] + m.at<double>(1, 1) * cy[cIdx] + m.at<double>(1, 2);
+				xMin = qMin(xMin, sx); xMax = qMax(xMax, sx);
+				yMin = qMin(yMin, sy); yMax = qMax(yMax, sy);
+			}
+
+			cv::Rect roi(cv::Point(qFloor(qMax(xMin, -1.0)) - margin, qFloor(qMax(yMin, -1.0)) - margin), 
+						 cv::Point(qCeil(qMin(xMax, (double)src.cols)) + margin, qCeil(qMin(yMax, (double)src.rows)) + margin));
+			roi &= cv::Rect(0, 0, src.cols, src.rows);
+
+			if (roi.width <= 0 || roi.height <= 0) {
+				band.setTo(bgVal);
+				continue;
+			}
+
+			if (roi.width >= SHRT_MAX || roi.height >= SHRT_MAX) {
+				overflow->store(1);	// bands run in parallel
+				continue;
+			}
+
+			m.at<double>(0, 2) -= roi.x;
+			m.at<double>(1, 2) -= roi.y;
+
+			cv::warpAffine(src(roi), band, m, band.size(), interpolation | cv::WARP_INVERSE_MAP, cv::BORDER_CONSTANT, bgVal);
+		}
+	}
+
+protected:
+	const cv::Mat& src;
+	cv::Mat& dst;
+	const cv::Mat& invMap;
+	int bandHeight;
+	int interpolation;
+	cv::Scalar bgVal;
+	QAtomicInt* overflow;
+};
+
+/*-----------------------------------DkAffineResampler ---------------------------------------------*/
+
+/**
+*	Constructor
+*	@param interpolation the interpolation (Interpolation)
+*	@param bgCol the color of pixels that are not covered by the source image
+**/
+DkAffineResampler::DkAffineResampler(int interpolation, const QColor& bgCol) {
+
+	this->interpolation = interpolation;
+	this->bgCol = bgCol;
+	bandHeight = 64;
+}
+
+void DkAffineResampler::setInterpolation(int interpolation) {
+
+	this->interpolation = interpolation;
+}
+
+void DkAffineResampler::setBackground(const QColor& bgCol) {
+
+	this->bgCol = bgCol;
+}
+
+QStringList DkAffineResampler::interpolationNames() {
+
+	QStringList names;
+	names << QT_TRANSLATE_NOOP("nmp::DkAffineResampler", "Nearest Neighbor") <<
+			 QT_TRANSLATE_NOOP("nmp::DkAffineResampler", "Bilinear") <<
+			 QT_TRANSLATE_NOOP("nmp::DkAffineResampler", "Bicubic") <<
+			 QT_TRANSLATE_NOOP("nmp::DkAffineResampler", "Lanczos");
+
+	return names;
+}
+
+/**
+*	Resamples img.
+*	The transform follows QPainter's convention (pixel centers are at +0.5).
+*	@param img the source image
+*	@param t the transform from source to destination coordinates
+*	@param dstRect the destination rect (in destination coordinates) that is computed
+*	@return the resampled image (dstRect.size()) in the source's format or a null image if it cannot be resampled
+**/
+QImage DkAffineResampler::warp(const QImage& img, const QTransform& t, const QRect& dstRect) const {
+
+	if (img.isNull() || dstRect.isEmpty() || !t.isInvertible() || t.isProjective())
+		return QImage();
+
+	if (!isSupported(img)) {
+
+		QImage src = img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+		QImage dst = warp(src, t, dstRect);
+
+		if (dst.isNull())
+			return dst;
+
+		if (img.format() == QImage::Format_Indexed8)
+			return dst.convertToFormat(img.format(), img.colorTable());
+
+		return dst.convertToFormat(img.format());
+	}
+
+	// destination pixel centers -> source pixel centers
+	QTransform inv = QTransform::fromTranslate(dstRect.x() + 0.5, dstRect.y() + 0.5) * t.inverted() * QTransform::fromTranslate(-0.5, -0.5);
+
+	cv::Mat invMap = (cv::Mat_<double>(2, 3) <<	inv.m11(), inv.m21(), inv.dx(),
+												inv.m12(), inv.m22(), inv.dy());
+
+	QImage dstImg(dstRect.size(), img.format());
+	dstImg.setDotsPerMeterX(img.dotsPerMeterX());
+	dstImg.setDotsPerMeterY(img.dotsPerMeterY());
+
+	cv::Mat src(img.height(), img.width(), cvType(img), (void*)img.constBits(), img.bytesPerLine());
+	cv::Mat dst(dstImg.height(), dstImg.width(), cvType(dstImg), dstImg.bits(), dstImg.bytesPerLine());
+
+	QAtomicInt overflow(0);
+	int numBands = (dst.rows + bandHeight - 1) / bandHeight;
+
+	cv::parallel_for_(cv::Range(0, numBands), DkWarpKernel(src, dst, invMap, bandHeight, cvInterpolation(), bgValue(img), &overflow));
+
+	if (overflow.load())
+		return QImage();
+
+	return dstImg;
+}
+
+bool DkAffineResampler::isSupported(const QImage& img) {
+
+	return cvType(img) != -1;
+}
+
+int DkAffineResampler::cvType(const QImage& img) {
+
+	switch (img.format()) {
+	case QImage::Format_RGB32:
+	case QImage::Format_ARGB32_Premultiplied:
+		return CV_8UC4;
+	case QImage::Format_RGB888:
+		return CV_8UC3;
+	case QImage::Format_Grayscale8:
+		return CV_8UC1;
+	default:
+		return -1;
+	}
+}
+
+/**
+*	Returns the background color in the image's memory layout.
+**/
+cv::Scalar DkAffineResampler::bgValue(const QImage& img) const {
+
+	switch (img.format()) {
+	case QImage::Format_RGB32:
+		return cv::Scalar(bgCol.blue(), bgCol.green(), bgCol.red(), 255);
+	case QImage::Format_ARGB32_Premultiplied: {
+		QRgb p = qPremultiply(bgCol.rgba());
+		return cv::Scalar(qBlue(p), qGreen(p), qRed(p), qAlpha(p));
+	}
+	case QImage::Format_RGB888:
+		return cv::Scalar(bgCol.red(), bgCol.green(), bgCol.blue());
+	default:
+		return cv::Scalar::all(qGray(bgCol.rgb()));
+	}
+}
+
+int DkAffineResampler::cvInterpolation() const {
+
+	switch (interpolation) {
+	case interpolation_nearest:		return cv::INTER_NEAREST;
+	case interpolation_bicubic:		return cv::INTER_CUBIC;
+	case interpolation_lanczos:		return cv::INTER_LANCZOS4;
+	default:						return cv::INTER_LINEAR;
+	}
+}
+
+};
@@ -0,0 +1,89 @@
+/*******************************************************************************************************
+ DkAffineResampler.h
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2014 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2014 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2014 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#include <QColor>
+#include <QImage>
+#include <QRect>
+#include <QStringList>
+#include <QTransform>
+
+// opencv
+#ifdef WITH_OPENCV
+
+#ifdef WIN32
+#pragma warning(disable: 4996)
+#endif
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#endif
+
+namespace nmp {
+
+/**
+*	Affine resampling engine.
+*	Only the requested destination rect is computed. Its rows are split into bands which are
+*	resampled in parallel - each band only reads the part of the source it maps to.
+*	8 bit gray, RGB888 and 32 bit images are resampled in their format, all other formats are
+*	converted to ARGB32_Premultiplied and back.
+**/
+class DkAffineResampler {
+
+public:
+	enum Interpolation {
+		interpolation_nearest = 0,
+		interpolation_bilinear,
+		interpolation_bicubic,
+		interpolation_lanczos,
+
+		interpolation_end
+	};
+
+	DkAffineResampler(int interpolation = interpolation_bilinear, const QColor& bgCol = Qt::white);
+
+	void setInterpolation(int interpolation);
+	void setBackground(const QColor& bgCol);
+
+	QImage warp(const QImage& img, const QTransform& t, const QRect& dstRect) const;
+
+	static QStringList interpolationNames();
+	static bool isSupported(const QImage& img);
+
+protected:
+	static int cvType(const QImage& img);
+	cv::Scalar bgValue(const QImage& img) const;
+	int cvInterpolation() const;
+
+	int interpolation;
+	QColor bgCol;
+	int bandHeight;		// rows of a band
+};
+
+};
@@ -26,13 +26,26 @@
  *******************************************************************************************************/
 
 #include "DkImgTransformationsPlugin.h"
+#include "DkSkewBatch.h"
 
 #include "DkSettings.h"
 #include "DkMath.h"
 #include "DkBaseViewPort.h"
 #include "DkUtils.h"
+#include "DkImageStorage.h"
+#include "DkImageContainer.h"
 
 #include <QMouseEvent>
+#include <QDebug>
+#include <QDir>
+#include <QEventLoop>
+#include <QFileDialog>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QProgressDialog>
+#include <QTimer>
+#include <QUuid>
+#include <QtConcurrentRun>
 
 #define PI 3.14159265
 
@@ -45,6 +58,12 @@ namespace nmp {
 **/
 DkImgTransformationsPlugin::DkImgTransformationsPlugin() {
 
+	QVector<QString> runIds;
+	runIds.resize(id_end);
+
+	for (int idx = 0; idx < id_end; idx++)
+		runIds[idx] = QUuid::createUuid().toString();
+	mRunIDs = runIds.toList();
 }
 
 /**
@@ -85,6 +104,19 @@ QSharedPointer<nmc::DkImageContainer> DkImgTransformationsPlugin::runPlugin(cons
 
 		return imgC;
 	}
+	// batch: estimate the skew and rotate the image accordingly
+	else if (imgC && runID == mRunIDs[id_deskew]) {
+
+		imgC->setImage(DkImgTransformationsViewPort::deskewImage(imgC->image()), tr("Deskewed"));
+	}
+	// batch: apply the composed transform (scale, rotation & shear) that was applied last
+	else if (imgC && runID == mRunIDs[id_transform]) {
+
+		QImage img = DkImgTransformationsViewPort::transformImageFromSettings(imgC->image());
+
+		if (!img.isNull())
+			imgC->setImage(img, tr("Transformed"));
+	}
 
 	return imgC;
 };
@@ -135,6 +167,7 @@ void DkImgTransformationsViewPort::init() {
     guideMode = settings.value("guideMode", guide_no_guide).toInt();
 	rotCropEnabled = (settings.value("cropEnabled", Qt::Unchecked).toInt() == Qt::Checked);
 	angleLinesEnabled = (settings.value("angleLines", Qt::Checked).toInt() == Qt::Checked);
+	interpolation = settings.value("interpolation", DkAffineResampler::interpolation_bilinear).toInt();
     settings.endGroup();
 
 	selectedMode = defaultMode;
@@ -152,13 +185,18 @@ void DkImgTransformationsViewPort::init() {
 	rotationCenter = QPoint();
 
 	intrRect = new DkInteractionRects(this);
-	skewEstimator = DkSkewEstimator(this);
+	skewResult = DkSkewResult();
+	interacting = false;
+
+	preview = new DkTransformPreview(this);
+	connect(preview, SIGNAL(renderFinished()), this, SLOT(update()));
 
 	imgTransformationsToolbar = new DkImgTransformationsToolBar(tr("ImgTransformations Toolbar"), defaultMode, this);
 
 	imgTransformationsToolbar->setCropState((rotCropEnabled) ? Qt::Checked : Qt::Unchecked);
 	imgTransformationsToolbar->setGuideLineState(guideMode);
 	imgTransformationsToolbar->setAngleLineState((angleLinesEnabled) ? Qt::Checked : Qt::Unchecked);
+	imgTransformationsToolbar->setInterpolationState(interpolation);
 
 	connect(imgTransformationsToolbar, SIGNAL(scaleXValSignal(double)), this, SLOT(setScaleXValue(double)));
 	connect(imgTransformationsToolbar, SIGNAL(scaleYValSignal(double)), this, SLOT(setScaleYValue(double)));
@@ -166,10 +204,13 @@ void DkImgTransformationsViewPort::init() {
 	connect(imgTransformationsToolbar, SIGNAL(shearYValSignal(double)), this, SLOT(setShearYValue(double)));
 	connect(imgTransformationsToolbar, SIGNAL(rotationValSignal(double)), this, SLOT(setRotationValue(double)));
 	connect(imgTransformationsToolbar, SIGNAL(calculateAutoRotationSignal()), this, SLOT(calculateAutoRotation()));
+	connect(imgTransformationsToolbar, SIGNAL(deskewFolderSignal()), this, SLOT(deskewFolder()));
+	connect(imgTransformationsToolbar, SIGNAL(transformFolderSignal()), this, SLOT(transformFolder()));
 	connect(imgTransformationsToolbar, SIGNAL(cropEnabledSignal(bool)), this, SLOT(setCropEnabled(bool)));
 	connect(imgTransformationsToolbar, SIGNAL(showLinesSignal(bool)), this, SLOT(	setAngleLinesEnabled(bool)));
 	connect(imgTransformationsToolbar, SIGNAL(modeChangedSignal(int)), this, SLOT(setMode(int)));
 	connect(imgTransformationsToolbar, SIGNAL(guideStyleSignal(int)), this, SLOT(setGuideStyle(int)));
+	connect(imgTransformationsToolbar, SIGNAL(interpolationSignal(int)), this, SLOT(setInterpolation(int)));
 	connect(imgTransformationsToolbar, SIGNAL(panSignal(bool)), this, SLOT(setPanning(bool)));
 	connect(imgTransformationsToolbar, SIGNAL(cancelSignal()), this, SLOT(discardChangesAndClose()));
 	connect(imgTransformationsToolbar, SIGNAL(applySignal()), this, SLOT(applyChangesAndClose()));
@@ -204,6 +245,7 @@ void DkImgTransformationsViewPort::mousePressEvent(QMouseEvent *event) {
 			if (rects.at(currIdx).contains(map(event->pos()))) {
 				intrIdx = currIdx;
 				insideIntrRect = true;
+				interacting = true;
 				break;
 			}
 		}
@@ -216,6 +258,7 @@ void DkImgTransformationsViewPort::mousePressEvent(QMouseEvent *event) {
 
 			referencePoint = map(event->pos());
 			rotationValueTemp = rotationValue;
+			interacting = true;
 		}
 	}
 	else if (selectedMode == mode_shear) {
@@ -236,6 +279,7 @@ void DkImgTransformationsViewPort::mousePressEvent(QMouseEvent *event) {
 
 			referencePoint = map(event->pos());
 			shearValuesTemp = shearValues;
+			interacting = true;
 		}
 	}
 	// no propagation
@@ -346,6 +390,12 @@ void DkImgTransformationsViewPort::mouseReleaseEvent(QMouseEvent *event) {
 	insideIntrRect = false;
 	intrIdx = 100;
 
+	// render the full quality preview
+	if (interacting) {
+		interacting = false;
+		update();
+	}
+
 	// panning -> redirect to mViewport
 	if (event->modifiers() == nmc::DkSettingsManager::param().global().altMod || panning) {
 		setCursor(defaultCursor);
@@ -357,22 +407,22 @@ void DkImgTransformationsViewPort::mouseReleaseEvent(QMouseEvent *event) {
 
 void DkImgTransformationsViewPort::paintEvent(QPaintEvent *event) {
 
-	QImage inImage = QImage();
 	QRect imgRect = QRect();
 
 	if(parent()) {
 		nmc::DkBaseViewPort* mViewport = dynamic_cast<nmc::DkBaseViewPort*>(parent());
 		if (mViewport) {
 
-			imgRect = mViewport->getImage().rect();
-			inImage = QImage(mViewport->getImage());
+			QImage img = mViewport->getImage();
+
+			// we only draw the preview - it is rebuilt if the image changed
+			if (img.cacheKey() != preview->cacheKey())
+				preview->setImage(img);
 
+			imgRect = img.rect();
 		}
 	}
 
-	QRect imgRectT = imgRect;
-	QTransform affineTransform = QTransform();
-
 	QPainter painter(this);
 
 	painter.fillRect(this->rect(), nmc::DkSettingsManager::param().display().bgColor);
@@ -381,46 +431,21 @@ void DkImgTransformationsViewPort::paintEvent(QPaintEvent *event) {
 	if (mWorldMatrix)
 		painter.setWorldTransform((*mImgMatrix) * (*mWorldMatrix));
 
-	if (selectedMode == mode_scale) {
-		painter.save();
-
-		imgRectT.setSize(QSize(imgRectT.width()*scaleValues.x(),imgRectT.height()*scaleValues.y()));
-		imgRectT.translate(imgRectT.width()*0.5 *(1-scaleValues.x()) * (1/scaleValues.x()),imgRectT.height()*0.5*(1-scaleValues.y())*(1/scaleValues.y()));
-
-		affineTransform.scale(scaleValues.x(),scaleValues.y());
-		affineTransform.translate(inImage.width()*0.5 *(1-scaleValues.x()) * (1/scaleValues.x()),inImage.height()*0.5*(1-scaleValues.y())*(1/scaleValues.y()));
-	}
-	else if (selectedMode == mode_rotate) {
-		painter.save();
-
-		double diag = qSqrt(inImage.height()*inImage.height()+inImage.width()*inImage.width());
-		double initAngle = qAcos(inImage.width()/diag) * 180 / PI;	
-		affineTransform.translate(0.5* inImage.width() - diag*0.5*qCos((initAngle+rotationValue) * PI / 180.0), 0.5* inImage.height() - diag*0.5*qSin((initAngle+rotationValue) * PI / 180.0));
-		affineTransform.rotate(rotationValue);
-
-		painter.fillRect(affineTransform.mapRect(inImage.rect()), Qt::white);
-		imgRectT = affineTransform.mapRect(inImage.rect());
-	}
-	else if (selectedMode == mode_shear) {
-
-		affineTransform.shear(shearValues.x(), shearValues.y());
+	painter.save();
 
-		QRect transfRect = affineTransform.mapRect(inImage.rect());
-		int signX = (shearValues.x() < 0) ? -1 : 1;
-		int signY = (shearValues.y() < 0) ? -1 : 1;
+	// scale, rotation & shear are composed around the image's center
+	QTransform affineTransform = QTransform::fromTranslate(-0.5*imgRect.width(), -0.5*imgRect.height()) * 
+		composeTransform(scaleValues, rotationValue, shearValues) * 
+		QTransform::fromTranslate(0.5*imgRect.width(), 0.5*imgRect.height());
 
-		affineTransform.reset();
-		affineTransform.translate(signX*(inImage.width()/2-transfRect.width()/2), signY*(inImage.height()/2-transfRect.height()/2));
-		affineTransform.shear(shearValues.x(),shearValues.y());
+	QRect imgRectT = affineTransform.mapRect(imgRect);
+	painter.fillRect(imgRectT, Qt::white);
 
-		painter.fillRect(affineTransform.mapRect(inImage.rect()), Qt::white);
-	}
-	
 	affineTransform *= painter.transform();
 	
 	painter.setTransform(affineTransform);
 
-	painter.drawImage(inImage.rect(), inImage);
+	preview->draw(&painter, interacting);
 	
 	drawGuide(&painter, QPolygonF(QRectF(imgRect)), guideMode);
 	painter.drawRect(imgRect);
@@ -438,8 +463,8 @@ void DkImgTransformationsViewPort::paintEvent(QPaintEvent *event) {
 			hCAlpha.setAlpha(200);
 
 			//QPen linePen(Qt::red, qCeil(3.0 * imgRect.width() / 1000.0), Qt::SolidLine);
-			QVector<QVector4D> lines = skewEstimator.getLines();
-			QVector<int> lineTypes = skewEstimator.getLineTypes();
+			QVector<QVector4D> lines = skewResult.lines;
+			QVector<int> lineTypes = skewResult.lineTypes;
 			for (int i = 0; i < lines.size(); i++) {
 				(lineTypes.at(i)) ? linePen.setColor(nmc::DkSettingsManager::param().display().highlightColor) : linePen.setColor(hCAlpha);
 				painter.setPen(linePen);
@@ -448,27 +473,26 @@ void DkImgTransformationsViewPort::paintEvent(QPaintEvent *event) {
 		}
 
 		painter.restore();
-		if (rotCropEnabled) {
-			QSize cropSize = QSize();
+	}
+	else
+		painter.restore();
 
-			double newHeight = - ((double)(inImage.height()) - (double) (inImage.width()) * qAbs(qTan(rotationValue * PI /180))) / (qAbs(qTan(rotationValue * PI /180))*qAbs(qSin(rotationValue * PI /180))-qAbs(qCos(rotationValue * PI /180)));
-			cropSize = QSize(((double) (inImage.width())-newHeight*qAbs(qSin(rotationValue * PI /180)))/qAbs(qCos(rotationValue * PI /180)) , newHeight);
-			QRect cropRect = QRect(QPoint(rotationCenter.x()-0.5*cropSize.width(),rotationCenter.y()-0.5*cropSize.height()),cropSize);
+	// the crop is applied to the composed transform
+	if (rotCropEnabled) {
+		QSize cropSize = DkImgTransformationsViewPort::cropSize(imgRect.size(), composeTransform(scaleValues, rotationValue, shearValues)).toSize();
+		QRect cropRect = QRect(QPoint(rotationCenter.x()-0.5*cropSize.width(),rotationCenter.y()-0.5*cropSize.height()),cropSize);
 		
-			if (cropSize.width() <= qSqrt(inImage.height()*inImage.height()+inImage.width()*inImage.width()) && cropSize.height() <= qSqrt(inImage.height()*inImage.height()+inImage.width()*inImage.width())) {
+		if (!cropSize.isEmpty() && cropSize != imgRectT.size()) {
 				
-				QBrush cropBrush = QBrush(QColor(128, 128, 128, 200));
-				painter.fillRect(imgRectT.left(), imgRectT.top(), imgRectT.width(), -imgRectT.top()+cropRect.top(), cropBrush);
-				painter.fillRect(imgRectT.left(), cropRect.bottom()+1, imgRectT.width(), -cropRect.bottom()+imgRectT.bottom(), cropBrush);
-				painter.fillRect(imgRectT.left(), cropRect.top(), cropRect.left()-imgRectT.left(), cropRect.height(), cropBrush);
-				painter.fillRect(cropRect.right()+1, cropRect.top(), -cropRect.right()+imgRectT.right(), cropRect.height(), cropBrush);
-
-				painter.drawRect(cropRect);
+			QBrush cropBrush = QBrush(QColor(128, 128, 128, 200));
+			painter.fillRect(imgRectT.left(), imgRectT.top(), imgRectT.width(), -imgRectT.top()+cropRect.top(), cropBrush);
+			painter.fillRect(imgRectT.left(), cropRect.bottom()+1, imgRectT.width(), -cropRect.bottom()+imgRectT.bottom(), cropBrush);
+			painter.fillRect(imgRectT.left(), cropRect.top(), cropRect.left()-imgRectT.left(), cropRect.height(), cropBrush);
+			painter.fillRect(cropRect.right()+1, cropRect.top(), -cropRect.right()+imgRectT.right(), cropRect.height(), cropBrush);
 
-			}
+			painter.drawRect(cropRect);
 		}
 	}
-	
 
 	painter.end();
 
@@ -535,86 +559,200 @@ QImage DkImgTransformationsViewPort::getTransformedImage() {
 		nmc::DkBaseViewPort* mViewport = dynamic_cast<nmc::DkBaseViewPort*>(parent());
 		if (mViewport) {
 
-			QImage inImage = mViewport->getImage();
-			QTransform affineTransform = QTransform();
-			
-			if (selectedMode == mode_scale) {
+			// scale, rotation & shear are resampled at once
+			QTransform linearTransform = composeTransform(scaleValues, rotationValue, shearValues);
 
-				affineTransform.scale(scaleValues.x(),scaleValues.y());
+			return applyTransform(mViewport->getImage(), linearTransform, rotCropEnabled, interpolation);
+		}
+	}
 
-				QImage paintedImage = QImage(affineTransform.mapRect(inImage.rect()).size(), inImage.format());
-				QPainter imagePainter(&paintedImage);
-				imagePainter.setRenderHints(QPainter::SmoothPixmapTransform | QPainter::Antialiasing);
-				imagePainter.setTransform(affineTransform);
-				imagePainter.drawImage(QPoint(0,0), inImage);
-				imagePainter.end();
+	return QImage();
+}
 
-				return paintedImage;
-			}
-			else if (selectedMode == mode_rotate) {			
-			
-				double diag = qSqrt(inImage.height()*inImage.height()+inImage.width()*inImage.width());
-				double initAngle = qAcos(inImage.width()/diag) * 180 / PI;	
-				affineTransform.translate(0.5* inImage.width() - diag*0.5*qCos((initAngle+rotationValue) * PI / 180.0), 0.5* inImage.height() - diag*0.5*qSin((initAngle+rotationValue) * PI / 180.0));
-				affineTransform.rotate(rotationValue);
-				affineTransform.translate(-inImage.width()/2, -inImage.height()/2); 
-
-				QImage paintedImage = QImage(affineTransform.mapRect(inImage.rect()).size(), inImage.format());
-				QPainter imagePainter(&paintedImage);
-				imagePainter.setRenderHints(QPainter::SmoothPixmapTransform | QPainter::Antialiasing);
-				imagePainter.fillRect(paintedImage.rect(), Qt::white);		
-				affineTransform.reset();
-				affineTransform.translate(paintedImage.width()/2, paintedImage.height()/2);
-				affineTransform.rotate(rotationValue); 
-				affineTransform.translate(-inImage.width()/2, -inImage.height()/2);
-				imagePainter.setTransform(affineTransform);
-				imagePainter.drawImage(QPoint(0,0), inImage);
-				imagePainter.end();
-			
-				if (rotCropEnabled) {
+/**
+* Estimates the skew of the image and rotates it accordingly.
+* The skew estimation, crop and interpolation are read from the settings.
+* This function does not depend on the viewport and is used by the batch processing too.
+* @param inImage the image to be deskewed
+* @return the deskewed image
+**/
+QImage DkImgTransformationsViewPort::deskewImage(const QImage& inImage) {
 
-					QRect croppedImageRect = paintedImage.rect();
+	if (inImage.isNull())
+		return QImage();
 
-					QSize cropSize = QSize();
-					double newHeight = - ((double)(inImage.height()) - (double) (inImage.width()) * qAbs(qTan(rotationValue * PI /180))) / (qAbs(qTan(rotationValue * PI /180))*qAbs(qSin(rotationValue * PI /180))-qAbs(qCos(rotationValue * PI /180)));
-					cropSize = QSize(((double) (inImage.width())-newHeight*qAbs(qSin(rotationValue * PI /180)))/qAbs(qCos(rotationValue * PI /180)) , newHeight);
-					if (cropSize.width() <= qSqrt(inImage.height()*inImage.height()+inImage.width()*inImage.width()) && cropSize.height() <= qSqrt(inImage.height()*inImage.height()+inImage.width()*inImage.width())) croppedImageRect = QRect(QPoint(0.5*paintedImage.width()-0.5*cropSize.width(),0.5*paintedImage.height()-0.5*cropSize.height()),cropSize);
-					QImage croppedImage = paintedImage.copy(croppedImageRect);
+	QSettings settings;
+	bool crop = (settings.value("affineTransformPlugin/cropEnabled", Qt::Unchecked).toInt() == Qt::Checked);
+	int interpolation = settings.value("affineTransformPlugin/interpolation", DkAffineResampler::interpolation_bilinear).toInt();
 
-					return croppedImage;
-				}	
-				return paintedImage;
-			}
-			else if (selectedMode == mode_shear) {			
-			
-				affineTransform.shear(shearValues.x(), shearValues.y());
-				/*
-				QRect transfRect = affineTransform.mapRect(inImage.rect());
-				int signX = (shearValues.x() < 0) ? -1 : 1;
-				int signY = (shearValues.y() < 0) ? -1 : 1;
-
-				affineTransform.reset();
-				affineTransform.translate(signX*(inImage.width()/2-transfRect.width()/2), signY*(inImage.height()/2-transfRect.height()/2));
-				affineTransform.shear(shearValues.x(),shearValues.y());
-				*/
-				QImage paintedImage = QImage(affineTransform.mapRect(inImage.rect()).size(), inImage.format());
-				QPainter imagePainter(&paintedImage);
-				imagePainter.setRenderHints(QPainter::SmoothPixmapTransform | QPainter::Antialiasing);
-				imagePainter.fillRect(paintedImage.rect(), Qt::white);		
-				affineTransform.reset();
-				affineTransform.translate(paintedImage.width()/2, paintedImage.height()/2);
-				affineTransform.shear(shearValues.x(),shearValues.y());
-				affineTransform.translate(-inImage.width()/2, -inImage.height()/2);
-				imagePainter.setTransform(affineTransform);
-				imagePainter.drawImage(QPoint(0,0), inImage);
-				imagePainter.end();
-
-				return paintedImage;
-			}
-		}
+	DkSkewEstimator skewEstimator;
+	skewEstimator.setMaxSkewAngle(settings.value("affineTransformPlugin/maxSkewAngle", 30.0).toDouble());
+	skewEstimator.setProxySize(settings.value("affineTransformPlugin/proxySize", 1500).toInt());
+	DkSkewResult r = skewEstimator.compute(nmc::DkImage::qImage2Mat(inImage));
+
+	double rotationValue = r.angle;
+	if (rotationValue < 0) rotationValue += 360;
+
+	return rotateImage(inImage, rotationValue, crop, interpolation);
+}
+
+/**
+* Applies the composed transform (scale, rotation & shear) that was applied last.
+* The transform, crop and interpolation are read from the settings.
+* This function does not depend on the viewport and is used by the batch processing too.
+* @param inImage the image to be transformed
+* @return the transformed image or a null image if no transform is stored in the settings
+**/
+QImage DkImgTransformationsViewPort::transformImageFromSettings(const QImage& inImage) {
+
+	QSettings settings;
+	QVariantList m = settings.value("affineTransformPlugin/matrix").toList();
+
+	if (m.size() != 4) {
+		qWarning() << "[DkImgTransformationsPlugin] no transform found in the settings";
+		return QImage();
 	}
 
-	return QImage();
+	QTransform linearTransform(m[0].toDouble(), m[1].toDouble(), m[2].toDouble(), m[3].toDouble(), 0, 0);
+	bool crop = (settings.value("affineTransformPlugin/cropEnabled", Qt::Unchecked).toInt() == Qt::Checked);
+	int interpolation = settings.value("affineTransformPlugin/interpolation", DkAffineResampler::interpolation_bilinear).toInt();
+
+	return applyTransform(inImage, linearTransform, crop, interpolation);
+}
+
+/**
+* Rotates the image around its center.
+* This function does not depend on the viewport and is used by the batch processing too.
+* @param inImage the image to be rotated
+* @param rotationValue the rotation angle in degree
+* @param crop if true, the image is cropped to the largest axis-aligned rect (if possible)
+* @param interpolation the resampler's interpolation (DkAffineResampler::Interpolation)
+* @return the rotated image
+**/
+QImage DkImgTransformationsViewPort::rotateImage(const QImage& inImage, double rotationValue, bool crop, int interpolation) {
+
+	return applyTransform(inImage, composeTransform(QPointF(1,1), rotationValue, QPointF(0,0)), crop, interpolation);
+}
+
+/**
+* Transforms the image around its center.
+* The image is resampled once - no matter how many transformations are composed.
+* This function does not depend on the viewport and is used by the batch processing too.
+* @param inImage the image to be transformed
+* @param linearTransform the composed transform (see composeTransform)
+* @param crop if true, the image is cropped to the largest axis-aligned rect (if possible)
+* @param interpolation the resampler's interpolation (DkAffineResampler::Interpolation)
+* @return the transformed image
+**/
+QImage DkImgTransformationsViewPort::applyTransform(const QImage& inImage, const QTransform& linearTransform, bool crop, int interpolation) {
+
+	if (inImage.isNull())
+		return QImage();
+
+	QSize dstSize = linearTransform.mapRect(inImage.rect()).size();
+
+	QTransform affineTransform = QTransform::fromTranslate(-0.5*inImage.width(), -0.5*inImage.height()) * 
+		linearTransform * 
+		QTransform::fromTranslate(0.5*dstSize.width(), 0.5*dstSize.height());
+
+	// only the part that is kept is resampled
+	QRect dstRect = QRect(QPoint(0,0), dstSize);
+
+	if (crop) {
+
+		QSize cSize = cropSize(inImage.size(), linearTransform).toSize();
+
+		if (!cSize.isEmpty())
+			dstRect = QRect(QPoint(qRound(0.5*(dstSize.width()-cSize.width())), qRound(0.5*(dstSize.height()-cSize.height()))), cSize);
+	}
+
+	return transformImage(inImage, affineTransform, dstRect, interpolation);
+}
+
+/**
+* Resamples the image.
+* Only dstRect is computed. If the resampler cannot process the image, it is painted with QPainter.
+* @param inImage the source image
+* @param affineTransform the transform from source to destination coordinates
+* @param dstRect the destination rect (in destination coordinates)
+* @param interpolation the resampler's interpolation (DkAffineResampler::Interpolation)
+* @return the transformed image in the source's format
+**/
+QImage DkImgTransformationsViewPort::transformImage(const QImage& inImage, const QTransform& affineTransform, const QRect& dstRect, int interpolation) {
+
+	DkAffineResampler resampler(interpolation);
+	QImage img = resampler.warp(inImage, affineTransform, dstRect);
+
+	if (!img.isNull() || inImage.isNull() || dstRect.isEmpty())
+		return img;
+
+	// fallback if a band's source footprint exceeds OpenCV's coordinate range
+	QImage paintedImage = QImage(dstRect.size(), QImage::Format_ARGB32_Premultiplied);
+	QPainter imagePainter(&paintedImage);
+	imagePainter.setRenderHints(QPainter::SmoothPixmapTransform | QPainter::Antialiasing);
+	imagePainter.fillRect(paintedImage.rect(), Qt::white);		
+	imagePainter.setTransform(affineTransform * QTransform::fromTranslate(-dstRect.x(), -dstRect.y()));
+	imagePainter.drawImage(QPoint(0,0), inImage);
+	imagePainter.end();
+
+	if (inImage.format() == QImage::Format_Indexed8)
+		return paintedImage.convertToFormat(inImage.format(), inImage.colorTable());
+
+	return paintedImage.convertToFormat(inImage.format());
+}
+
+/**
+* Composes scale, shear and rotation (in this order).
+* The transform has no translation, it is applied around the image's center.
+* @param scale the scale in x and y direction
+* @param rotation the rotation angle in degree
+* @param shear the shear in x and y direction
+* @return the linear transform
+**/
+QTransform DkImgTransformationsViewPort::composeTransform(const QPointF& scale, double rotation, const QPointF& shear) {
+
+	QTransform linearTransform = QTransform();
+	linearTransform.rotate(rotation);
+	linearTransform.shear(shear.x(), shear.y());
+	linearTransform.scale(scale.x(), scale.y());
+
+	return linearTransform;
+}
+
+/**
+* Returns the size of the largest centered axis-aligned rect that is covered by the transformed image.
+* The rect's corners touch the transformed image's edges which is the rotation crop for pure rotations.
+* @param imgSize the image's size
+* @param linearTransform the composed transform (see composeTransform)
+* @return the crop size or an empty size if the image cannot be cropped
+**/
+QSizeF DkImgTransformationsViewPort::cropSize(const QSize& imgSize, const QTransform& linearTransform) {
+
+	if (!linearTransform.isInvertible())
+		return QSizeF();
+
+	// the corners (+/-w/2, +/-h/2) mapped back must be within the image:
+	// p*w + q*h <= W and r*w + s*h <= H
+	QTransform inv = linearTransform.inverted();
+	double p = qAbs(inv.m11());
+	double q = qAbs(inv.m21());
+	double r = qAbs(inv.m12());
+	double s = qAbs(inv.m22());
+
+	double det = p*s - q*r;
+
+	if (qAbs(det) < 1e-6)
+		return QSizeF();
+
+	double w = (imgSize.width()*s - imgSize.height()*q) / det;
+	double h = (imgSize.height()*p - imgSize.width()*r) / det;
+
+	QSize bb = linearTransform.mapRect(QRect(QPoint(0,0), imgSize)).size();
+
+	if (w < 1 || h < 1 || w > bb.width() || h > bb.height())
+		return QSizeF();
+
+	return QSizeF(w, h);
 }
 
 void DkImgTransformationsViewPort::setMode(int mode) {
@@ -681,8 +819,33 @@ void DkImgTransformationsViewPort::calculateAutoRotation() {
 
 			if (img.width() > 10 && img.height() > 10) {
 				
-				skewEstimator.setImage(img);
-				rotationValue = skewEstimator.getSkewAngle();
+				cv::Mat mImg = nmc::DkImage::qImage2Mat(img);
+				QSettings settings;
+				double maxSkewAngle = settings.value("affineTransformPlugin/maxSkewAngle", 30.0).toDouble();
+				int proxySize = settings.value("affineTransformPlugin/proxySize", 1500).toInt();
+				QAtomicInt canceled(0);
+				QAtomicInt progressValue(0);
+
+				QProgressDialog progress(tr("Calculating angle..."), tr("Cancel"), 0, 100, this);
+				progress.setMinimumDuration(250);
+				progress.setWindowModality(Qt::WindowModal);
+				progress.setValue(0);
+
+				// the estimation runs in a worker thread - we just update the progress
+				// the image is shared by value, only the flags are referenced (waitForTask returns once the worker is done)
+				QFuture<DkSkewResult> future = QtConcurrent::run([mImg, maxSkewAngle, proxySize, &canceled, &progressValue]() {
+					DkSkewEstimator skewEstimator;
+					skewEstimator.setMaxSkewAngle(maxSkewAngle);
+					skewEstimator.setProxySize(proxySize);
+					return skewEstimator.compute(mImg, &canceled, &progressValue);
+				});
+
+				waitForTask(future, progress, [&]() { return progressValue.load(); }, [&]() { canceled.store(1); });
+
+				skewResult = future.result();
+				progress.setValue(100);
+
+				rotationValue = skewResult.angle;
 				if (rotationValue < 0) rotationValue += 360;
 				imgTransformationsToolbar->setRotationValue(rotationValue);
 				this->repaint();
@@ -696,6 +859,90 @@ void DkImgTransformationsViewPort::calculateAutoRotation() {
 	
 }
 
+/**
+* Deskews all images of a folder.
+* The results are saved to the subfolder 'deskewed'.
+**/
+void DkImgTransformationsViewPort::deskewFolder() {
+
+	processFolder(DkImgTransformationsPlugin::id_deskew, tr("Deskew Folder"), "deskewed");
+}
+
+/**
+* Applies the current (composed) transform to all images of a folder.
+* The transform is saved to the settings and the results are saved to the subfolder 'transformed'.
+**/
+void DkImgTransformationsViewPort::transformFolder() {
+
+	QTransform linearTransform = composeTransform(scaleValues, rotationValue, shearValues);
+
+	QSettings settings;
+	settings.setValue("affineTransformPlugin/matrix", QVariantList() << linearTransform.m11() << linearTransform.m12() << linearTransform.m21() << linearTransform.m22());
+
+	processFolder(DkImgTransformationsPlugin::id_transform, tr("Transform Folder"), "transformed");
+}
+
+void DkImgTransformationsViewPort::processFolder(int runIdx, const QString& title, const QString& outputDirName) {
+
+	QString dirPath = QFileDialog::getExistingDirectory(this, title);
+
+	if (dirPath.isEmpty())
+		return;
+
+	QStringList files = DkSkewBatch::collectImages(dirPath);
+
+	if (files.isEmpty()) {
+		QMessageBox::information(this, title, tr("There are no images in %1").arg(dirPath));
+		return;
+	}
+
+	DkSkewBatch batch;
+	batch.setRunID(runIdx);
+	batch.setOutputDir(QDir(dirPath).absoluteFilePath(outputDirName));
+
+	QProgressDialog progress(tr("Processing images..."), tr("Cancel"), 0, files.size(), this);
+	progress.setMinimumDuration(250);
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setValue(0);
+
+	// batch & files outlive the worker since waitForTask returns once it is done
+	QFuture<void> future = QtConcurrent::run([&batch, files]() {
+		batch.compute(files);
+	});
+
+	waitForTask(future, progress, [&]() { return batch.numProcessed(); }, [&]() { batch.cancel(); });
+
+	progress.setValue(files.size());
+}
+
+/**
+* Waits for a task that runs in a worker thread and shows its progress.
+* A local event loop is left once the task is finished (no polling of the future).
+* The task must not be canceled by destroying its data - it has to stop if cancel is called.
+* @param future the task
+* @param progress the (modal) progress dialog
+* @param progressValue returns the task's current progress (called in the GUI thread)
+* @param cancel is called if the user cancels the dialog
+**/
+void DkImgTransformationsViewPort::waitForTask(const QFuture<void>& future, QProgressDialog& progress, const std::function<int()>& progressValue, const std::function<void()>& cancel) {
+
+	QEventLoop loop;
+	QFutureWatcher<void> watcher;
+	connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+
+	// the workers only update atomic counters - so the dialog is refreshed periodically
+	// the connections are released with the local loop & timer (context objects)
+	QTimer timer;
+	connect(&timer, &QTimer::timeout, &timer, [&]() { progress.setValue(progressValue()); });
+	connect(&progress, &QProgressDialog::canceled, &loop, [&]() { timer.stop(); cancel(); });
+
+	watcher.setFuture(future);
+	timer.start(50);
+
+	if (!watcher.isFinished())
+		loop.exec();
+}
+
 void DkImgTransformationsViewPort::setPanning(bool checked) {
 
 	this->panning = checked;
@@ -706,6 +953,12 @@ void DkImgTransformationsViewPort::setPanning(bool checked) {
 
 void DkImgTransformationsViewPort::applyChangesAndClose() {
 
+	// remember the transform - it can be applied to other images in batch mode
+	QTransform linearTransform = composeTransform(scaleValues, rotationValue, shearValues);
+
+	QSettings settings;
+	settings.setValue("affineTransformPlugin/matrix", QVariantList() << linearTransform.m11() << linearTransform.m12() << linearTransform.m21() << linearTransform.m22());
+
 	cancelTriggered = false;
 	emit closePlugin();
 }
@@ -726,6 +979,11 @@ void DkImgTransformationsViewPort::setGuideStyle(int guideMode) {
 	this->repaint();
 }
 
+void DkImgTransformationsViewPort::setInterpolation(int interpolation) {
+
+	this->interpolation = interpolation;
+}
+
 void DkImgTransformationsViewPort::setVisible(bool visible) {
 
 	if(parent()) {
@@ -735,9 +993,16 @@ void DkImgTransformationsViewPort::setVisible(bool visible) {
 			rotationCenter = QPoint(mViewport->getImage().width()/2,mViewport->getImage().height()/2);
 
 			imgRatioAngle = atan2(mViewport->getImage().height(),mViewport->getImage().width());
+
+			// build the preview's pyramid once when the plugin is opened
+			if (visible)
+				preview->setImage(mViewport->getImage());
 		}
 	}
 
+	// the preview's pyramid is only kept while the plugin is open
+	if (!visible)
+		preview->clear();
 
 	if (imgTransformationsToolbar) emit showToolbar(imgTransformationsToolbar, visible);
 
@@ -846,6 +1111,18 @@ void DkImgTransformationsToolBar::createLayout(int defaultMode) {
 	autoRotateButton->setToolTip(tr("Automatically rotate image"));
 	autoRotateButton->setStatusTip(autoRotateButton->toolTip());
 
+	//deskew all images of a folder
+	deskewFolderButton = new QPushButton(tr("Deskew &Folder..."), this);
+	deskewFolderButton->setObjectName("deskewFolderButton");
+	deskewFolderButton->setToolTip(tr("Automatically rotate all images of a folder"));
+	deskewFolderButton->setStatusTip(deskewFolderButton->toolTip());
+
+	//apply the composed transform to all images of a folder
+	transformFolderButton = new QPushButton(tr("Apply to Fol&der..."), this);
+	transformFolderButton->setObjectName("transformFolderButton");
+	transformFolderButton->setToolTip(tr("Apply scale, rotation and shear to all images of a folder"));
+	transformFolderButton->setStatusTip(transformFolderButton->toolTip());
+
 	//show lines for automatic angle detection
 	showLinesBox = new QCheckBox(tr("Show Angle Lines"), this);
 	showLinesBox->setObjectName("showLinesBox");
@@ -853,11 +1130,11 @@ void DkImgTransformationsToolBar::createLayout(int defaultMode) {
 	showLinesBox->setToolTip(tr("Show lines for angle detection."));
 	showLinesBox->setStatusTip(tr("Show lines (red) for angle detection. Green lines correspond to the selected angle."));
 
-	//crop rotated image
+	//crop transformed image
 	cropEnabledBox = new QCheckBox(tr("Crop Image"), this);
 	cropEnabledBox->setObjectName("cropEnabledBox");
 	cropEnabledBox->setCheckState(Qt::Unchecked);
-	cropEnabledBox->setToolTip(tr("Crop rotated image if possible"));
+	cropEnabledBox->setToolTip(tr("Crop transformed image if possible"));
 	cropEnabledBox->setStatusTip(cropEnabledBox->toolTip());
 
 
@@ -894,6 +1171,14 @@ void DkImgTransformationsToolBar::createLayout(int defaultMode) {
 	guideBox->setToolTip(tr("Show Guides in the Preview"));
 	guideBox->setStatusTip(guideBox->toolTip());
 
+	// resampling of the transformed image
+	interpolationBox = new QComboBox(this);
+	interpolationBox->addItems(DkAffineResampler::interpolationNames());
+	interpolationBox->setObjectName("interpolationBox");
+	interpolationBox->setCurrentIndex(DkAffineResampler::interpolation_bilinear);
+	interpolationBox->setToolTip(tr("Interpolation of the transformed image"));
+	interpolationBox->setStatusTip(interpolationBox->toolTip());
+
 
 	QActionGroup* modesGroup = new QActionGroup(this);
     modesGroup->addAction(scaleAction);
@@ -930,6 +1215,7 @@ void DkImgTransformationsToolBar::createLayout(int defaultMode) {
 	toolbarWidgetList.insert(rotationBox->objectName(), this->addWidget(rotationBox));
 	#ifdef WITH_OPENCV
 	toolbarWidgetList.insert(autoRotateButton->objectName(), this->addWidget(autoRotateButton));
+	toolbarWidgetList.insert(deskewFolderButton->objectName(), this->addWidget(deskewFolderButton));
 	toolbarWidgetList.insert(showLinesBox->objectName(), this->addWidget(showLinesBox));
 	#endif
 	toolbarWidgetList.insert(cropEnabledBox->objectName(), this->addWidget(cropEnabledBox));
@@ -937,6 +1223,8 @@ void DkImgTransformationsToolBar::createLayout(int defaultMode) {
 	toolbarWidgetList.insert(shearYBox->objectName(), this->addWidget(shearYBox));
 	addSeparator();
 	addWidget(guideBox);
+	addWidget(interpolationBox);
+	addWidget(transformFolderButton);
 
 	modifyLayout(defaultMode);
 }
@@ -948,15 +1236,14 @@ void DkImgTransformationsToolBar::modifyLayout(int mode) {
 			toolbarWidgetList.value(rotationBox->objectName())->setVisible(false);
 			#ifdef WITH_OPENCV
 			toolbarWidgetList.value(autoRotateButton->objectName())->setVisible(false);
+			toolbarWidgetList.value(deskewFolderButton->objectName())->setVisible(false);
 			toolbarWidgetList.value(showLinesBox->objectName())->setVisible(false);
 			#endif
-			toolbarWidgetList.value(cropEnabledBox->objectName())->setVisible(false);
+			toolbarWidgetList.value(cropEnabledBox->objectName())->setVisible(true);	// the crop applies to the composed transform
 			toolbarWidgetList.value(scaleXBox->objectName())->setVisible(true);
 			toolbarWidgetList.value(scaleYBox->objectName())->setVisible(true);
 			toolbarWidgetList.value(shearXBox->objectName())->setVisible(false);
 			toolbarWidgetList.value(shearYBox->objectName())->setVisible(false);
-			scaleXBox->setValue(1);
-			scaleYBox->setValue(1);
 			break;
 		case mode_rotate:	
 			toolbarWidgetList.value(scaleXBox->objectName())->setVisible(false);
@@ -964,12 +1251,12 @@ void DkImgTransformationsToolBar::modifyLayout(int mode) {
 			toolbarWidgetList.value(rotationBox->objectName())->setVisible(true);
 			#ifdef WITH_OPENCV
 			toolbarWidgetList.value(autoRotateButton->objectName())->setVisible(true);
+			toolbarWidgetList.value(deskewFolderButton->objectName())->setVisible(true);
 			toolbarWidgetList.value(showLinesBox->objectName())->setVisible(true);
 			#endif
 			toolbarWidgetList.value(cropEnabledBox->objectName())->setVisible(true);
 			toolbarWidgetList.value(shearXBox->objectName())->setVisible(false);
 			toolbarWidgetList.value(shearYBox->objectName())->setVisible(false);
-			rotationBox->setValue(0);
 			break;
 		case mode_shear:
 			toolbarWidgetList.value(scaleXBox->objectName())->setVisible(false);
@@ -977,13 +1264,12 @@ void DkImgTransformationsToolBar::modifyLayout(int mode) {
 			toolbarWidgetList.value(rotationBox->objectName())->setVisible(false);
 			#ifdef WITH_OPENCV
 			toolbarWidgetList.value(autoRotateButton->objectName())->setVisible(false);
+			toolbarWidgetList.value(deskewFolderButton->objectName())->setVisible(false);
 			toolbarWidgetList.value(showLinesBox->objectName())->setVisible(false);
 			#endif
-			toolbarWidgetList.value(cropEnabledBox->objectName())->setVisible(false);
+			toolbarWidgetList.value(cropEnabledBox->objectName())->setVisible(true);	// the crop applies to the composed transform
 			toolbarWidgetList.value(shearXBox->objectName())->setVisible(true);
 			toolbarWidgetList.value(shearYBox->objectName())->setVisible(true);
-			shearXBox->setValue(0);
-			shearYBox->setValue(0);
 			break;
 	}
 }
@@ -1076,6 +1362,16 @@ void DkImgTransformationsToolBar::on_autoRotateButton_clicked() {
 	emit calculateAutoRotationSignal();
 }
 
+void DkImgTransformationsToolBar::on_deskewFolderButton_clicked() {
+
+	emit deskewFolderSignal();
+}
+
+void DkImgTransformationsToolBar::on_transformFolderButton_clicked() {
+
+	emit transformFolderSignal();
+}
+
 void DkImgTransformationsToolBar::on_showLinesBox_stateChanged(int val) {
 
 	updateAffineTransformPluginSettings(val, settings_lines);
@@ -1094,6 +1390,12 @@ void DkImgTransformationsToolBar::on_guideBox_currentIndexChanged(int val) {
 	emit guideStyleSignal(val);
 }
 
+void DkImgTransformationsToolBar::on_interpolationBox_currentIndexChanged(int val) {
+
+	updateAffineTransformPluginSettings(val, settings_interpolation);
+	emit interpolationSignal(val);
+}
+
 void DkImgTransformationsToolBar::setRotationValue(double val) {
 
 	if (val > 180) val -= 360;
@@ -1127,6 +1429,11 @@ void DkImgTransformationsToolBar::setAngleLineState(int val) {
 	showLinesBox->setChecked(val);
 }
 
+void DkImgTransformationsToolBar::setInterpolationState(int val) {
+
+	interpolationBox->setCurrentIndex(val);
+}
+
 void DkImgTransformationsToolBar::updateAffineTransformPluginSettings(int val, int type) {
 	
 	QSettings settings;
@@ -1144,6 +1451,9 @@ void DkImgTransformationsToolBar::updateAffineTransformPluginSettings(int val, i
 		case settings_lines:
 			settings.setValue("affineTransformPlugin/angleLines", val);
 			break;
+		case settings_interpolation:
+			settings.setValue("affineTransformPlugin/interpolation", val);
+			break;
 	}
 }
 
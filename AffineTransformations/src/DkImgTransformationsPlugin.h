@@ -48,9 +48,16 @@
 #include <QVector4D>
 #include <QSettings>
 #include <QMouseEvent>
+#include <QFuture>
+
+#include <functional>
 
 #include "DkPluginInterface.h"
+#include "DkAffineResampler.h"
 #include "DkSkewEstimator.h"
+#include "DkTransformPreview.h"
+
+class QProgressDialog;
 
 namespace nmp {
 
@@ -81,6 +88,13 @@ class DkImgTransformationsPlugin : public QObject, nmc::DkViewPortInterface {
 
 public:
 
+	enum {
+		id_deskew = 0,
+		id_transform,
+
+		id_end
+	};
+
 	DkImgTransformationsPlugin();
 	~DkImgTransformationsPlugin();
 
@@ -93,6 +107,7 @@ public:
 
 protected:
 	nmc::DkPluginViewPort* mViewport = 0;
+	QStringList mRunIDs;
 };
 
 class DkImgTransformationsViewPort : public nmc::DkPluginViewPort {
@@ -105,6 +120,13 @@ public:
 
 	bool isCanceled();
 	QImage getTransformedImage();
+	static QImage deskewImage(const QImage& inImage);
+	static QImage transformImageFromSettings(const QImage& inImage);
+	static QImage rotateImage(const QImage& inImage, double rotationValue, bool crop, int interpolation = DkAffineResampler::interpolation_bilinear);
+	static QImage applyTransform(const QImage& inImage, const QTransform& linearTransform, bool crop, int interpolation = DkAffineResampler::interpolation_bilinear);
+	static QImage transformImage(const QImage& inImage, const QTransform& affineTransform, const QRect& dstRect, int interpolation);
+	static QTransform composeTransform(const QPointF& scale, double rotation, const QPointF& shear);
+	static QSizeF cropSize(const QSize& imgSize, const QTransform& linearTransform);
 
 public slots:
 	void setPanning(bool checked);
@@ -117,9 +139,12 @@ public slots:
 	void setShearYValue(double val);
 	void setRotationValue(double val);
 	void calculateAutoRotation();
+	void deskewFolder();
+	void transformFolder();
 	void setCropEnabled(bool enabled);
 	void setAngleLinesEnabled(bool enabled);
 	void setGuideStyle(int guideMode);
+	void setInterpolation(int interpolation);
 
 protected slots:
 		
@@ -134,6 +159,8 @@ protected:
 	QPoint map(const QPointF &pos);
 	virtual void init();
 	void drawGuide(QPainter* painter, const QPolygonF& p, int paintMode);
+	void processFolder(int runIdx, const QString& title, const QString& outputDirName);
+	void waitForTask(const QFuture<void>& future, QProgressDialog& progress, const std::function<int()>& progressValue, const std::function<void()>& cancel);
 
 	bool cancelTriggered;
 	bool panning;
@@ -155,9 +182,12 @@ protected:
 	double imgRatioAngle;
 	QCursor rotatingCursor;
 	bool rotCropEnabled;
-	DkSkewEstimator skewEstimator;
+	DkSkewResult skewResult;
 	bool angleLinesEnabled;
 	int guideMode;
+	int interpolation;
+	DkTransformPreview* preview;
+	bool interacting;
 };
 
 
@@ -183,6 +213,7 @@ public:
 		settings_guide,
 		settings_crop,
 		settings_lines,
+		settings_interpolation,
 
 		guide_end,
 	};
@@ -196,6 +227,7 @@ public:
 	void setCropState(int val);
 	void setGuideLineState(int val);
 	void setAngleLineState(int val);
+	void setInterpolationState(int val);
 
 public slots:
 	void on_applyAction_triggered();
@@ -212,7 +244,10 @@ public slots:
 	void on_cropEnabledBox_stateChanged(int val);
 	void on_showLinesBox_stateChanged(int val);
 	void on_autoRotateButton_clicked();
+	void on_deskewFolderButton_clicked();
+	void on_transformFolderButton_clicked();
 	void on_guideBox_currentIndexChanged(int val);
+	void on_interpolationBox_currentIndexChanged(int val);
 	virtual void setVisible(bool visible);
 
 signals:
@@ -224,11 +259,14 @@ signals:
 	void shearYValSignal(double val);
 	void rotationValSignal(double val);
 	void calculateAutoRotationSignal();
+	void deskewFolderSignal();
+	void transformFolderSignal();
 	void cropEnabledSignal(bool enabled);
 	void showLinesSignal(bool enabled);
 	void panSignal(bool checked);
 	void modeChangedSignal(int mode);
 	void guideStyleSignal(int guideMode);
+	void interpolationSignal(int interpolation);
 
 protected:
 	void createLayout(int defaultMode);
@@ -243,9 +281,12 @@ protected:
 	QDoubleSpinBox* rotationBox;
 	QCheckBox* cropEnabledBox;
 	QPushButton* autoRotateButton;
+	QPushButton* deskewFolderButton;
+	QPushButton* transformFolderButton;
 	QCheckBox* showLinesBox;
 	QMap<QString, QAction*> toolbarWidgetList;
 	QComboBox* guideBox;
+	QComboBox* interpolationBox;
 
 	QAction* panAction;
 	QAction* scaleAction;
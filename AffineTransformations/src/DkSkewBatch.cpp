@@ -0,0 +1,183 @@
+/*******************************************************************************************************
+ DkSkewBatch.cpp
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2014 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2014 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2014 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkSkewBatch.h"
+
+#include "DkImageContainer.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFuture>
+#include <QImageReader>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+namespace nmp {
+
+/**
+*	Constructor
+*	@param numThreads the number of worker threads (0 -> ideal thread count)
+**/
+DkSkewBatch::DkSkewBatch(int numThreads) {
+
+	this->numThreads = numThreads > 0 ? numThreads : QThread::idealThreadCount();
+	runIdx = DkImgTransformationsPlugin::id_deskew;
+}
+
+void DkSkewBatch::setOutputDir(const QString& outputDir) {
+
+	this->outputDir = outputDir;
+}
+
+void DkSkewBatch::setRunID(int runIdx) {
+
+	this->runIdx = runIdx;
+}
+
+void DkSkewBatch::cancel() {
+
+	canceled.store(1);
+}
+
+int DkSkewBatch::numProcessed() const {
+
+	return processed.load();
+}
+
+int DkSkewBatch::numFailed() const {
+
+	return failed.load();
+}
+
+/**
+*	Deskews all files.
+*	This function blocks until all files are processed (or the batch is canceled).
+*	If the output directory cannot be created, no file is processed and all are reported as failed.
+*	@param filePaths the images to be deskewed
+**/
+void DkSkewBatch::compute(const QStringList& filePaths) {
+
+	canceled.store(0);
+	processed.store(0);
+	failed.store(0);
+
+	// nothing can be written without the output directory
+	if (!outputDir.isEmpty() && !QDir().mkpath(outputDir)) {
+		qCritical() << "[DkSkewBatch] could not create the output directory" << outputDir;
+		processed.store(filePaths.size());
+		failed.store(filePaths.size());
+		return;
+	}
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(numThreads);
+
+	QElapsedTimer dt;
+	dt.start();
+
+	QVector<QFuture<void> > tasks;
+	for (const QString& filePath : filePaths) {
+
+		tasks << QtConcurrent::run(&pool, [this, filePath]() {
+
+			if (canceled.load())
+				return;
+
+			if (!process(filePath))
+				failed.ref();
+
+			processed.ref();
+		});
+	}
+
+	for (QFuture<void>& t : tasks)
+		t.waitForFinished();
+
+	qInfo() << "[DkSkewBatch]" << numProcessed() << "images processed in" << dt.elapsed() << "ms, failed:" << numFailed();
+}
+
+bool DkSkewBatch::process(const QString& filePath) const {
+
+	QSharedPointer<nmc::DkImageContainer> imgC(new nmc::DkImageContainer(filePath));
+
+	if (!imgC->loadImage()) {
+		qWarning() << "[DkSkewBatch] could not load" << filePath;
+		return false;
+	}
+
+	QImage img = runIdx == DkImgTransformationsPlugin::id_transform ?
+		DkImgTransformationsViewPort::transformImageFromSettings(imgC->image()) :
+		DkImgTransformationsViewPort::deskewImage(imgC->image());
+
+	if (img.isNull()) {
+		qWarning() << "[DkSkewBatch] could not transform" << filePath;
+		return false;
+	}
+
+	if (!imgC->saveImage(outputPath(filePath), img)) {
+		qWarning() << "[DkSkewBatch] could not save" << outputPath(filePath);
+		return false;
+	}
+
+	return true;
+}
+
+QString DkSkewBatch::outputPath(const QString& filePath) const {
+
+	if (outputDir.isEmpty())
+		return filePath;
+
+	return QFileInfo(QDir(outputDir), QFileInfo(filePath).fileName()).absoluteFilePath();
+}
+
+/**
+*	Returns all images of a directory.
+*	@param dirPath the directory
+*	@return sorted list of image files
+**/
+QStringList DkSkewBatch::collectImages(const QString& dirPath) {
+
+	QStringList filters;
+	for (const QByteArray& f : QImageReader::supportedImageFormats())
+		filters << "*." + QString::fromLatin1(f);
+
+	QStringList files;
+	QDirIterator it(dirPath, filters, QDir::Files);
+
+	while (it.hasNext())
+		files << it.next();
+
+	files.sort();
+
+	return files;
+}
+
+};
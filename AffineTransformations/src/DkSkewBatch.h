@@ -0,0 +1,71 @@
+/*******************************************************************************************************
+ DkSkewBatch.h
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2014 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2014 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2014 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QString>
+#include <QStringList>
+
+#include "DkImgTransformationsPlugin.h"
+
+namespace nmp {
+
+/**
+*	Deskews a list of images on a thread pool.
+*	Every image is loaded, deskewed (see DkImgTransformationsViewPort::deskewImage) and saved to the output directory.
+*	If the transform run ID is set, the composed transform of the plugin's settings is applied instead.
+**/
+class DkSkewBatch {
+
+public:
+	DkSkewBatch(int numThreads = 0);
+
+	void setOutputDir(const QString& outputDir);
+	void setRunID(int runIdx);
+	void compute(const QStringList& filePaths);
+	void cancel();
+
+	int numProcessed() const;
+	int numFailed() const;
+
+	static QStringList collectImages(const QString& dirPath);
+
+protected:
+	bool process(const QString& filePath) const;
+	QString outputPath(const QString& filePath) const;
+
+	int numThreads;
+	int runIdx;		// DkImgTransformationsPlugin::id_deskew or id_transform
+	QString outputDir;
+
+	QAtomicInt canceled;
+	QAtomicInt processed;
+	QAtomicInt failed;
+};
+
+};
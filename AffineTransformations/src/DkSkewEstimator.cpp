@@ -26,19 +26,199 @@
  *******************************************************************************************************/
 
 #include "DkSkewEstimator.h"
-#include "DkImageStorage.h"
 
 #include <QDebug>
+#include <QPair>
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DK_SEP_SSE2
+#endif
 
 namespace nmp {
 
-DkSkewEstimator::DkSkewEstimator(QWidget* mainWin) {
+/*-----------------------------------DkSeparabilityKernel ---------------------------------------------*/
+
+/**
+*	Computes the horizontal and vertical separability maps in one pass.
+*	The rows are split into tiles which are processed in parallel. 
+*	The cancel flag is polled and the progress (0 - 60) is updated once per tile.
+**/
+class DkSeparabilityKernel : public cv::ParallelLoopBody {
+
+public:
+	DkSeparabilityKernel(const cv::Mat& integral, const cv::Mat& integralSq, const QSize& sepDims, int delta, int tileHeight, 
+		const QAtomicInt* canceled, QAtomicInt* progress, QAtomicInt& tilesDone, cv::Mat& sepHor, cv::Mat& sepVer) :
+		integral(integral), integralSq(integralSq), tileHeight(tileHeight), canceled(canceled), progress(progress), tilesDone(tilesDone), sepHor(sepHor), sepVer(sepVer) {
+
+		W2 = qCeil(sepDims.width()/2);
+		H2 = qCeil(sepDims.height()/2);
+		D2 = qCeil(delta/2);
+		norm = 2.0 * W2 * H2;
+	}
+
+	void operator()(const cv::Range& range) const override {
+
+		for (int t = range.start; t < range.end; t++) {
+
+			if (canceled && canceled->load())
+				return;
+
+			int rEnd = qMin((t+1) * tileHeight, integral.rows);
+
+			for (int r = t * tileHeight; r < rEnd; r++) {
+
+				// horizontal: boxes above (r-H2 .. r-1) and below (r+1 .. r+H2) the pixel
+				if (r >= H2 + D2 && r < integral.rows - H2 - D2) {
+					separabilityRow(integral.ptr<double>(r - H2), integral.ptr<double>(r - 1), -W2, W2,
+						integral.ptr<double>(r + 1), integral.ptr<double>(r + H2), -W2, W2,
+						integralSq.ptr<double>(r - H2), integralSq.ptr<double>(r - 1),
+						integralSq.ptr<double>(r + 1), integralSq.ptr<double>(r + H2),
+						W2 + D2, integral.cols - W2 - D2, sepHor.ptr<float>(r));
+				}
+
+				// vertical: boxes left (c-H2 .. c-1) and right (c+1 .. c+H2) of the pixel
+				if (r >= W2 + D2 && r < integral.rows - W2 - D2) {
+					separabilityRow(integral.ptr<double>(r - W2), integral.ptr<double>(r + W2), -H2, -1,
+						integral.ptr<double>(r - W2), integral.ptr<double>(r + W2), 1, H2,
+						integralSq.ptr<double>(r - W2), integralSq.ptr<double>(r + W2),
+						integralSq.ptr<double>(r - W2), integralSq.ptr<double>(r + W2),
+						H2 + D2, integral.cols - H2 - D2, sepVer.ptr<float>(r));
+				}
+			}
+
+			int done = tilesDone.fetchAndAddRelaxed(1) + 1;
+
+			if (progress)
+				progress->store(qRound(60.0 * done / numTiles()));
+		}
+	}
+
+private:
+	const cv::Mat& integral;
+	const cv::Mat& integralSq;
+	int tileHeight;
+	const QAtomicInt* canceled;
+	QAtomicInt* progress;
+	QAtomicInt& tilesDone;
+	cv::Mat& sepHor;
+	cv::Mat& sepVer;
+
+	int W2;
+	int H2;
+	int D2;
+	double norm;
+
+	int numTiles() const {
+		return (integral.rows + tileHeight - 1) / tileHeight;
+	}
+
+	/**
+	*	Computes the separability of the columns [c0 c1) of a row.
+	*	A box is given by its top & bottom integral rows and its left & right column offsets.
+	*	The operations are done in the same order (and precision) for the SIMD and scalar paths.
+	**/
+	void separabilityRow(const double* t1, const double* b1, int l1, int r1,
+		const double* t2, const double* b2, int l2, int r2,
+		const double* tSq1, const double* bSq1, const double* tSq2, const double* bSq2,
+		int c0, int c1, float* dst) const {
+
+		int c = c0;
+
+#if defined(__AVX__)
+		const __m256d n = _mm256_set1_pd(norm);
+
+		for (; c + 4 <= c1; c += 4) {
+
+			__m256d mean1 = boxSum(t1, b1, l1, r1, c);
+			__m256d mean2 = boxSum(t2, b2, l2, r2, c);
+			__m256d var1 = boxSum(tSq1, bSq1, l1, r1, c);
+			__m256d var2 = boxSum(tSq2, bSq2, l2, r2, c);
+
+			mean1 = _mm256_div_pd(mean1, n);
+			mean2 = _mm256_div_pd(mean2, n);
+			var1 = _mm256_sub_pd(_mm256_div_pd(var1, n), _mm256_mul_pd(mean1, mean1));
+			var2 = _mm256_sub_pd(_mm256_div_pd(var2, n), _mm256_mul_pd(mean2, mean2));
+
+			__m256d d = _mm256_sub_pd(mean1, mean2);
+			__m256d sep = _mm256_div_pd(_mm256_mul_pd(d, d), _mm256_add_pd(var1, var2));
+			_mm_storeu_ps(dst + c, _mm256_cvtpd_ps(sep));
+		}
+#elif defined(DK_SEP_SSE2)
+		const __m128d n = _mm_set1_pd(norm);
+
+		for (; c + 2 <= c1; c += 2) {
+
+			__m128d mean1 = boxSum(t1, b1, l1, r1, c);
+			__m128d mean2 = boxSum(t2, b2, l2, r2, c);
+			__m128d var1 = boxSum(tSq1, bSq1, l1, r1, c);
+			__m128d var2 = boxSum(tSq2, bSq2, l2, r2, c);
+
+			mean1 = _mm_div_pd(mean1, n);
+			mean2 = _mm_div_pd(mean2, n);
+			var1 = _mm_sub_pd(_mm_div_pd(var1, n), _mm_mul_pd(mean1, mean1));
+			var2 = _mm_sub_pd(_mm_div_pd(var2, n), _mm_mul_pd(mean2, mean2));
+
+			__m128d d = _mm_sub_pd(mean1, mean2);
+			__m128d sep = _mm_div_pd(_mm_mul_pd(d, d), _mm_add_pd(var1, var2));
+			_mm_storel_pi((__m64*)(dst + c), _mm_cvtpd_ps(sep));
+		}
+#endif
+
+		for (; c < c1; c++) {
 
-	this->mainWin = mainWin;
+			double mean1 = t1[c + l1] + b1[c + r1] - t1[c + r1] - b1[c + l1];
+			double mean2 = t2[c + l2] + b2[c + r2] - t2[c + r2] - b2[c + l2];
+			mean1 /= norm;
+			mean2 /= norm;
+
+			double var1 = tSq1[c + l1] + bSq1[c + r1] - tSq1[c + r1] - bSq1[c + l1];
+			double var2 = tSq2[c + l2] + bSq2[c + r2] - tSq2[c + r2] - bSq2[c + l2];
+			var1 /= norm;
+			var2 /= norm;
+
+			var1 = var1 - (mean1 * mean1);
+			var2 = var2 - (mean2 * mean2);
+
+			dst[c] = (float)((mean1 - mean2) * (mean1 - mean2) / (var1 + var2));
+		}
+	}
+
+#if defined(__AVX__)
+	static inline __m256d boxSum(const double* t, const double* b, int l, int r, int c) {
+
+		__m256d s = _mm256_add_pd(_mm256_loadu_pd(t + c + l), _mm256_loadu_pd(b + c + r));
+		s = _mm256_sub_pd(s, _mm256_loadu_pd(t + c + r));
+		return _mm256_sub_pd(s, _mm256_loadu_pd(b + c + l));
+	}
+#elif defined(DK_SEP_SSE2)
+	static inline __m128d boxSum(const double* t, const double* b, int l, int r, int c) {
+
+		__m128d s = _mm_add_pd(_mm_loadu_pd(t + c + l), _mm_loadu_pd(b + c + r));
+		s = _mm_sub_pd(s, _mm_loadu_pd(t + c + r));
+		return _mm_sub_pd(s, _mm_loadu_pd(b + c + l));
+	}
+#endif
+};
+
+/*-----------------------------------DkSkewEstimator ---------------------------------------------*/
+
+DkSkewEstimator::DkSkewEstimator() {
 
 	// method parameters
 	nIter = 200;
 	sigma = 0.3;
+	maxSkewAngle = 30;
+	proxySize = 0;
+	numVerifyStrips = 8;
+	verifyTolerance = 0.5;
+	angleBinWidth = 0.05;
 	sepThr = 0.1,
 	epsilon = 2;
 	kMax = 7;
@@ -47,6 +227,8 @@ DkSkewEstimator::DkSkewEstimator(QWidget* mainWin) {
 	minLineLength = 10;
 	minLineProjLength = minLineLength/4;
 	rotationFactor = 1;
+	canceled = 0;
+	progress = 0;
 
 	selectedLines.clear();
 }
@@ -55,21 +237,20 @@ DkSkewEstimator::~DkSkewEstimator() {
 
 }
 
-void DkSkewEstimator::setImage(QImage inImage) {
+/**
+*	Sets the parameters w.r.t. the image size.
+**/
+void DkSkewEstimator::setImage(const cv::Mat& img) {
 
-	matImg = nmc::DkImage::qImage2Mat(inImage);
-	
-	sepDims = QSize(qRound(inImage.width()/1430.0*49.0),qRound(inImage.height()/700.0*12.0));
-	delta = qRound(inImage.width()/1430.0*20.0);
-	minLineLength = qRound(inImage.width()/1430.0 * 20.0);
+	sepDims = QSize(qRound(img.cols/1430.0*49.0),qRound(img.rows/700.0*12.0));
+	delta = qRound(img.cols/1430.0*20.0);
+	minLineLength = qRound(img.cols/1430.0 * 20.0);
 	rotationFactor = 1;
 
-	if (inImage.width() < inImage.height()) {
+	if (img.cols < img.rows) {
 
-		matImg = matImg.t();
-		sepDims = QSize(qRound(inImage.width()/1430.0*49.0),qRound(inImage.height()/700.0*12.0));
-		delta = qRound(inImage.height()/1430.0*20.0);
-		minLineLength = qRound(inImage.height()/1430.0 * 20.0);
+		delta = qRound(img.rows/1430.0*20.0);
+		minLineLength = qRound(img.rows/1430.0 * 20.0);
 		rotationFactor = -1;
 	}
 
@@ -79,147 +260,312 @@ void DkSkewEstimator::setImage(QImage inImage) {
 	minLineProjLength = minLineLength/4;
 }
 
-double DkSkewEstimator::getSkewAngle() {
+bool DkSkewEstimator::isCanceled() const {
 
-	if (!matImg.empty()) {
-		progress = new QProgressDialog(QT_TRANSLATE_NOOP("nmc::DkSkewEstimator", "Calculating angle..."), QT_TRANSLATE_NOOP("nmc::DkSkewEstimator", "Cancel"), 0, 100, mainWin);
-		progress->setMinimumDuration(250);
-		progress->setMaximum(100);
-		progress->setValue(0);
-		progress->setWindowModality(Qt::WindowModal);
-		progress->setModal(true);
-		progress->hide();
-		progress->show();
+	return canceled && canceled->load();
+}
 
-		cv::Mat matGray;
+void DkSkewEstimator::setProgress(int val) const {
 
-		if (matImg.channels() > 1)
-			cv::cvtColor(matImg, matGray, CV_BGR2GRAY);
-		else matGray = matImg;
+	if (progress)
+		progress->store(val);
+}
 
-		cv::Mat integral, integralSq;
-		cv::integral(matGray, integral, integralSq, CV_64F);
-		if (integral.channels() > 1) qDebug() << "Error! integral image has more than one channel";
+/**
+*	Estimates the skew angle of img.
+*	If a proxy size is set, the angle is estimated on a downsampled proxy
+*	and then verified on full resolution strips around the strongest lines.
+*	This function is thread-safe as long as every thread uses its own estimator.
+*	@param img the image (gray, BGR or BGRA)
+*	@param canceled if set (by any thread), the computation is stopped - may be NULL
+*	@param progress is updated (0 - 100) during the computation - may be NULL
+*	@return the skew angle, the weights and the selected lines
+**/
+DkSkewResult DkSkewEstimator::compute(const cv::Mat& img, const QAtomicInt* canceled, QAtomicInt* progress) {
+
+	this->canceled = canceled;
+	this->progress = progress;
+
+	DkSkewResult result;
+	setProgress(0);
+
+	if (img.empty())
+		return result;
+
+	int maxSide = qMax(img.cols, img.rows);
+
+	if (proxySize <= 0 || maxSide <= proxySize) {
+		result = estimate(img);
+		setProgress(100);
+		return result;
+	}
 
-		cv::Mat separabilityHor = computeSeparability(integral, integralSq, dir_horizontal);
-		if (progress->wasCanceled()) {
-			progress->deleteLater();
-			return 0;
-		}
+	double s = (double)proxySize / maxSide;
 
-		cv::Mat separabilityVer = computeSeparability(integral, integralSq,  dir_vertical);
-		if (progress->wasCanceled()) {
-			progress->deleteLater();
-			return 0;
-		}
+	cv::Mat proxy;
+	cv::resize(img, proxy, cv::Size(), s, s, CV_INTER_AREA);
 
-		double min, max;
-		cv::minMaxLoc(separabilityHor, &min, &max);	
-		cv::Mat edgeMapHor = computeEdgeMap(separabilityHor, sepThr * max, dir_horizontal);
-		//cv::Mat edgeMapHor = computeEdgeMap(separabilityHor, 0.1, dir_horizontal);
-		if (progress->wasCanceled()) {
-			progress->deleteLater();
-			return 0;
-		}
+	result = estimate(proxy);
 
-		cv::minMaxLoc(separabilityVer, &min, &max);
-		cv::Mat edgeMapVer = computeEdgeMap(separabilityVer, sepThr * max, dir_vertical);
-		//cv::Mat edgeMapVer = computeEdgeMap(separabilityVer, 0.1, dir_vertical);
-		if (progress->wasCanceled()) {
-			progress->deleteLater();
-			return 0;
-		}
+	if (result.canceled)
+		return result;
 
-		selectedLines.clear();
+	// lines are returned in full resolution coordinates
+	for (QVector4D& l : result.lines)
+		l = QVector4D((l.x() + 0.5f) / s - 0.5f, (l.y() + 0.5f) / s - 0.5f, (l.z() + 0.5f) / s - 0.5f, (l.w() + 0.5f) / s - 0.5f);
 
-		QVector<QVector3D> weightsHor = computeWeights(edgeMapHor, dir_horizontal);
-		qDebug() << weightsHor.size();
-		QVector<QVector3D> weightsVer = computeWeights(edgeMapVer, dir_vertical);
-		qDebug() << weightsVer.size();
-		if (progress->wasCanceled()) {
-			selectedLines.clear();
-			progress->deleteLater();
-			return 0;
-		}
+	result.angle = verifyAngle(img, result, s);
+	setProgress(100);
+
+	return result;
+}
+
+/**
+*	Verifies the proxy's angle on full resolution strips.
+*	The strongest lines that support the angle are fitted to the edges in 
+*	full resolution strips. The refined angle is the weighted mean of all 
+*	line angles that agree with the proxy's angle.
+*	@param img the full resolution image
+*	@param result the proxy's result (lines in full resolution coordinates)
+*	@param s the proxy's scale factor
+*	@return the refined skew angle in degree
+**/
+double DkSkewEstimator::verifyAngle(const cv::Mat& img, const DkSkewResult& result, double s) const {
+
+	// sort the supporting lines by their weight
+	QVector<QPair<double, int> > candidates;
+	for (int idx = 0; idx < result.lines.size() && idx < result.weights.size(); idx++) {
+		if (result.lineTypes.value(idx) == 1)
+			candidates << qMakePair((double)result.weights[idx].x(), idx);
+	}
 
-		weightsHor += weightsVer;
- 
-		double retAngle = computeSkewAngle(weightsHor, qSqrt(matGray.rows*matGray.rows + matGray.cols*matGray.cols));
+	std::sort(candidates.begin(), candidates.end(), [](const QPair<double, int>& l, const QPair<double, int>& r) {
+		return l.first > r.first;
+	});
 
-		progress->setValue(100);
-		progress->deleteLater();
+	double sumAngle = 0;
+	double sumWeights = 0;
+	int numVerified = 0;
 
-		return retAngle;
+	for (int cIdx = 0; cIdx < candidates.size() && numVerified < numVerifyStrips; cIdx++) {
+
+		if (isCanceled())
+			break;
+
+		double angle = 0;
+		const QVector4D& l = result.lines[candidates[cIdx].second];
+
+		if (!fitStrip(img, QPointF(l.x(), l.y()), QPointF(l.z(), l.w()), s, angle))
+			continue;
+
+		// the proxy's accuracy is ~1 proxy px over the line's length
+		if (qAbs(angle - result.angle) > verifyTolerance)
+			continue;
+
+		sumAngle += candidates[cIdx].first * angle;
+		sumWeights += candidates[cIdx].first;
+		numVerified++;
 	}
-	else return 0;
+
+	if (numVerified == 0)
+		return result.angle;
+
+	return sumAngle / sumWeights;
 }
 
-cv::Mat DkSkewEstimator::computeSeparability(cv::Mat integral, cv::Mat integralSq, int direction) {
+/**
+*	Fits a line to the strongest edge within a full resolution strip.
+*	@param img the full resolution image
+*	@param p1 the line's first point (full resolution)
+*	@param p2 the line's second point (full resolution)
+*	@param s the proxy's scale factor
+*	@param angle the skew angle (degree) that aligns the fitted line
+*	@return false if the line could not be fitted
+**/
+bool DkSkewEstimator::fitStrip(const cv::Mat& img, const QPointF& p1, const QPointF& p2, double s, double& angle) const {
+
+	QPointF d = p2 - p1;
+	bool horizontal = qAbs(d.x()) >= qAbs(d.y());
+
+	// search +/- 3 proxy px around the line
+	int r = qCeil(3.0 / s);
+
+	cv::Rect roi(cv::Point(qFloor(qMin(p1.x(), p2.x())) - r, qFloor(qMin(p1.y(), p2.y())) - r),
+				 cv::Point(qCeil(qMax(p1.x(), p2.x())) + r + 1, qCeil(qMax(p1.y(), p2.y())) + r + 1));
+	roi &= cv::Rect(0, 0, img.cols, img.rows);
+
+	if (roi.width < 3 || roi.height < 3)
+		return false;
+
+	cv::Mat strip;
+	if (img.channels() == 4)
+		cv::cvtColor(img(roi), strip, CV_BGRA2GRAY);
+	else if (img.channels() > 1)
+		cv::cvtColor(img(roi), strip, CV_BGR2GRAY);
+	else
+		img(roi).copyTo(strip);
+
+	// handle vertical lines as horizontal lines
+	QPointF a = p1 - QPointF(roi.x, roi.y);
+	QPointF b = p2 - QPointF(roi.x, roi.y);
+
+	if (!horizontal) {
+		strip = strip.t();
+		a = QPointF(a.y(), a.x());
+		b = QPointF(b.y(), b.x());
+	}
 
-	cv::Mat separability = cv::Mat::zeros(integral.rows, integral.cols, CV_32FC1);
+	if (b.x() < a.x())
+		qSwap(a, b);
 
-	int W2 = qCeil(sepDims.width()/2);
-	int H2 = qCeil(sepDims.height()/2);
+	// average along the line (one proxy px) to suppress noise
+	cv::Mat fStrip;
+	strip.convertTo(fStrip, CV_32F);
+	cv::blur(fStrip, fStrip, cv::Size(qMax(qRound(1.0 / s), 1), 1));
 
-	if (direction == dir_horizontal) {
-		int progressStep = integral.rows - 2 * H2 - 2 * qCeil(delta/2);
-		int lastValue = progress->value();
+	double slope = (b.y() - a.y()) / qMax(b.x() - a.x(), 1.0);
+	int step = qMax(qRound(1.0 / s), 1);
 
-		for (int r = H2 + qCeil(delta/2); r < integral.rows - H2 - qCeil(delta/2); r++) {
-			progress->setValue(lastValue + qRound(30.0 * (r - H2 - qCeil(delta/2)) / (double)progressStep));
-			if (progress->wasCanceled()) break;
-			for (int c = W2 + qCeil(delta/2); c < integral.cols - W2 - qCeil(delta/2); c++) {
+	std::vector<cv::Point2f> pts;
 
-				double mean1 = integral.at<double>(r - H2, c - W2) + integral.at<double>(r - 1, c + W2) - integral.at<double>(r - H2, c + W2) - integral.at<double>(r - 1, c - W2);
-				double mean2 = integral.at<double>(r + 1, c - W2) + integral.at<double>(r + H2, c + W2) - integral.at<double>(r + 1, c + W2) - integral.at<double>(r + H2, c - W2);
-				mean1 /= (2 * W2 * H2);
-				mean2 /= (2 * W2 * H2);
+	for (int x = qMax(qCeil(a.x()), 0); x <= qMin(qFloor(b.x()), fStrip.cols - 1); x += step) {
 
-				double var1 = integralSq.at<double>(r - H2, c - W2) + integralSq.at<double>(r - 1, c + W2) - integralSq.at<double>(r - H2, c + W2) - integralSq.at<double>(r - 1, c - W2);
-				double var2 = integralSq.at<double>(r + 1, c - W2) + integralSq.at<double>(r + H2, c + W2) - integralSq.at<double>(r + 1, c + W2) - integralSq.at<double>(r + H2, c - W2);
-				var1 /= (2 * W2 * H2);
-				var2 /= (2 * W2 * H2);
+		double yc = a.y() + (x - a.x()) * slope;
+		int y0 = qMax(qRound(yc) - r, 1);
+		int y1 = qMin(qRound(yc) + r, fStrip.rows - 2);
 
-				var1 = var1 - (mean1 * mean1);
-				var2 = var2 - (mean2 * mean2);
+		int maxY = -1;
+		float maxG = 0;
+		std::vector<float> g(fStrip.rows, 0.0f);
 
-				separability.at<float>(r, c) = (float)((mean1 - mean2) * (mean1 - mean2) / (var1 + var2));
+		for (int y = y0; y <= y1; y++) {
+			g[y] = qAbs(fStrip.at<float>(y+1, x) - fStrip.at<float>(y-1, x));
+
+			if (g[y] > maxG) {
+				maxG = g[y];
+				maxY = y;
 			}
 		}
+
+		if (maxY <= y0 || maxY >= y1)
+			continue;
+
+		// sub-pixel peak
+		float den = g[maxY-1] - 2.0f * g[maxY] + g[maxY+1];
+		float dy = qAbs(den) > FLT_EPSILON ? 0.5f * (g[maxY-1] - g[maxY+1]) / den : 0.0f;
+
+		pts.push_back(cv::Point2f((float)x, maxY + qBound(-0.5f, dy, 0.5f)));
+	}
+
+	if (pts.size() < 8)
+		return false;
+
+	cv::Vec4f line;
+	cv::fitLine(pts, line, CV_DIST_HUBER, 0, 0.01, 0.01);
+
+	if (line[0] < 0) {
+		line[0] = -line[0];
+		line[1] = -line[1];
 	}
-	else {
-		int progressStep = integral.rows - 2 * W2 - 2 * qCeil(delta/2);
-		int lastValue = progress->value();
 
-		for (int r = W2 + qCeil(delta/2); r < integral.rows - W2 - qCeil(delta/2); r++) {
-			progress->setValue(lastValue + qRound(30.0 * (r - W2 - qCeil(delta/2)) / (double)progressStep));
-			if (progress->wasCanceled()) break;
+	// horizontal lines: rotate by -phi, vertical lines: by their angle w.r.t. the y-axis
+	double phi = atan2(line[1], line[0]) * 180.0 / M_PI;
+	angle = horizontal ? -phi : phi;
 
-			for (int c = H2 + qCeil(delta/2); c < integral.cols - H2 - qCeil(delta/2); c++) {
+	return true;
+}
 
-				double mean1 = integral.at<double>(r - W2, c - H2) + integral.at<double>(r + W2, c - 1) - integral.at<double>(r + W2, c - H2) - integral.at<double>(r - W2, c - 1);
-				double mean2 = integral.at<double>(r - W2, c + 1) + integral.at<double>(r + W2, c + H2) - integral.at<double>(r + W2, c + 1) - integral.at<double>(r - W2, c + H2);
-				mean1 /= (2 * W2 * H2);
-				mean2 /= (2 * W2 * H2);
+/**
+*	Runs the skew estimation on img.
+**/
+DkSkewResult DkSkewEstimator::estimate(const cv::Mat& img) {
 
-				double var1 = integralSq.at<double>(r - W2, c - H2) + integralSq.at<double>(r + W2, c - 1) - integralSq.at<double>(r + W2, c - H2) - integralSq.at<double>(r - W2, c - 1);
-				double var2 = integralSq.at<double>(r - W2, c + 1) + integralSq.at<double>(r + W2, c + H2) - integralSq.at<double>(r + W2, c + 1) - integralSq.at<double>(r - W2, c + H2);
-				var1 /= (2 * W2 * H2);
-				var2 /= (2 * W2 * H2);
+	DkSkewResult result;
+	selectedLines.clear();
+	selectedLineTypes.clear();
 
-				var1 = var1 - (mean1 * mean1);
-				var2 = var2 - (mean2 * mean2);
+	setImage(img);
 
-				separability.at<float>(r, c) = (float)((mean1 - mean2) * (mean1 - mean2) / (var1 + var2));
-			}
-		}
+	cv::Mat matGray;
+
+	if (img.channels() == 4)
+		cv::cvtColor(img, matGray, CV_BGRA2GRAY);
+	else if (img.channels() > 1)
+		cv::cvtColor(img, matGray, CV_BGR2GRAY);
+	else matGray = img;
+
+	// transpose the gray image only (portrait pages)
+	if (rotationFactor == -1)
+		matGray = matGray.t();
+
+	cv::Mat integral, integralSq;
+	cv::integral(matGray, integral, integralSq, CV_64F);
+	if (integral.channels() > 1) qDebug() << "Error! integral image has more than one channel";
+
+	cv::Mat separabilityHor, separabilityVer;
+	computeSeparability(integral, integralSq, separabilityHor, separabilityVer);
+	integral.release();
+	integralSq.release();
+
+	if (isCanceled()) {
+		result.canceled = true;
+		return result;
 	}
 
+	double min, max;
+	cv::minMaxLoc(separabilityHor, &min, &max);	
+	cv::Mat edgeMapHor = computeEdgeMap(separabilityHor, sepThr * max, dir_horizontal);
+	//cv::Mat edgeMapHor = computeEdgeMap(separabilityHor, 0.1, dir_horizontal);
+	separabilityHor.release();
+
+	cv::minMaxLoc(separabilityVer, &min, &max);
+	cv::Mat edgeMapVer = computeEdgeMap(separabilityVer, sepThr * max, dir_vertical);
+	//cv::Mat edgeMapVer = computeEdgeMap(separabilityVer, 0.1, dir_vertical);
+	separabilityVer.release();
+
+	if (isCanceled()) {
+		result.canceled = true;
+		return result;
+	}
+
+	QVector<QVector3D> weightsHor = computeWeights(edgeMapHor, dir_horizontal);
+	QVector<QVector3D> weightsVer = computeWeights(edgeMapVer, dir_vertical);
+	
+	if (isCanceled()) {
+		selectedLines.clear();
+		selectedLineTypes.clear();
+		result.canceled = true;
+		return result;
+	}
+
+	weightsHor += weightsVer;
+
+	result.angle = computeSkewAngle(weightsHor, qSqrt(matGray.rows*matGray.rows + matGray.cols*matGray.cols));
+	result.weights = weightsHor;
+	result.lines = selectedLines;
+	result.lineTypes = selectedLineTypes;
+
+	return result;
+}
+
+/**
+*	Computes the horizontal and vertical separability maps (progress 0 - 60).
+**/
+void DkSkewEstimator::computeSeparability(const cv::Mat& integral, const cv::Mat& integralSq, cv::Mat& separabilityHor, cv::Mat& separabilityVer) {
+
+	separabilityHor = cv::Mat::zeros(integral.rows, integral.cols, CV_32FC1);
+	separabilityVer = cv::Mat::zeros(integral.rows, integral.cols, CV_32FC1);
+
+	int tileHeight = 32;
+	int numTiles = (integral.rows + tileHeight - 1) / tileHeight;
+
+	QAtomicInt tilesDone(0);
+	DkSeparabilityKernel kernel(integral, integralSq, sepDims, delta, tileHeight, canceled, progress, tilesDone, separabilityHor, separabilityVer);
+	cv::parallel_for_(cv::Range(0, numTiles), kernel);
+
 	// for displaying:
 	// cv::normalize(separability, separability, 0, 255, NORM_MINMAX, CV_8UC1);
 	// cvtColor(separability, separability, CV_GRAY2RGB);
-
-	return separability;
 }
 
 cv::Mat DkSkewEstimator::computeEdgeMap(cv::Mat separability, double thr, int direction) {
@@ -233,12 +579,12 @@ cv::Mat DkSkewEstimator::computeEdgeMap(cv::Mat separability, double thr, int di
 
 	if (direction == dir_horizontal) {
 		int progressStep = separability.rows - 2 * H2 - 2 * kMax;
-		int lastValue = progress->value();
+		int lastValue = 60;
 
 		float* p;
 		for (int r = H2 + kMax; r < separability.rows - H2 - kMax; r++) {
-			progress->setValue(lastValue + qRound(5.0 * (r - H2 - kMax) / (double)progressStep));
-			if (progress->wasCanceled()) break;
+			setProgress(lastValue + qRound(5.0 * (r - H2 - kMax) / (double)progressStep));
+			if (isCanceled()) break;
 
 			p = separability.ptr<float>(r);
 			for (int c = W2; c < separability.cols - W2; c++) {
@@ -266,12 +612,12 @@ cv::Mat DkSkewEstimator::computeEdgeMap(cv::Mat separability, double thr, int di
 	}
 	else  {
 		int progressStep = separability.rows - 2 * W2 - 2 * kMax;
-		int lastValue = progress->value();
+		int lastValue = 65;
 
 		float* p;
 		for (int r = W2; r < separability.rows - W2; r++) {
-			progress->setValue(lastValue + qRound(5.0 * (r - W2 - kMax) / (double)progressStep));
-			if (progress->wasCanceled()) break;
+			setProgress(lastValue + qRound(5.0 * (r - W2 - kMax) / (double)progressStep));
+			if (isCanceled()) break;
 
 			p = separability.ptr<float>(r);
 			for (int c = H2 + kMax; c < separability.cols - H2 - kMax; c++) {
@@ -311,11 +657,11 @@ QVector<QVector3D> DkSkewEstimator::computeWeights(cv::Mat edgeMap, int directio
 	HoughLinesP(edgeMap, lines, 1, CV_PI/180, 50, minLineLength, 20 ); //params: rho resolution, theta resolution, threshold, min Line length, max line gap
 
 	QVector<QVector3D> computedWeights = QVector<QVector3D>();
-	int lastValue = progress->value();
+	int lastValue = (direction == dir_horizontal) ? 70 : 85;
 
 	for(size_t i = 0; i < lines.size(); i++) {
-		progress->setValue(lastValue + qRound(15.0 * (float)i / lines.size()));
-		if (progress->wasCanceled()) break;
+		setProgress(lastValue + qRound(15.0 * (float)i / lines.size()));
+		if (isCanceled()) break;
 
 		cv::Vec4i l = lines[i];		
 		QVector3D currMax = QVector3D(0.0, 0.0, 0.0);
@@ -456,6 +802,18 @@ QVector<QVector3D> DkSkewEstimator::computeWeights(cv::Mat edgeMap, int directio
 }
 
 
+/**
+*	Finds the skew angle with the maximal saliency.
+*	The saliency is the sum of Gaussians (sigma) centered at the lines' angles.
+*	A weighted angle histogram is built in one pass and smoothed with the Gaussian.
+*	The histogram's peak is then refined with Newton steps on the continuous saliency.
+*	The cost is O(lines + bins) - independent of the search range (maxSkewAngle).
+*	Horizontal and vertical lines vote in the same histogram, so angles are only
+*	defined modulo 90 degree - the search range is therefore at most +/-45 degree.
+*	@param weights (weight, angle [rad], distance to the center) of all lines
+*	@param imgDiagonal the image diagonal
+*	@return the skew angle in degree
+**/
 double DkSkewEstimator::computeSkewAngle(QVector<QVector3D> weights, double imgDiagonal) {
 
 	if (weights.size() < 1) return 0;
@@ -474,49 +832,132 @@ double DkSkewEstimator::computeSkewAngle(QVector<QVector3D> weights, double imgD
 			//thrWeights.append(QVector3D((weights.at(i).x()/maxWeight - eta) * (weights.at(i).x()/maxWeight - eta), weights.at(i).y() / M_PI * 180, weights.at(i).z() / imgDiagonal));
 		}
 
-	QVector<QPointF> saliencyVec = QVector<QPointF>();
+	// horizontal & vertical lines share the histogram: +/-45 degree are the same for the full range
+	const double period = 90.0;
+	double range = qMin(maxSkewAngle, period * 0.5);
+	bool circular = range >= period * 0.5;
+
+	int sigmaBins = qMax(qCeil(4.0 * sigma / angleBinWidth), 1);
+	int numRangeBins = circular ? qRound(period / angleBinWidth) : qRound(2.0 * range / angleBinWidth) + 1;
+	int pad = circular ? 0 : sigmaBins;
+	int numBins = numRangeBins + 2 * pad;
+
+	// bin index -> angle
+	auto binAngle = [&](int idx) {
+		return -range + (idx - pad) * angleBinWidth;
+	};
+
+	auto wrapIdx = [&](int idx) {
+		return circular ? (idx % numBins + numBins) % numBins : idx;
+	};
+
+	// weighted angle histogram (linear splatting)
+	std::vector<double> hist(numBins, 0.0);
+
+	for (int i = 0; i < thrWeights.size(); i++) {
+
+		double angle = thrWeights.at(i).y();
+		if (circular) angle -= period * qRound(angle / period);
+
+		double pos = (angle + range) / angleBinWidth + pad;
+		int b0 = qFloor(pos);
+		double f = pos - b0;
+		double v = thrWeights.at(i).x() * qExp(-thrWeights.at(i).z());
 
-	for (double skewAngle = -30; skewAngle <= 30.001; skewAngle += 0.1) {
+		int i0 = wrapIdx(b0);
+		int i1 = wrapIdx(b0 + 1);
+
+		if (i0 >= 0 && i0 < numBins) hist[i0] += v * (1.0 - f);
+		if (i1 >= 0 && i1 < numBins) hist[i1] += v * f;
+	}
+
+	// smooth with the Gaussian
+	std::vector<double> kernel(2 * sigmaBins + 1);
+	for (int k = -sigmaBins; k <= sigmaBins; k++) {
+		double d = k * angleBinWidth;
+		kernel[k + sigmaBins] = qExp(-0.5 * d * d / (sigma * sigma));
+	}
+
+	double maxSaliency = 0;
+	int maxIdx = -1;
+
+	for (int idx = pad; idx < pad + numRangeBins; idx++) {
 
 		double saliency = 0;
 
-		for (int i = 0; i < thrWeights.size(); i++) {
-			saliency += thrWeights.at(i).x() * qExp(-thrWeights.at(i).z()) * qExp(-0.5 * ((skewAngle - thrWeights.at(i).y()) * (skewAngle - thrWeights.at(i).y())) / (sigma * sigma));
+		for (int k = -sigmaBins; k <= sigmaBins; k++) {
+			int sIdx = wrapIdx(idx + k);
+			if (sIdx >= 0 && sIdx < numBins)
+				saliency += hist[sIdx] * kernel[k + sigmaBins];
 		}
 
-		saliencyVec.append(QPointF(skewAngle, saliency));
+		if (maxSaliency < saliency) {
+			maxSaliency = saliency;
+			maxIdx = idx;
+		}
 	}
 
-	//for (int i = 0; i < saliencyVec.size(); i++) qDebug() << saliencyVec.at(i);
+	if (maxIdx == -1) return 0;
 
-	double maxSaliency = 0;
-	double salSkewAngle = 0;
+	// refine the peak on the continuous saliency (Newton)
+	double salSkewAngle = binAngle(maxIdx);
+
+	for (int iter = 0; iter < 10; iter++) {
+
+		double d1 = 0;
+		double d2 = 0;
+
+		for (int i = 0; i < thrWeights.size(); i++) {
 
-	for (int i = 0; i < saliencyVec.size(); i++)  {
-		if (maxSaliency < saliencyVec.at(i).y()) {
-			maxSaliency = saliencyVec.at(i).y();
-			salSkewAngle = saliencyVec.at(i).x();
+			double d = salSkewAngle - thrWeights.at(i).y();
+			if (circular) d -= period * qRound(d / period);
+
+			double g = thrWeights.at(i).x() * qExp(-thrWeights.at(i).z()) * qExp(-0.5 * d * d / (sigma * sigma));
+			d1 += -g * d / (sigma * sigma);
+			d2 += g * (d * d / (sigma * sigma) - 1.0) / (sigma * sigma);
 		}
+
+		// not concave -> stay with the histogram's peak
+		if (d2 >= 0)
+			break;
+
+		double step = qBound(-angleBinWidth, -d1 / d2, angleBinWidth);
+		salSkewAngle += step;
+
+		if (qAbs(step) < 1e-5)
+			break;
 	}
 
-	for (int i = 0; i < weights.size(); i++)
-		if (weights.at(i).x() > eta && qAbs(weights.at(i).y() / M_PI * 180 - salSkewAngle) < 0.15)
-			selectedLineTypes.replace(i,1);
+	if (circular && salSkewAngle >= period * 0.5)
+		salSkewAngle -= period;
+
+	salSkewAngle = qBound(-range, salSkewAngle, range);
+
+	for (int i = 0; i < weights.size(); i++) {
 
-	if (maxSaliency == 0) return 0;
+		// compare on the circle - a line at 44.95 degree supports a skew of -44.95 degree
+		double d = weights.at(i).y() / M_PI * 180 - salSkewAngle;
+		d -= period * qRound(d / period);
+
+		if (weights.at(i).x() > eta && qAbs(d) < 0.15)
+			selectedLineTypes.replace(i,1);
+	}
 
 	return salSkewAngle;
 }
 
-QVector<QVector4D> DkSkewEstimator::getLines() {
+/**
+*	Enables the proxy estimation.
+*	@param proxySize the proxy's long side in px (0 -> full resolution)
+**/
+void DkSkewEstimator::setProxySize(int proxySize) {
 
-	return selectedLines;
+	this->proxySize = proxySize;
 }
 
-QVector<int> DkSkewEstimator::getLineTypes() {
+void DkSkewEstimator::setMaxSkewAngle(double maxSkewAngle) {
 
-	return selectedLineTypes;
+	this->maxSkewAngle = qBound(0.0, maxSkewAngle, 45.0);
 }
 
-
 };
@@ -27,14 +27,14 @@
 
 #pragma once
 
+#include <QAtomicInt>
 #include <QImage>
+#include <QPointF>
 #include <QtCore/qmath.h>
 #include <QtGlobal>
 #include <QVector3D>
 #include <QVector4D>
 #include <cmath>
-#include <QProgressDialog>
-#include <QWidget>
 #include <QDebug>
 
 // opencv
@@ -52,7 +52,25 @@
 
 namespace nmp {
 
+/**
+*	Result of the skew estimation.
+**/
+class DkSkewResult {
 
+public:
+	double angle = 0;				// skew angle in degree
+	QVector<QVector3D> weights;		// (weight, angle [rad], distance to the center) of all lines
+	QVector<QVector4D> lines;		// selected lines in image coordinates
+	QVector<int> lineTypes;			// 1 if a line supports the skew angle
+	bool canceled = false;
+};
+
+/**
+*	Estimates the skew of document images.
+*	The estimator does not depend on the GUI: progress (0-100) and
+*	cancellation are communicated through atomic flags which may be 
+*	polled from another thread.
+**/
 class DkSkewEstimator {
 
 public:
@@ -64,16 +82,22 @@ public:
 		dir_end,
 	};
 
-	DkSkewEstimator(QWidget* mainWin = 0);
+	DkSkewEstimator();
 	~DkSkewEstimator();
 
-	double getSkewAngle();
-	QVector<QVector4D> getLines();
-	QVector<int> getLineTypes();
-	void setImage(QImage inImage);
+	DkSkewResult compute(const cv::Mat& img, const QAtomicInt* canceled = 0, QAtomicInt* progress = 0);
+	void setMaxSkewAngle(double maxSkewAngle);
+	void setProxySize(int proxySize);
 
 private: 
-	cv::Mat computeSeparability(cv::Mat integral, cv::Mat integralSq, int direction);
+	DkSkewResult estimate(const cv::Mat& img);
+	double verifyAngle(const cv::Mat& img, const DkSkewResult& result, double s) const;
+	bool fitStrip(const cv::Mat& img, const QPointF& p1, const QPointF& p2, double s, double& angle) const;
+	void setImage(const cv::Mat& img);
+	bool isCanceled() const;
+	void setProgress(int val) const;
+
+	void computeSeparability(const cv::Mat& integral, const cv::Mat& integralSq, cv::Mat& separabilityHor, cv::Mat& separabilityVer);
 	cv::Mat computeEdgeMap(cv::Mat separability, double thr, int direction);
 	QVector<QVector3D> computeWeights(cv::Mat edgeMap, int direction);
 	double computeSkewAngle(QVector<QVector3D> weights, double imgDiagonal);
@@ -83,6 +107,11 @@ private:
 	QSize sepDims;
 	int delta;
 	double sigma;
+	double maxSkewAngle;	// the search range [-maxSkewAngle maxSkewAngle] in degree (max 45)
+	double angleBinWidth;	// bin width of the angle histogram in degree
+	int proxySize;			// long side of the proxy (0 -> full resolution)
+	int numVerifyStrips;	// max number of lines verified in full resolution
+	double verifyTolerance;	// max deviation (degree) of a verified line from the proxy's angle
 	double sepThr;
 	int epsilon;
 	int kMax;
@@ -91,10 +120,9 @@ private:
 	
 	QVector<QVector4D> selectedLines;
 	QVector<int> selectedLineTypes;
-	cv::Mat matImg;
 	int rotationFactor;
-	QProgressDialog* progress;
-	QWidget* mainWin;
+	const QAtomicInt* canceled;
+	QAtomicInt* progress;
 };
 
 };
@@ -0,0 +1,287 @@
+/*******************************************************************************************************
+ DkTransformPreview.cpp
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2014 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2014 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2014 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkTransformPreview.h"
+#include "DkAffineResampler.h"
+
+#include <QtConcurrentRun>
+#include <QtCore/qmath.h>
+
+#ifdef WITH_OPENCV
+
+#ifdef WIN32
+#pragma warning(disable: 4996)
+#endif
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#endif
+
+namespace nmp {
+
+/*-----------------------------------DkTransformPreview ---------------------------------------------*/
+
+DkTransformPreview::DkTransformPreview(QObject* parent) : QObject(parent) {
+
+	imgCacheKey = 0;
+	minLevelSize = 256;
+	renderPending = false;
+	renderValid = false;
+	generation = 0;
+	runningGeneration = 0;
+
+	connect(&renderWatcher, SIGNAL(finished()), this, SLOT(renderDone()));
+}
+
+DkTransformPreview::~DkTransformPreview() {
+
+	// the render thread only holds copies - but we should not leave it behind
+	renderWatcher.waitForFinished();
+}
+
+/**
+*	Builds the mip pyramid of img.
+*	All levels (except for the first) are converted to ARGB32_Premultiplied (or RGB32)
+*	and downsampled with area interpolation.
+*	@param img the image to be previewed
+**/
+void DkTransformPreview::setImage(const QImage& img) {
+
+	clear();
+
+	if (img.isNull())
+		return;
+
+	imgCacheKey = img.cacheKey();
+	levels << img;
+
+	QImage level = img;
+
+	if (level.format() != QImage::Format_RGB32 && level.format() != QImage::Format_ARGB32_Premultiplied)
+		level = level.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+	while (qMax(level.width(), level.height()) > minLevelSize) {
+
+		QImage next((level.width()+1)/2, (level.height()+1)/2, level.format());
+
+		cv::Mat src(level.height(), level.width(), CV_8UC4, (void*)level.constBits(), level.bytesPerLine());
+		cv::Mat dst(next.height(), next.width(), CV_8UC4, next.bits(), next.bytesPerLine());
+		cv::resize(src, dst, dst.size(), 0, 0, CV_INTER_AREA);
+
+		levels << next;
+		level = next;
+	}
+}
+
+/**
+*	Releases the pyramid and the rendered preview.
+**/
+void DkTransformPreview::clear() {
+
+	levels.clear();
+	imgCacheKey = 0;
+	generation++;		// a running render is dropped
+	renderPending = false;
+	renderValid = false;
+	renderedImg = QImage();
+	renderedTransform = QTransform();
+	renderedRect = QRect();
+}
+
+qint64 DkTransformPreview::cacheKey() const {
+
+	return imgCacheKey;
+}
+
+QSize DkTransformPreview::imageSize() const {
+
+	if (levels.empty())
+		return QSize();
+
+	return levels[0].size();
+}
+
+int DkTransformPreview::numLevels() const {
+
+	return levels.size();
+}
+
+/**
+*	Draws the preview with the painter's current transform.
+*	The painter's transform maps image coordinates to device coordinates.
+*	@param painter the viewport's painter
+*	@param interactive if true, the closest mip level is drawn without interpolation
+**/
+void DkTransformPreview::draw(QPainter* painter, bool interactive) {
+
+	if (levels.empty())
+		return;
+
+	QTransform t = painter->transform();
+	QRect viewRect = painter->device() ? QRect(0, 0, painter->device()->width(), painter->device()->height()) : QRect();
+
+	// the full quality preview is ready (it is null if the image is not visible)
+	if (!interactive && renderValid && renderedTransform == t && renderedRect == viewRect) {
+
+		if (!renderedImg.isNull()) {
+			painter->save();
+			painter->resetTransform();
+			painter->drawImage(renderedImg.offset(), renderedImg);
+			painter->restore();
+		}
+		return;
+	}
+
+	const QImage& level = levels[levelIdx(t, true)];
+
+	painter->save();
+	painter->setRenderHint(QPainter::SmoothPixmapTransform, !interactive);
+	painter->drawImage(QRectF(QPointF(), imageSize()), level);
+	painter->restore();
+
+	if (!interactive)
+		requestRender(t, viewRect);
+}
+
+/**
+*	Returns the mip level for the transform t.
+*	@param t the transform from image to device coordinates
+*	@param nearest if true, the closest level is returned - otherwise the coarsest level that is not coarser than the screen
+*	@return the mip level index
+**/
+int DkTransformPreview::levelIdx(const QTransform& t, bool nearest) const {
+
+	double scale = qSqrt(qAbs(t.determinant()));
+
+	if (scale <= 0 || scale >= 1.0)
+		return 0;
+
+	double l = qLn(1.0 / scale) / qLn(2.0);
+	int idx = nearest ? qRound(l) : qFloor(l);
+
+	return qBound(0, idx, levels.size()-1);
+}
+
+void DkTransformPreview::requestRender(const QTransform& t, const QRect& viewRect) {
+
+	// already rendering this frame (of the current image)
+	if (renderWatcher.isRunning() && runningGeneration == generation && runningTransform == t && runningRect == viewRect) {
+		renderPending = false;
+		return;
+	}
+
+	pendingTransform = t;
+	pendingRect = viewRect;
+	renderPending = true;
+
+	// coalesce: the latest request is started once the running render is finished
+	if (!renderWatcher.isRunning())
+		startRender();
+}
+
+void DkTransformPreview::startRender() {
+
+	renderPending = false;
+	runningTransform = pendingTransform;
+	runningRect = pendingRect;
+	runningGeneration = generation;
+
+	renderWatcher.setFuture(QtConcurrent::run(&DkTransformPreview::render, levels[levelIdx(runningTransform, false)], imageSize(), runningTransform, runningRect));
+}
+
+/**
+*	Takes over the finished render.
+*	A render that was started before the image changed (see clear) is dropped -
+*	otherwise the previous image's preview would be drawn at the same transform.
+*	Requests of the new image that arrived meanwhile are started right away.
+**/
+void DkTransformPreview::renderDone() {
+
+	// the image changed in the meantime
+	if (levels.empty() || runningGeneration != generation) {
+
+		if (!levels.empty() && renderPending)
+			startRender();
+		return;
+	}
+
+	renderedImg = renderWatcher.result();
+	renderValid = true;
+	renderedTransform = runningTransform;
+	renderedRect = runningRect;
+
+	if (renderPending)
+		startRender();
+	else
+		emit renderFinished();
+}
+
+/**
+*	Renders the level with bilinear interpolation.
+*	Only the visible part (viewRect) is rendered. This function runs in a worker thread.
+*	@param level the mip level
+*	@param imgSize the size of the (full resolution) image
+*	@param t the transform from image to device coordinates
+*	@param viewRect the device's rect
+*	@return the rendered preview, its offset is the position in device coordinates
+**/
+QImage DkTransformPreview::render(const QImage& level, const QSize& imgSize, const QTransform& t, const QRect& viewRect) {
+
+	// the level's pixels -> device
+	QTransform lt = QTransform::fromScale((double)imgSize.width()/level.width(), (double)imgSize.height()/level.height()) * t;
+
+	if (DkAffineResampler::isSupported(level)) {
+
+		QRect dstRect = lt.mapRect(QRectF(level.rect())).toAlignedRect() & viewRect;
+
+		if (dstRect.isEmpty())
+			return QImage();
+
+		// the corners are filled white by the viewport (rotation & shear)
+		DkAffineResampler resampler(DkAffineResampler::interpolation_bilinear);
+		QImage img = resampler.warp(level, lt, dstRect);
+		img.setOffset(dstRect.topLeft());
+
+		if (!img.isNull())
+			return img;
+	}
+
+	QImage img(viewRect.size(), QImage::Format_ARGB32_Premultiplied);
+	img.setOffset(viewRect.topLeft());
+	img.fill(Qt::transparent);
+
+	QPainter painter(&img);
+	painter.setRenderHints(QPainter::SmoothPixmapTransform | QPainter::Antialiasing);
+	painter.setTransform(t * QTransform::fromTranslate(-viewRect.x(), -viewRect.y()));
+	painter.drawImage(QRectF(QPointF(), imgSize), level);
+	painter.end();
+
+	return img;
+}
+
+};
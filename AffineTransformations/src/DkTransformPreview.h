@@ -0,0 +1,93 @@
+/*******************************************************************************************************
+ DkTransformPreview.h
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2014 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2014 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2014 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#include <QFutureWatcher>
+#include <QImage>
+#include <QObject>
+#include <QPainter>
+#include <QTransform>
+#include <QVector>
+
+namespace nmp {
+
+/**
+*	Preview cache of the affine transformations viewport.
+*	It keeps a mip pyramid of the current image which is built once when the plugin is opened.
+*	While the user drags a handle, frames are drawn from the mip level that is closest to the 
+*	screen resolution (nearest neighbor). Otherwise, the finer mip level is rendered with bilinear
+*	interpolation in a background thread and replaces the preview as soon as it is ready.
+**/
+class DkTransformPreview : public QObject {
+	Q_OBJECT
+
+public:
+	DkTransformPreview(QObject* parent = 0);
+	~DkTransformPreview();
+
+	void setImage(const QImage& img);
+	void clear();
+
+	qint64 cacheKey() const;
+	QSize imageSize() const;
+	int numLevels() const;
+
+	void draw(QPainter* painter, bool interactive);
+
+signals:
+	void renderFinished();
+
+protected slots:
+	void renderDone();
+
+protected:
+	int levelIdx(const QTransform& t, bool nearest) const;
+	void requestRender(const QTransform& t, const QRect& viewRect);
+	void startRender();
+	static QImage render(const QImage& level, const QSize& imgSize, const QTransform& t, const QRect& viewRect);
+
+	QVector<QImage> levels;		// levels[0] is the image, each level halves its predecessor
+	qint64 imgCacheKey;
+	int minLevelSize;			// long side of the coarsest level
+
+	// background rendering
+	QFutureWatcher<QImage> renderWatcher;
+	QImage renderedImg;			// full quality preview (its offset is the position in device coordinates)
+	QTransform renderedTransform;
+	QRect renderedRect;
+	QTransform pendingTransform;
+	QRect pendingRect;
+	QTransform runningTransform;
+	QRect runningRect;
+	bool renderPending;
+	bool renderValid;
+	int generation;				// incremented whenever the pyramid is released
+	int runningGeneration;
+};
+
+};
@@ -0,0 +1,84 @@
+/*******************************************************************************************************
+ main.cpp
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2015 Markus Diem
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkLineDetectionBatch.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+
+int main(int argc, char** argv) {
+
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("lineDetectionBatch");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Detects the lower and upper text lines of document images and saves them as masks or polylines.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("paths", "Images or directories to be processed.", "[paths...]");
+
+	QCommandLineOption modeOpt(QStringList() << "m" << "mode", "masks (default, <name>-lower.png & <name>-upper.png) or polylines (<name>-lines.json).", "mode", "masks");
+	QCommandLineOption outputOpt(QStringList() << "o" << "output", "Output directory (default: next to the input images).", "dir");
+	QCommandLineOption threadsOpt(QStringList() << "t" << "threads", "Number of worker threads (default: ideal thread count).", "n", "0");
+	QCommandLineOption stripeOpt("stripe-length", "Word length in pixel (default: 1/7 of the image width).", "px", "0");
+	QCommandLineOption lineHeightOpt("line-height", "Line height in pixel (default: 1/50 of the image height).", "px", "0");
+	QCommandLineOption noOptimizeOpt("no-optimize", "Do not optimize the line images.");
+
+	parser.addOption(modeOpt);
+	parser.addOption(outputOpt);
+	parser.addOption(threadsOpt);
+	parser.addOption(stripeOpt);
+	parser.addOption(lineHeightOpt);
+	parser.addOption(noOptimizeOpt);
+	parser.process(app);
+
+	QStringList files = nmp::DkLineDetectionBatch::collectImages(parser.positionalArguments());
+
+	if (files.isEmpty()) {
+		qWarning() << "no images found";
+		parser.showHelp(1);
+	}
+
+	QString modeName = parser.value(modeOpt);
+
+	if (modeName != "masks" && modeName != "polylines") {
+		qWarning() << "unknown mode:" << modeName;
+		parser.showHelp(1);
+	}
+
+	nmp::DkLineDetectionBatch::Mode mode = modeName == "polylines" ?
+		nmp::DkLineDetectionBatch::mode_polylines :
+		nmp::DkLineDetectionBatch::mode_masks;
+
+	nmp::DkLineDetectionBatch batch(mode);
+	batch.setOutputDir(parser.value(outputOpt));
+	batch.setNumThreads(parser.value(threadsOpt).toInt());
+	batch.setStripeLength(parser.value(stripeOpt).toInt());
+	batch.setLineHeight(parser.value(lineHeightOpt).toInt());
+	batch.setOptimize(!parser.isSet(noOptimizeOpt));
+
+	nmp::DkLineDetectionBatchStats stats = batch.compute(files);
+
+	return stats.numFailed > 0 ? 1 : 0;
+}
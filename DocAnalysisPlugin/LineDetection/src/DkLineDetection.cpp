@@ -27,56 +27,294 @@
 
 #include "DkLineDetection.h"
 #include <time.h>
-#include <QPushButton>
-#include <QMessageBox>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <sstream>
 
 namespace nmp {
 
-// class: DkLineDetection start
+/**
+* Computes the local projection profile of a band of rows.
+* Each row is a streaming pass: the window sum is kept in an int (on the 8-bit image)
+* and written (normalized to [0 1] pixel values) as float.
+**/
+class DkProjectionProfileKernel : public cv::ParallelLoopBody {
+
+public:
+	DkProjectionProfileKernel(const cv::Mat& image, cv::Mat& lpp, int stripeLength, int halfStripeLength) :
+		image(image), lpp(lpp), stripeLength(stripeLength), halfStripeLength(halfStripeLength) {};
+
+	void operator()(const cv::Range& range) const override {
+
+		const float norm = 1.0f/255.0f;
+		int cols = image.cols;
+
+		for (int y = range.start; y < range.end; y++) {
+
+			const uchar* src = image.ptr<uchar>(y);
+			float* dst = lpp.ptr<float>(y);
+
+			// LPP of the first stripe
+			int sum = 0;
+			for (int i = 0; i < std::min(stripeLength, cols); i++)
+				sum += src[i];
+
+			if (halfStripeLength < cols)
+				dst[halfStripeLength] = sum*norm;
+
+			// now add most right column and subract most left - dynamic programming
+			for (int i = halfStripeLength+1; i < cols-halfStripeLength; i++) {
+				sum += src[i+halfStripeLength] - src[i-halfStripeLength-1];
+				dst[i] = sum*norm;
+			}
+		}
+	};
+
+protected:
+	const cv::Mat& image;
+	cv::Mat& lpp;
+	int stripeLength;
+	int halfStripeLength;
+};
 
 /**
-* Creates a new instance of the tool for detecting lines within an image
-* with default parameters
+* Finds the local extrema along the columns of the filtered LPP and performs the
+* non extrema suppression for a block of columns at once.
+* The block's columns are contiguous in memory, hence all operations run row by row
+* over the whole block (and are vectorized by the compiler). The maximum (minimum) within
+* the suppression window is computed with the van Herk/Gil-Werman algorithm (3 comparisons
+* per pixel independent of the window size).
+* The results are identical to the former per-column filter2D + nonExtremaSuppression.
 **/
+class DkExtremaKernel : public cv::ParallelLoopBody {
 
-bool SetWindow(int Width, int Height) 
-    { 
-    _COORD coord; 
-    coord.X = Width; 
-    coord.Y = Height; 
-
-    _SMALL_RECT Rect; 
-    Rect.Top = 0; 
-    Rect.Left = 0; 
-    Rect.Bottom = Height - 1; 
-    Rect.Right = Width - 1; 
-
-    // Get handle of the standard output 
-    HANDLE Handle = GetStdHandle(STD_OUTPUT_HANDLE); 
-    if (Handle == NULL) 
-        { 
-        std::cout<<"Failure in getting the handle\n"<<GetLastError(); 
-        return FALSE; 
-        } 
-     
-    // Set screen buffer size to that specified in coord 
-    if(!SetConsoleScreenBufferSize(Handle, coord)) 
-        { 
-        std::cout<<"Failure in setting buffer size\n"<<GetLastError(); 
-        return FALSE; 
-        } 
-
-    // Set the window size to that specified in Rect 
-    if(!SetConsoleWindowInfo(Handle, TRUE, &Rect)) 
-        { 
-        std::cout<<"Failure in setting window size\n"<<GetLastError(); 
-        return FALSE; 
-        } 
-
-    return TRUE; 
-} 
+public:
+	DkExtremaKernel(const cv::Mat& filtered, cv::Mat& maxima, cv::Mat& minima, int radius, float maxThresh, int blockWidth) :
+		filtered(filtered), maxima(maxima), minima(minima), radius(radius), maxThresh(maxThresh), blockWidth(blockWidth) {};
+
+	void operator()(const cv::Range& range) const override {
+
+		int rows = filtered.rows;
+		int paddedRows = rows + 2*radius;
+
+		std::vector<float> gMax(paddedRows*blockWidth), hMax(paddedRows*blockWidth);
+		std::vector<float> gMin(paddedRows*blockWidth), hMin(paddedRows*blockWidth);
+
+		for (int bIdx = range.start; bIdx < range.end; bIdx++) {
+
+			int c0 = bIdx*blockWidth;
+			int bw = std::min(c0 + blockWidth, filtered.cols) - c0;
+
+			runningExtrema(c0, bw, gMax, hMax, gMin, hMin);
+
+			for (int y = 0; y < rows; y++) {
+
+				const float* h = filtered.ptr<float>(y) + c0;
+				const float* hPrev = (y > 0) ? filtered.ptr<float>(y-1) + c0 : 0;
+				const float* hNext = (y < rows-1) ? filtered.ptr<float>(y+1) + c0 : 0;
+
+				// the window [y-radius, y+radius] starts at the padded index y
+				const float* hMaxPtr = &hMax[y*bw];
+				const float* gMaxPtr = &gMax[(y+2*radius)*bw];
+				const float* hMinPtr = &hMin[y*bw];
+				const float* gMinPtr = &gMin[(y+2*radius)*bw];
+
+				uchar* maxPtr = maxima.ptr<uchar>(y) + c0;
+				uchar* minPtr = minima.ptr<uchar>(y) + c0;
+
+				for (int x = 0; x < bw; x++) {
+
+					// signs of the forward differences (0 at the borders)
+					int sPrev = hPrev ? (h[x] > hPrev[x]) - (h[x] < hPrev[x]) : 0;
+					int sCur = hNext ? (hNext[x] > h[x]) - (hNext[x] < h[x]) : 0;
+					int e = sPrev - sCur;
+
+					uchar isMax = 0, isMin = 0;
+
+					if (e > 0) {
+						float maxVal = std::max(hMaxPtr[x], gMaxPtr[x]);
+						isMax = (maxVal > h[x] || h[x] < maxThresh) ? 0 : 255;
+					}
+					else if (e < 0) {
+						float minVal = std::min(hMinPtr[x], gMinPtr[x]);
+						isMin = (minVal < h[x]) ? 0 : 255;
+					}
+
+					maxPtr[x] = isMax;
+					minPtr[x] = isMin;
+				}
+			}
+		}
+	};
+
+protected:
+	const cv::Mat& filtered;
+	cv::Mat& maxima;
+	cv::Mat& minima;
+	int radius;
+	float maxThresh;
+	int blockWidth;
+
+	/**
+	* van Herk/Gil-Werman: computes the prefix (g) and suffix (h) extrema of blocks
+	* with the window size. The columns are padded with radius -inf (+inf) values.
+	**/
+	void runningExtrema(int c0, int bw, std::vector<float>& gMax, std::vector<float>& hMax, std::vector<float>& gMin, std::vector<float>& hMin) const {
+
+		const float inf = std::numeric_limits<float>::infinity();
+		int rows = filtered.rows;
+		int paddedRows = rows + 2*radius;
+		int w = 2*radius+1;
+
+		for (int j = 0; j < paddedRows; j++) {
+
+			bool pad = j < radius || j >= rows + radius;
+			const float* v = pad ? 0 : filtered.ptr<float>(j-radius) + c0;
+			float* gMaxPtr = &gMax[j*bw];
+			float* gMinPtr = &gMin[j*bw];
+
+			if (j % w == 0) {
+				for (int x = 0; x < bw; x++) {
+					gMaxPtr[x] = pad ? -inf : v[x];
+					gMinPtr[x] = pad ? inf : v[x];
+				}
+			}
+			else {
+				for (int x = 0; x < bw; x++) {
+					gMaxPtr[x] = pad ? gMaxPtr[x-bw] : std::max(gMaxPtr[x-bw], v[x]);
+					gMinPtr[x] = pad ? gMinPtr[x-bw] : std::min(gMinPtr[x-bw], v[x]);
+				}
+			}
+		}
+
+		for (int j = paddedRows-1; j >= 0; j--) {
+
+			bool pad = j < radius || j >= rows + radius;
+			const float* v = pad ? 0 : filtered.ptr<float>(j-radius) + c0;
+			float* hMaxPtr = &hMax[j*bw];
+			float* hMinPtr = &hMin[j*bw];
+
+			if (j % w == w-1 || j == paddedRows-1) {
+				for (int x = 0; x < bw; x++) {
+					hMaxPtr[x] = pad ? -inf : v[x];
+					hMinPtr[x] = pad ? inf : v[x];
+				}
+			}
+			else {
+				for (int x = 0; x < bw; x++) {
+					hMaxPtr[x] = pad ? hMaxPtr[x+bw] : std::max(hMaxPtr[x+bw], v[x]);
+					hMinPtr[x] = pad ? hMinPtr[x+bw] : std::min(hMinPtr[x+bw], v[x]);
+				}
+			}
+		}
+	};
+};
+
+// class: DkTextLineIndex start
+
+DkTextLineIndex::DkTextLineIndex(int cellSize) {
 
+	this->cellSize = std::max(cellSize, 1);
+	gridCols = 0;
+	gridRows = 0;
+}
+
+/**
+* Sets the text lines and bins them into the grid.
+* @param lines the polylines (pixel coordinates as traced from a mask)
+* @param imgSize the size of the image the lines were traced from
+**/
+void DkTextLineIndex::setPolylines(const std::vector<std::vector<cv::Point> >& lines, const cv::Size& imgSize) {
+
+	clear();
+
+	gridCols = std::max(cvCeil((double)imgSize.width / cellSize), 1);
+	gridRows = std::max(cvCeil((double)imgSize.height / cellSize), 1);
+	cells.resize(gridCols*gridRows);
+
+	for (size_t idx = 0; idx < lines.size(); idx++) {
+
+		// pixel centres
+		QPolygonF poly;
+		for (size_t pIdx = 0; pIdx < lines[idx].size(); pIdx++)
+			poly << QPointF(lines[idx][pIdx].x + 0.5, lines[idx][pIdx].y + 0.5);
+
+		// pad the bounding box - it is empty for straight lines
+		QRectF bb = poly.boundingRect().adjusted(-1, -1, 1, 1);
+
+		int c0 = std::max(cvFloor(bb.left() / cellSize), 0);
+		int c1 = std::min(cvFloor(bb.right() / cellSize), gridCols-1);
+		int r0 = std::max(cvFloor(bb.top() / cellSize), 0);
+		int r1 = std::min(cvFloor(bb.bottom() / cellSize), gridRows-1);
+
+		for (int r = r0; r <= r1; r++) {
+			for (int c = c0; c <= c1; c++)
+				cells[r*gridCols+c] << polylines.size();
+		}
+
+		polylines << poly;
+		bounds << bb;
+	}
+}
+
+void DkTextLineIndex::clear() {
+
+	polylines.clear();
+	bounds.clear();
+	cells.clear();
+	gridCols = 0;
+	gridRows = 0;
+}
+
+/**
+* Returns the text lines whose bounding boxes intersect a region.
+* @param rect the region (image coordinates)
+* @returns the indices of the text lines
+**/
+QVector<int> DkTextLineIndex::intersecting(const QRectF& rect) const {
+
+	QVector<int> result;
+
+	if (polylines.isEmpty() || rect.isEmpty())
+		return result;
 
+	int c0 = std::max(cvFloor(rect.left() / cellSize), 0);
+	int c1 = std::min(cvFloor(rect.right() / cellSize), gridCols-1);
+	int r0 = std::max(cvFloor(rect.top() / cellSize), 0);
+	int r1 = std::min(cvFloor(rect.bottom() / cellSize), gridRows-1);
+
+	// a line is binned into all cells it overlaps - report it once
+	std::vector<bool> visited(polylines.size(), false);
+
+	for (int r = r0; r <= r1; r++) {
+		for (int c = c0; c <= c1; c++) {
+
+			const QVector<int>& cell = cells[r*gridCols+c];
+
+			for (int idx = 0; idx < cell.size(); idx++) {
+
+				int lIdx = cell[idx];
+
+				if (!visited[lIdx] && bounds[lIdx].intersects(rect))
+					result << lIdx;
+				visited[lIdx] = true;
+			}
+		}
+	}
+
+	return result;
+}
+
+// class: DkTextLineIndex end
+
+// class: DkLineDetection start
+
+/**
+* Creates a new instance of the tool for detecting lines within an image
+* with default parameters
+**/
 DkLineDetection::DkLineDetection() {
 	
 	params.stripeLength = 300;
@@ -86,16 +324,18 @@ DkLineDetection::DkLineDetection() {
 	params.maxThresh = 0.15f;
 	params.alpha = 0.50f;
 	params.optimizeImage = true;
+	params.sobelFilterX = 1;
+	params.sobelFilterY = 0;
+	params.sobelFilterSize = 3;
 	params.boxFilterSizeX = 70;
 	params.boxFilterSizeY = 70;
+	params.removeShort = 1;
 	params.rescale = 1.0f;
 
 	hasLines = false;
 	recalc = true;
 
 	debug = false;
-
-	SetWindow(1024, 900);
 }
 
 DkLineDetection::~DkLineDetection() {
@@ -136,11 +376,9 @@ void DkLineDetection::setParameters(int stripeWidth, int nonExtrKernelSize, bool
 									bool sobelX, bool sobelY, int sobelKernelSize,
 									int boxFilterSizeX, int boxFilterSizeY, int removeShort/*, float rescale*/) {
 	
-	if(stripeWidth == params.stripeLength && nonExtrKernelSize == params.nonExtremaKernelSize) {
-		recalc = false;
-	} else {
+	// the LPP & extrema only depend on these two - a new image forces recalculation anyway
+	if(stripeWidth != params.stripeLength || nonExtrKernelSize != params.nonExtremaKernelSize)
 		recalc = true;
-	}
 	
 	params.stripeLength = stripeWidth;
 	params.halfStripeLength = (int)(params.stripeLength/2);
@@ -156,6 +394,18 @@ void DkLineDetection::setParameters(int stripeWidth, int nonExtrKernelSize, bool
 	//params.rescale = rescale;
 }
 
+/**
+* Sets the default parameters for the current image.
+* These are the defaults of the DkLineDetectionDialog: the stripe length is 1/7 of the
+* image width and the non-extrema kernel size (line height) is 1/50 of the image height.
+* \sa setImage(cv::Mat img)
+**/
+void DkLineDetection::setDefaultParameters() {
+
+	setParameters(image.cols/7, image.rows/50, true, true, false, 3, 
+		std::min(70, image.cols), std::min(50, image.rows), 1);
+}
+
 /**
 * DEBUG
 * @returns The type of the image as string
@@ -215,18 +465,20 @@ void DkLineDetection::setImage(cv::Mat image) {
 	if(this->image.channels() > 1)
 		cv::cvtColor(this->image, this->image, CV_BGR2GRAY);
 
-
-	this->image.convertTo(this->image, CV_64F);
-	// noramlize image to range 0...1
-	this->image = this->image / 255;
+	// the image is kept as 8-bit - the LPP normalizes the pixel values to 0...1
+	if (this->image.depth() != CV_8U)
+		this->image.convertTo(this->image, CV_8U);
 	//std::cout << "Image Type: " << this->getImageType(this->image.type()) << std::endl;
 
-	lpp_image = cv::Mat::zeros(image.rows, image.cols, CV_64F);
+	lpp_image = cv::Mat::zeros(image.rows, image.cols, CV_32F);
 	lowerTextLines = cv::Mat::zeros(image.rows, image.cols, CV_8UC1);
 	upperTextLines = cv::Mat::zeros(image.rows, image.cols, CV_8UC1);
 
 	hasLines = false;
 	recalc = true;
+	cache = stageCache();
+	bottomLines.clear();
+	topLines.clear();
 	//std::cout << "LPP Image Type: " << this->getImageType(lpp_image.type()) << std::endl;
 }
 
@@ -238,35 +490,15 @@ cv::Mat DkLineDetection::getImage() {
 }
 
 /**
-* Creates Qt images out of the Open CV matrix text line masks by creating
-* images with alpha channel.
+* Traces the text line masks as polylines and indexes them.
+* This is done once per detection - drawing then only needs the polylines
+* intersecting the visible region.
 * \sa bottomLines topLines
 **/
-void DkLineDetection::createTextLineImages() {
-
-	std::vector<cv::Mat> ImgChannels;
-	cv::Mat imgUC4;
-	
-	// bottom text lines
-	ImgChannels.push_back(lowerTextLines.clone()*0);
-	ImgChannels.push_back(lowerTextLines.clone());
-	ImgChannels.push_back(lowerTextLines.clone()*0);
-	ImgChannels.push_back(lowerTextLines.clone()*params.alpha);
-
-	cv::merge(ImgChannels, imgUC4);
-
-	bottomLines = nmc::DkImage::mat2QImage(imgUC4);
-
-	// top text lines
-	ImgChannels.clear();
-	ImgChannels.push_back(upperTextLines.clone()*0);
-	ImgChannels.push_back(upperTextLines.clone()*0);
-	ImgChannels.push_back(upperTextLines.clone());
-	ImgChannels.push_back(upperTextLines.clone()*params.alpha);
+void DkLineDetection::traceTextLines() {
 
-	cv::merge(ImgChannels, imgUC4);
-
-	topLines = nmc::DkImage::mat2QImage(imgUC4);
+	bottomLines.setPolylines(tracePolylines(lowerTextLines), lowerTextLines.size());
+	topLines.setPolylines(tracePolylines(upperTextLines), upperTextLines.size());
 }
 
 /**
@@ -284,7 +516,7 @@ void DkLineDetection::startLineDetection() {
 	if(recalc) {
 
 		// reset the images
-		lpp_image = cv::Mat::zeros(image.rows, image.cols, CV_64F);
+		lpp_image = cv::Mat::zeros(image.rows, image.cols, CV_32F);
 		lowerTextLines = cv::Mat::zeros(image.rows, image.cols, CV_8UC1);
 		upperTextLines = cv::Mat::zeros(image.rows, image.cols, CV_8UC1);
 		hasLines = false;
@@ -317,23 +549,38 @@ void DkLineDetection::startLineDetection() {
 		// without having to recalculate everything
 		basicLowerTextLines = lowerTextLines.clone();
 		basicUpperTextLines = upperTextLines.clone();
+		cache.basicVersion = ++cache.version;
+		recalc = false;
 	}
 
+	int linesVersion = cache.basicVersion;
+
 	// optimize the line image (clear borders)
 	if (params.optimizeImage) {
 		//const clock_t begin_time = clock();
 		
-		lowerTextLines = basicLowerTextLines.clone();
-		upperTextLines = basicUpperTextLines.clone();
-		// optimize the text line images
+		lowerTextLines = basicLowerTextLines;
+		upperTextLines = basicUpperTextLines;
+		// optimize the text line images (only the stages whose parameters changed are recomputed)
 		optimizeLineImg(&image, &lowerTextLines, &upperTextLines);
+		linesVersion = cache.linesVersion;
 
 		//std::cout << "Duration for optimization: " << float( clock () - begin_time ) /  CLOCKS_PER_SEC << std::endl;
 
 	}
+	else {
+		lowerTextLines = basicLowerTextLines;
+		upperTextLines = basicUpperTextLines;
+	}
+
+	// nothing changed since the last call
+	if (linesVersion == cache.outputVersion)
+		return;
 
-	// create a Qt image with transparency
-	createTextLineImages();
+	cache.outputVersion = linesVersion;
+
+	// trace the text lines as polylines
+	traceTextLines();
 
 	/*cv::namedWindow( "Step 3: Optimization", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
 	cv::imshow( "Step 3: Optimization", lowerTextLines);*/
@@ -353,23 +600,13 @@ void DkLineDetection::startLineDetection() {
 /**
 * Calculates the local projection profile of the current image using stripeLength.
 * It is calculated by summing up the pixel values along each row within each stripe.
+* The rows are processed in parallel (one streaming pass per row).
 * \sa parameters::stripeLength
 **/
 void DkLineDetection::calcLocalProjectionProfile() {
 
-	// calc LPP for the first stripe
-	for(int i = 0; i < params.stripeLength; i++) {
-
-		add(lpp_image.col(params.halfStripeLength), image.col(i), lpp_image.col(params.halfStripeLength));
-	}
-
-
-	// now add most right column and subract most left - dynamic programming
-	for(int i = params.halfStripeLength+1; i < image.cols-params.halfStripeLength; i++) {
-
-		subtract(image.col(i+params.halfStripeLength), image.col(i-params.halfStripeLength-1), lpp_image.col(i));
-		add(lpp_image.col(i-1), lpp_image.col(i), lpp_image.col(i));
-	}
+	cv::parallel_for_(cv::Range(0, image.rows), 
+		DkProjectionProfileKernel(image, lpp_image, params.stripeLength, params.halfStripeLength));
 }
 
 /**
@@ -398,7 +635,7 @@ void DkLineDetection::findLocalMinima() {
 
 	cv::Mat filtered;
 	// filter with kernel
-	cv::filter2D(lpp_image, filtered, CV_64FC1, kernel, cv::Point(-1,-1), 0.0, cv::BORDER_REPLICATE); 
+	cv::filter2D(lpp_image, filtered, CV_32FC1, kernel, cv::Point(-1,-1), 0.0, cv::BORDER_REPLICATE); 
 
 	if (debug) {
 			debugOutputMat(&filtered, "lpp_image filtered with gaussian derivative");
@@ -410,9 +647,6 @@ void DkLineDetection::findLocalMinima() {
 			//cv::imshow( "lpp_image filtered with gaussian derivative", filtered);
 	}
 
-	cv::Mat histogram, extrHist, maxima, minima;
-	cv::Mat diffkernel = (cv::Mat_<double>(2,1) << -1, 1);
-	cv::Mat sxkernel = (cv::Mat_<double>(2,1) << 1, -1);
 	/*
 	if (debug)
 			debugOutputMat(&diffkernel, "diffkernel");
@@ -482,28 +716,15 @@ void DkLineDetection::findLocalMinima() {
 
 	const clock_t begin_time_o = clock();
 	//} else { // old 1d approach*/
-	for(int i=0; i<filtered.cols; i++) {
-		
-		// compute extrema in "histogram"
-		histogram = filtered.col(i);
-		cv::filter2D(histogram, extrHist, CV_64FC1, diffkernel, cv::Point(0,0), 0.0, cv::BORDER_REPLICATE);
-
-		extrHist.setTo(-1, extrHist < 0);
-		extrHist.setTo(1, extrHist > 0);
-
-		cv::filter2D(extrHist, extrHist, CV_64FC1, sxkernel, cv::Point(0,1), 0.0, cv::BORDER_CONSTANT);
-
-		// now find local maxima and minima
-		maxima = extrHist > 0;
-		minima = extrHist < 0;
-
-		// maxima and minima are the same as before... no need to recalc all of those steps
-
-		nonExtremaSuppression(&histogram, &maxima, &minima);
-
-		minima.copyTo(lowerTextLines.col(i));
-		maxima.copyTo(upperTextLines.col(i));
+	findExtrema(filtered, lowerTextLines, upperTextLines);
 
+	if (debug) {
+		// the old 1D approach is the reference
+		cv::Mat lower = cv::Mat::zeros(filtered.size(), CV_8UC1);
+		cv::Mat upper = cv::Mat::zeros(filtered.size(), CV_8UC1);
+		findExtrema1D(filtered, lower, upper);
+		compareMat(lower, lowerTextLines, "diff lower");
+		compareMat(upper, upperTextLines, "diff upper");
 	}
 	//std::cout << "Duration for 1D approach: " <<  float( clock () - begin_time_o ) /  CLOCKS_PER_SEC << std::endl;
 
@@ -528,6 +749,60 @@ void DkLineDetection::findLocalMinima() {
 			debugOutputMat(&upperTextLines, "upperTextLines");
 }
 
+/**
+* Finds the local minima (lower text lines) and maxima (upper text lines) of each column
+* of the filtered LPP and suppresses non extrema. All columns are processed at once.
+* @param filtered The LPP filtered with the gaussian derivative (CV_32FC1)
+* @param lower The lower text lines (CV_8UC1, 255 at minima)
+* @param upper The upper text lines (CV_8UC1, 255 at maxima)
+* \sa findExtrema1D(const cv::Mat& filtered, cv::Mat& lower, cv::Mat& upper)
+**/
+void DkLineDetection::findExtrema(const cv::Mat& filtered, cv::Mat& lower, cv::Mat& upper) {
+
+	int blockWidth = 64;
+	int numBlocks = (filtered.cols + blockWidth - 1) / blockWidth;
+
+	cv::parallel_for_(cv::Range(0, numBlocks), DkExtremaKernel(filtered, upper, lower, 
+		(int)params.nonExtremaKernelSize/2, params.maxThresh, blockWidth));
+}
+
+/**
+* Reference implementation of findExtrema - one column after the other.
+* @param filtered The LPP filtered with the gaussian derivative (CV_32FC1)
+* @param lower The lower text lines (CV_8UC1, 255 at minima)
+* @param upper The upper text lines (CV_8UC1, 255 at maxima)
+**/
+void DkLineDetection::findExtrema1D(const cv::Mat& filtered, cv::Mat& lower, cv::Mat& upper) {
+
+	cv::Mat histogram, extrHist, maxima, minima;
+	cv::Mat diffkernel = (cv::Mat_<double>(2,1) << -1, 1);
+	cv::Mat sxkernel = (cv::Mat_<double>(2,1) << 1, -1);
+
+	for(int i=0; i<filtered.cols; i++) {
+		
+		// compute extrema in "histogram"
+		histogram = filtered.col(i);
+		cv::filter2D(histogram, extrHist, CV_64FC1, diffkernel, cv::Point(0,0), 0.0, cv::BORDER_REPLICATE);
+
+		extrHist.setTo(-1, extrHist < 0);
+		extrHist.setTo(1, extrHist > 0);
+
+		cv::filter2D(extrHist, extrHist, CV_64FC1, sxkernel, cv::Point(0,1), 0.0, cv::BORDER_CONSTANT);
+
+		// now find local maxima and minima
+		maxima = extrHist > 0;
+		minima = extrHist < 0;
+
+		// maxima and minima are the same as before... no need to recalc all of those steps
+
+		nonExtremaSuppression(&histogram, &maxima, &minima);
+
+		minima.copyTo(lower.col(i));
+		maxima.copyTo(upper.col(i));
+
+	}
+}
+
 bool DkLineDetection::compareMat(cv::Mat in1, cv::Mat in2, std::string text) {
     cv::Mat diff;
 
@@ -720,7 +995,7 @@ void DkLineDetection::nonExtremaSuppression(cv::Mat *histogram, cv::Mat *maxima,
 		// extract neighborhood
 		neighborhood = (*histogram)(cv::Range(idx1,idx2+1),cv::Range(0,1));
 		// extract the current value
-		double hist_val = histogram->at<double>(i,0);
+		double hist_val = histogram->at<float>(i,0);
 
 		if((int)row_max[0] != 0) {
 			
@@ -788,130 +1063,133 @@ void DkLineDetection::nonExtremaSuppression(cv::Mat *histogram, cv::Mat *maxima,
 * Text lines are only considered where the algorithm recognized vertical and horizontal edges
 * (which should correspond to text regions).
 * This procedure should eliminate most of the text lines detected at image corners.
+* The stages (edge maps, text regions, optimized lines) are cached: a stage is only
+* recomputed if its parameters or one of its inputs changed.
 * @param segLineImg Pointer to the original image used for line detection
 * @param lowertextLineImg Pointer to the basic calculated lower text line img mask (as CV_8UC1)
 * @param uppertextLineImg Pointer to the basic calculated upper text line img (as CV_8UC1)
+* \sa stageCache
 **/
 void DkLineDetection::optimizeLineImg(cv::Mat *segLineImg,cv::Mat *lowertextLineImg, cv::Mat*uppertextLineImg) {
 	
-	// estimate text regions
-	cv::Mat intImg = cv::Mat(segLineImg->rows+1, segLineImg->cols+1, CV_64FC1);
-
-	cv::Mat filtered_gradX(segLineImg->rows, segLineImg->cols, segLineImg->type());
-	cv::Mat filtered_gradY(segLineImg->rows, segLineImg->cols, segLineImg->type());
-	if(params.sobelFilterX)
-		cv::Sobel(*segLineImg, filtered_gradX, segLineImg->depth(), params.sobelFilterX, /*params.sobelFilterY*/0, params.sobelFilterSize);
-	if(params.sobelFilterY)
-		cv::Sobel(*segLineImg, filtered_gradY, segLineImg->depth(), /*params.sobelFilterX*/0, params.sobelFilterY, params.sobelFilterSize);
-
-	/*cv::namedWindow( "Sobel - X", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
-	cv::imshow( "Sobel - X", filtered_gradX);*/
-
-	if(params.sobelFilterX) {
-		filtered_gradX = cv::abs(filtered_gradX);
-		normalize(filtered_gradX, filtered_gradX, 1.0f, 0.0f, cv::NORM_MINMAX);
-	}
-	if(params.sobelFilterY) {
-		filtered_gradY = cv::abs(filtered_gradY);
-		normalize(filtered_gradY, filtered_gradY, 1.0f, 0.0f, cv::NORM_MINMAX);
-	}
-	/*cv::namedWindow( "normalized sobel", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
-	cv::imshow( "normalized sobel", filtered_gradX);*/
+	edgeParameters ep = {params.sobelFilterSize, params.boxFilterSizeX, params.boxFilterSizeY, params.rescale};
+	int enabled[2] = {params.sobelFilterX, params.sobelFilterY};
 
-	// create integral image and do mean filtering
-	if(params.sobelFilterX) {
-		integral(filtered_gradX, intImg);
-		filtered_gradX = DkLineDetection::convolveIntegralImage(intImg, cvCeil(params.boxFilterSizeX*params.rescale), cvCeil(params.boxFilterSizeY*params.rescale), DkLineDetection::DK_BORDER_ZERO);
-		normalize(filtered_gradX, filtered_gradX, 255, 0, cv::NORM_MINMAX);
-		
-		if (filtered_gradX.depth() != CV_8UC1)
-			filtered_gradX.convertTo(filtered_gradX, CV_8UC1);
-	}
-	if(params.sobelFilterY) {
-		integral(filtered_gradY, intImg);
-		filtered_gradY = DkLineDetection::convolveIntegralImage(intImg, cvCeil(params.boxFilterSizeX*params.rescale), cvCeil(params.boxFilterSizeY*params.rescale), DkLineDetection::DK_BORDER_ZERO);
-		normalize(filtered_gradY, filtered_gradY, 255, 0, cv::NORM_MINMAX);
+	// edge maps - toggling one branch does not touch the other one
+	for (int idx = 0; idx < 2; idx++) {
 
-		if (filtered_gradY.depth() != CV_8UC1)
-			filtered_gradY.convertTo(filtered_gradY, CV_8UC1);
+		if (enabled[idx] && (cache.edges[idx].empty() || !(cache.edgeParams[idx] == ep))) {
+			cache.edges[idx] = edgeMap(*segLineImg, idx == 0 ? 1 : 0, idx == 1 ? 1 : 0);
+			cache.edgeParams[idx] = ep;
+			cache.edgeVersion[idx] = ++cache.version;
+		}
 	}
 
-	
-	// DEBUG
-	/*
-	cv::namedWindow( "convolved X", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
-	cv::imshow( "convolved X", filtered_gradX);
-
-	cv::namedWindow( "convolved Y", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
-	cv::imshow( "convolved Y", filtered_gradY);
-	*/
-	// threshold the filtered sobel image using otsu
-	if(params.sobelFilterX) {
-		cv::threshold(filtered_gradX, filtered_gradX, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
-		filtered_gradX.convertTo(filtered_gradX, CV_32FC1);
-		normalize(filtered_gradX, filtered_gradX, 1.0f, 0.0f, cv::NORM_MINMAX);
-	}
-	if(params.sobelFilterY) {
-		cv::threshold(filtered_gradY, filtered_gradY, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
-		filtered_gradY.convertTo(filtered_gradY, CV_32FC1);
-		normalize(filtered_gradY, filtered_gradY, 1.0f, 0.0f, cv::NORM_MINMAX);
-	}
+	// text regions
+	int mixedSrc[2] = {enabled[0] ? cache.edgeVersion[0] : 0, enabled[1] ? cache.edgeVersion[1] : 0};
 
-	/*
-	cv::namedWindow( "otsu X", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
-	cv::imshow( "otsu X", filtered_gradX);
-	cv::namedWindow( "otsu Y", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
-	cv::imshow( "otsu Y", filtered_gradY);
-	*/
-	// create binary images
-	lowertextLineImg->convertTo(*lowertextLineImg, CV_32FC1, 1.0f/255.0f);
-	uppertextLineImg->convertTo(*uppertextLineImg, CV_32FC1, 1.0f/255.0f);
+	if (mixedSrc[0] != cache.mixedSrc[0] || mixedSrc[1] != cache.mixedSrc[1]) {
 
-	
-	if (params.sobelFilterX || params.sobelFilterY) {
 		cv::Mat mixed;
 		if(params.sobelFilterX && params.sobelFilterY) {
-			mixed = filtered_gradY.mul(filtered_gradX);
+			mixed = cache.edges[1].mul(cache.edges[0]);
 		} else if (params.sobelFilterX) {
-			mixed = filtered_gradX;
-		} else {
-			mixed = filtered_gradY;
+			mixed = cache.edges[0];
+		} else if (params.sobelFilterY) {
+			mixed = cache.edges[1];
 		}
 
 		/*
 		cv::namedWindow( "otsu mixed", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
 		cv::imshow( "otsu mixed", mixed);
 		*/
-		cv::morphologyEx(mixed, mixed, cv::MORPH_DILATE, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(20,20/*15, 15*/)));
+		// do not dilate in place - the edge maps are cached
+		cache.mixed = cv::Mat();
+		if (!mixed.empty())
+			cv::morphologyEx(mixed, cache.mixed, cv::MORPH_DILATE, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(20,20/*15, 15*/)));
 		/*
 		cv::namedWindow( "otsu mixed closed", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
 		cv::imshow( "otsu mixed closed", mixed);
 		*/
-		*lowertextLineImg = lowertextLineImg->mul(mixed);
-		*uppertextLineImg = uppertextLineImg->mul(mixed);
+		cache.mixedSrc[0] = mixedSrc[0];
+		cache.mixedSrc[1] = mixedSrc[1];
+		cache.mixedVersion = ++cache.version;
 	}
 
-	
+	// optimized text lines
+	if (cache.linesSrc[0] != cache.basicVersion || cache.linesSrc[1] != cache.mixedVersion || 
+		cache.linesRemoveShort != params.removeShort) {
 
-	/*cv::namedWindow( "before removing short text lines lower", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
-	cv::imshow( "before removing short text lines lower", *lowertextLineImg);
-	*/
+		// create binary images
+		cv::Mat lower, upper;
+		lowertextLineImg->convertTo(lower, CV_32FC1, 1.0f/255.0f);
+		uppertextLineImg->convertTo(upper, CV_32FC1, 1.0f/255.0f);
 
-	if (params.removeShort) {
-		*lowertextLineImg = removeShortLines(*lowertextLineImg, 250);
-		*uppertextLineImg = removeShortLines(*uppertextLineImg, 250);
+		if (!cache.mixed.empty()) {
+			lower = lower.mul(cache.mixed);
+			upper = upper.mul(cache.mixed);
+		}
+
+		/*cv::namedWindow( "before removing short text lines lower", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
+		cv::imshow( "before removing short text lines lower", lower);
+		*/
+
+		if (params.removeShort) {
+			lower = removeShortLines(lower, 250);
+			upper = removeShortLines(upper, 250);
+		}
+		/*
+		cv::namedWindow( "after removing short text lines lower", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
+		cv::imshow( "after removing short text lines lower", lower);
+		*/
+		if (lower.depth() != CV_8UC1)
+			lower.convertTo(lower, CV_8UC1, 255);
+
+		if (upper.depth() != CV_8UC1)
+			upper.convertTo(upper, CV_8UC1, 255);
+
+		cache.lower = lower;
+		cache.upper = upper;
+		cache.linesSrc[0] = cache.basicVersion;
+		cache.linesSrc[1] = cache.mixedVersion;
+		cache.linesRemoveShort = params.removeShort;
+		cache.linesVersion = ++cache.version;
 	}
-	/*
-	cv::namedWindow( "after removing short text lines lower", CV_WINDOW_NORMAL | CV_WINDOW_KEEPRATIO | CV_GUI_NORMAL );
-	cv::imshow( "after removing short text lines lower", *lowertextLineImg);
-	*/
-	if (lowertextLineImg->depth() != CV_8UC1)
-		lowertextLineImg->convertTo(*lowertextLineImg, CV_8UC1, 255);
 
-	if (uppertextLineImg->depth() != CV_8UC1)
-		uppertextLineImg->convertTo(*uppertextLineImg, CV_8UC1, 255);
+	*lowertextLineImg = cache.lower;
+	*uppertextLineImg = cache.upper;
+}
 
-	
+/**
+* Computes one edge branch of the optimization.
+* The image is Sobel filtered, mean filtered (box filter) and binarized using Otsu.
+* @param img the original image
+* @param dx 1 for the x-branch
+* @param dy 1 for the y-branch
+* @returns the binary edge map (CV_32FC1)
+**/
+cv::Mat DkLineDetection::edgeMap(const cv::Mat& img, int dx, int dy) const {
+
+	// the gradients are normalized below, hence the 8-bit range does not matter
+	cv::Mat grad;
+	cv::Sobel(img, grad, CV_32F, dx, dy, params.sobelFilterSize);
+
+	grad = cv::abs(grad);
+	normalize(grad, grad, 1.0f, 0.0f, cv::NORM_MINMAX);
+
+	// create integral image and do mean filtering
+	cv::Mat intImg;
+	integral(grad, intImg, CV_64F);
+	grad = DkLineDetection::convolveIntegralImage(intImg, cvCeil(params.boxFilterSizeX*params.rescale), cvCeil(params.boxFilterSizeY*params.rescale), DkLineDetection::DK_BORDER_ZERO);
+	normalize(grad, grad, 255, 0, cv::NORM_MINMAX);
+	grad.convertTo(grad, CV_8UC1);
+
+	// threshold the filtered sobel image using otsu
+	cv::threshold(grad, grad, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
+	grad.convertTo(grad, CV_32FC1);
+	normalize(grad, grad, 1.0f, 0.0f, cv::NORM_MINMAX);
+
+	return grad;
 }
 
 /**
@@ -955,6 +1233,60 @@ cv::Mat DkLineDetection::removeShortLines(cv::Mat img, int minLength) {
 
 } 
 
+/**
+* Traces the text lines of a mask as polylines.
+* Each connected component results in one polyline which follows its centre
+* (the mean row of the component's border pixels in each column).
+* The polylines are simplified with a tolerance of 1 pixel.
+* @param mask a text line mask (CV_8UC1, text lines > 0)
+* @returns one polyline per text line, its points are ordered left to right
+**/
+std::vector<std::vector<cv::Point> > DkLineDetection::tracePolylines(const cv::Mat& mask) {
+
+	std::vector<std::vector<cv::Point> > polylines;
+
+	if (mask.empty())
+		return polylines;
+
+	// findContours modifies its input
+	cv::Mat img = mask > 0;
+
+	std::vector<std::vector<cv::Point> > contours;
+	cv::findContours(img, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE);
+
+	for (size_t idx = 0; idx < contours.size(); idx++) {
+
+		const std::vector<cv::Point>& contour = contours[idx];
+		cv::Rect bb = cv::boundingRect(contour);
+
+		if (bb.width < 2)
+			continue;
+
+		// mean row of the border pixels per column
+		std::vector<int> rowSum(bb.width, 0);
+		std::vector<int> rowCnt(bb.width, 0);
+
+		for (size_t pIdx = 0; pIdx < contour.size(); pIdx++) {
+			rowSum[contour[pIdx].x - bb.x] += contour[pIdx].y;
+			rowCnt[contour[pIdx].x - bb.x]++;
+		}
+
+		std::vector<cv::Point> centre;
+		for (int x = 0; x < bb.width; x++) {
+			if (rowCnt[x] > 0)
+				centre.push_back(cv::Point(bb.x + x, cvRound((double)rowSum[x] / rowCnt[x])));
+		}
+
+		std::vector<cv::Point> polyline;
+		cv::approxPolyDP(centre, polyline, 1.0, false);
+
+		if (polyline.size() > 1)
+			polylines.push_back(polyline);
+	}
+
+	return polylines;
+}
+
 // integral text estimation
 
 
@@ -1084,413 +1416,4 @@ cv::Mat DkLineDetection::convolveIntegralImage(const cv::Mat src, const int kern
 
 // class: DkLineDetection end
 
-// class: DkLineDetectionDialog start
-
-/**
-* creates a new instance of the dialog responsible for setting up and executing the line detection
-* calculations
-**/
-DkLineDetectionDialog::DkLineDetectionDialog(DkLineDetection *lineDetector, QSharedPointer<nmc::DkMetaDataT> metadata,
-											 QWidget* parent, Qt::WindowFlags flags) : QDialog(parent, flags) {
-
-	this->lineDetector = lineDetector;
-	this->margin = 10;
-	this->metaData = metaData;
-	init();
-}
-
-DkLineDetectionDialog::~DkLineDetectionDialog() {
-
-}
-
-/**
-* Initiliazes the dialog and creates its layout
-**/
-void DkLineDetectionDialog::init() {
-
-	dialogWidth = 300; //700;
-	dialogHeight = 240;//160; //560;
-
-	setWindowTitle(tr("Line Detection Settings"));
-	//setFixedSize(dialogWidth, dialogHeight);
-	this->setBaseSize(dialogWidth, dialogHeight);
-	createLayout();
-}
-
-/**
-* Layouting of the dialog with default parameters
-**/
-void DkLineDetectionDialog::createLayout() {
-	
-	// widgets for the different settings
-	QWidget *centralWidget = new QWidget(this);
-	QGridLayout* centralWidgetGridLayout = new QGridLayout(centralWidget);
-
-	QLabel *labelStripeLength = new QLabel(tr("Word length in Pixel:"), centralWidget);
-	labelStripeLength->move(margin, margin);
-	spinnerStripeLength = new QSpinBox(centralWidget);
-	spinnerStripeLength->setMinimumWidth(50);
-
-	connect(spinnerStripeLength, SIGNAL(valueChanged(int)), this, SLOT(stripeLengthSliderValChanged(int)));
-
-	QLabel *labelStripeLengthCM = new QLabel(tr("                       or cm:"), centralWidget);
-	labelStripeLengthCM->move(margin, margin);
-	spinnerStripeLengthCM = new QDoubleSpinBox(centralWidget);
-	spinnerStripeLengthCM->setMinimumWidth(50);
-	spinnerStripeLengthCM->setSingleStep(0.1);
-
-	connect(spinnerStripeLengthCM, SIGNAL(valueChanged(double)), this, SLOT(stripeLengthSliderValChangedCM(double)));
-
-	QLabel *labelNonExtKernelSize = new QLabel(tr("Line height in Pixel:"), centralWidget);	
-	spinnerNonExtKernelSize = new QSpinBox(centralWidget);
-
-	connect(spinnerNonExtKernelSize, SIGNAL(valueChanged(int)), this, SLOT(lineHeightSliderValChanged(int)));
-
-	QLabel *labelNonExtKernelSizeCM = new QLabel(tr("                     or cm:"), centralWidget);	
-	spinnerNonExtKernelSizeCM = new QDoubleSpinBox(centralWidget);
-	spinnerNonExtKernelSizeCM->setSingleStep(0.1);
-
-	connect(spinnerNonExtKernelSizeCM, SIGNAL(valueChanged(double)), this, SLOT(lineHeightSliderValChangedCM(double)));
-
-	QLabel *labelOptimize = new QLabel(tr("Optimize line image:"), centralWidget);
-	labelOptimize->setToolTip("Optimizes the line image by removing noise on the borders");
-	checkOptimize = new QCheckBox(centralWidget);
-
-	QLabel *labelSobelFilterX = new QLabel("    SobelFilterX:", centralWidget);
-	checkSobelX = new QCheckBox(centralWidget);
-
-	QLabel *labelSobelFilterY = new QLabel("    SobelFilterY:", centralWidget);
-	checkSobelY = new QCheckBox(centralWidget);
-
-	QLabel *labelSobelFilterSize = new QLabel("    SobelFilterSize:", centralWidget);
-	comboBoxSobelSize = new QComboBox(centralWidget);
-	comboBoxSobelSize->addItem("3", 3);
-	comboBoxSobelSize->addItem("5", 5);
-	comboBoxSobelSize->addItem("7", 7);
-
-	QLabel *labelFilterSizeX = new QLabel("    BoxFilterSizeX:", centralWidget);
-	spinnerFilterSizeX = new QSpinBox(centralWidget);
-
-	QLabel *labelFilterSizeY = new QLabel("    BoxFilterSizeY:", centralWidget);
-	spinnerFilterSizeY = new QSpinBox(centralWidget);
-
-	QLabel *labelRemoveShort = new QLabel("    Remove Short Lines:", centralWidget);
-	checkRemoveShort = new QCheckBox(centralWidget);
-	
-
-	/*QLabel *labelRescale = new QLabel("    rescale:", centralWidget);
-	spinnerRescale = new QDoubleSpinBox(centralWidget);
-	spinnerRescale->setDecimals(1);
-	spinnerRescale->setSingleStep(0.1);*/
-
-	centralWidgetGridLayout->addWidget(labelStripeLength, 1, 1);
-	centralWidgetGridLayout->addWidget(spinnerStripeLength, 1, 2);
-	centralWidgetGridLayout->addWidget(labelStripeLengthCM, 2, 1);
-	centralWidgetGridLayout->addWidget(spinnerStripeLengthCM, 2, 2);
-	centralWidgetGridLayout->addWidget(labelNonExtKernelSize, 3, 1);
-	centralWidgetGridLayout->addWidget(spinnerNonExtKernelSize, 3, 2);
-	centralWidgetGridLayout->addWidget(labelNonExtKernelSizeCM, 4, 1);
-	centralWidgetGridLayout->addWidget(spinnerNonExtKernelSizeCM, 4, 2);
-	centralWidgetGridLayout->addWidget(labelOptimize, 5, 1);
-	centralWidgetGridLayout->addWidget(checkOptimize, 5, 2);
-	centralWidgetGridLayout->addWidget(labelSobelFilterX, 6, 1);
-	centralWidgetGridLayout->addWidget(checkSobelX, 6, 2);
-	centralWidgetGridLayout->addWidget(labelSobelFilterY, 7, 1);
-	centralWidgetGridLayout->addWidget(checkSobelY, 7, 2);
-	centralWidgetGridLayout->addWidget(labelSobelFilterSize, 8, 1);
-	centralWidgetGridLayout->addWidget(comboBoxSobelSize, 8, 2);
-	centralWidgetGridLayout->addWidget(labelFilterSizeX, 9, 1);
-	centralWidgetGridLayout->addWidget(spinnerFilterSizeX, 9, 2);
-	centralWidgetGridLayout->addWidget(labelFilterSizeY, 10, 1);
-	centralWidgetGridLayout->addWidget(spinnerFilterSizeY, 10, 2);
-	centralWidgetGridLayout->addWidget(labelRemoveShort, 11, 1);
-	centralWidgetGridLayout->addWidget(checkRemoveShort, 11, 2);
-	/*centralWidgetGridLayout->addWidget(labelRescale, 6, 1);
-	centralWidgetGridLayout->addWidget(spinnerRescale, 6, 2);*/
-	
-	// bottom widget - buttons	
-	QWidget* bottomWidget = new QWidget(this);
-	QHBoxLayout* bottomWidgetHBoxLayout = new QHBoxLayout(bottomWidget);
-
-	QPushButton* buttonSave = new QPushButton(tr("&Detect Lines"));
-	buttonSave->setDefault(true);
-	connect(buttonSave, SIGNAL(clicked()), this, SLOT(detectLinesPressed()));
-	QPushButton* buttonCancel = new QPushButton(tr("&Cancel"));
-	connect(buttonCancel, SIGNAL(clicked()), this, SLOT(cancelPressed()));
-
-	QSpacerItem* spacer = new QSpacerItem(1,1, QSizePolicy::Expanding, QSizePolicy::Expanding);
-	
-	bottomWidgetHBoxLayout->addItem(spacer);
-	bottomWidgetHBoxLayout->addWidget(buttonSave);
-	bottomWidgetHBoxLayout->addWidget(buttonCancel);	
-	
-	BorderLayout* borderLayout = new BorderLayout;
-	borderLayout->addWidget(centralWidget, BorderLayout::Center);
-	borderLayout->addWidget(bottomWidget, BorderLayout::South);
-	this->setSizeGripEnabled(false);
-
-	this->setLayout(borderLayout);
-
-	setDefaultConfiguration();
-
-	// connect optimization settings to check box
-	connect(checkOptimize, SIGNAL(stateChanged(int)), this, SLOT(enableOptimizationSettings(int)));
-}
-
-void DkLineDetectionDialog::showEvent(QShowEvent *event) {
-
-	oldOptimizeImage = checkOptimize->isChecked();
-	oldSobelFilterX = checkSobelX->isChecked();
-	oldSobelFilterY = checkSobelY->isChecked();
-
-	oldStripeLength = spinnerStripeLength->value();
-	oldNonExtremaKernelSize = spinnerNonExtKernelSize->value();
-	
-	oldSobelFilterSize = comboBoxSobelSize->currentText().toInt();
-	oldBoxFilterSizeX = spinnerFilterSizeX->value();
-	oldBoxFilterSizeY = spinnerFilterSizeY->value();
-
-	oldRemoveShort = checkRemoveShort->isChecked();
-}
-
-/**
-* Makes optimization settings clickable in the dialog
-**/
-void DkLineDetectionDialog::enableOptimizationSettings(int checked) {
-	
-	if(checked == 0) {
-		checkSobelX->setEnabled(false);
-		checkSobelY->setEnabled(false);
-		comboBoxSobelSize->setEnabled(false);
-		spinnerFilterSizeX->setEnabled(false);
-		spinnerFilterSizeY->setEnabled(false);
-		checkRemoveShort->setEnabled(false);
-		//spinnerRescale->setEnabled(false);
-	} else {
-		checkSobelX->setEnabled(true);
-		checkSobelY->setEnabled(true);
-		comboBoxSobelSize->setEnabled(true);
-		spinnerFilterSizeX->setEnabled(true);
-		spinnerFilterSizeY->setEnabled(true);
-		checkRemoveShort->setEnabled(true);
-		//spinnerRescale->setEnabled(true);
-	}
-}
-
-/**
-* Sets the default values for the input fields according to the current image
-*/
-void DkLineDetectionDialog::setDefaultConfiguration() {
-	cv::Mat img = lineDetector->getImage();
-	int defaultStripeLength = (int)(img.cols/7); // 300
-	int defaultNonExtrKernelSize = (int) (img.rows/50); //70
-	int defaultFilterSizeX = 70 < img.cols ? 70 : img.cols;
-	int defaultFilterSizeY = 50 < img.rows ? 50 : img.rows;
-	//float defaultRescale = 1.0f;
-
-
-	spinnerStripeLength->setMaximum(img.cols);
-	spinnerStripeLength->setMinimum(2);
-	spinnerStripeLength->setValue(defaultStripeLength);
-
-	spinnerNonExtKernelSize->setMaximum(img.cols);
-	spinnerNonExtKernelSize->setMinimum(2);
-	spinnerNonExtKernelSize->setValue(defaultNonExtrKernelSize);
-
-	// optimize parameters
-	checkOptimize->setChecked(true);
-
-	checkSobelX->setChecked(true);
-	checkSobelY->setChecked(false);
-
-	spinnerFilterSizeX->setMaximum(img.cols);
-	spinnerFilterSizeX->setMinimum(3);
-	spinnerFilterSizeX->setValue(defaultFilterSizeX);
-
-	spinnerFilterSizeY->setMaximum(img.rows);
-	spinnerFilterSizeY->setMinimum(3);
-	spinnerFilterSizeY->setValue(defaultFilterSizeY);
-
-	checkRemoveShort->setChecked(true);
-
-	/*spinnerRescale->setMaximum(2.0);
-	spinnerRescale->setMinimum(1.0);
-	spinnerRescale->setValue(defaultRescale);*/
-}
-
-void DkLineDetectionDialog::setMetaData(QSharedPointer<nmc::DkMetaDataT> metadata) {
-
-	this->metaData = metaData;
-}
-
-/**
-* Closes the dialog.
-**/
-void DkLineDetectionDialog::cancelPressed() {
-
-	// reset the values
-	spinnerStripeLength->setValue(oldStripeLength);
-	spinnerNonExtKernelSize->setValue(oldNonExtremaKernelSize);
-	checkOptimize->setChecked(oldOptimizeImage);
-	checkSobelX->setChecked(oldSobelFilterX ? true : false);
-	checkSobelY->setChecked(oldSobelFilterY ? true : false);
-
-	spinnerFilterSizeX->setValue(oldBoxFilterSizeX);
-	spinnerFilterSizeY->setValue(oldBoxFilterSizeY);
-
-	checkRemoveShort->setChecked(oldRemoveShort ? true : false);
-
-	int index = comboBoxSobelSize->findData(oldSobelFilterSize);
-	if ( index != -1 )
-		comboBoxSobelSize->setCurrentIndex(index);
-
-	this->close();
-}
-
-/**
-* User signals to start the line detection algorithm.
-* \sa DkLineDetection::startLineDetection()
-**/
-void DkLineDetectionDialog::detectLinesPressed() {
-
-	//start calculation with current settings
-	int sobelFilterSize = comboBoxSobelSize->currentText().toInt();
-
-	lineDetector->setParameters(spinnerStripeLength->value(), 
-		spinnerNonExtKernelSize->value(), 
-		checkOptimize->isChecked(),
-		checkSobelX->isChecked(),
-		checkSobelY->isChecked(),
-		sobelFilterSize,
-		spinnerFilterSizeX->value(), 
-		spinnerFilterSizeY->value(),
-		checkRemoveShort->isChecked()
-		/*,spinnerRescale->value()*/);
-
-	lineDetector->startLineDetection();
-
-	if(!lineDetector->hasTextLines()) {
-		QMessageBox infoDialog(this);
-		infoDialog.setWindowTitle(tr("No text lines"));
-		infoDialog.setText(tr("No text lines were detected in the image"));
-		infoDialog.setIcon(QMessageBox::Information);
-		infoDialog.setStandardButtons(QMessageBox::Ok);
-		infoDialog.show();
-		infoDialog.exec();
-	}
-	// finished - now close dialog
-	this->close();
-}
-
-/**
-* Receives the changed value of the spinner which is the strip length in pixel,
-* converts them to cm and sets the other slider to this value
-**/
-void DkLineDetectionDialog::stripeLengthSliderValChanged(int val) {
-	if (changingStripeSlider) {
-		changingStripeSlider = false;
-		return;
-	}
-	changingStripeSlider = true;
-	// get the image resolution for distance calculation
-	float x_res = 72;		// markus: 72 dpi is the default value assumed
-
-	// >DIR: get metadata resolution if available [21.10.2014 markus]
-	if (metaData) {
-		QVector2D res = metaData->getResolution();
-		x_res = res.x();
-	}
-	// convert into cm and put into corresponding spinner
-	float length_inch;
-
-	length_inch = val / x_res;
-
-	float length_cm = length_inch * 2.54;
-	spinnerStripeLengthCM->setValue(length_cm);
-}
-
-/**
-* Receives the changed value of the spinner which is the strip length in cm,
-* converts them to pixel and sets the other slider to this value
-**/
-void DkLineDetectionDialog::stripeLengthSliderValChangedCM(double val) {
-	if (changingStripeSlider) {
-		changingStripeSlider = false;
-		return;
-	}
-	changingStripeSlider = true;
-	// get the image resolution for distance calculation
-	float x_res = 72;		// markus: 72 dpi is the default value assumed
-
-	// >DIR: get metadata resolution if available [21.10.2014 markus]
-	if (metaData) {
-		QVector2D res = metaData->getResolution();
-		x_res = res.x();
-	}
-	// convert into cm and put into corresponding spinner
-	float length_pixel;
-
-	length_pixel = (val/2.54) * x_res;
-
-	spinnerStripeLength->setValue(length_pixel);
-}
-
-/**
-* Receives the changed value of the spinner which is the strip length in pixel,
-* converts them to cm and sets the other slider to this value
-**/
-void DkLineDetectionDialog::lineHeightSliderValChanged(int val) {
-	if (changingLineHeightSlider) {
-		changingLineHeightSlider = false;
-		return;
-	}
-	changingLineHeightSlider = true;
-	// get the image resolution for distance calculation
-	float y_res = 72;		// markus: 72 dpi is the default value assumed
-
-	// >DIR: get metadata resolution if available [21.10.2014 markus]
-	if (metaData) {
-		QVector2D res = metaData->getResolution();
-		y_res = res.y();
-	}
-	// convert into cm and put into corresponding spinner
-	float length_inch;
-
-	length_inch = val / y_res;
-
-	float length_cm = length_inch * 2.54;
-	spinnerNonExtKernelSizeCM->setValue(length_cm);
-}
-
-/**
-* Receives the changed value of the spinner which is the strip length in cm,
-* converts them to pixel and sets the other slider to this value
-**/
-void DkLineDetectionDialog::lineHeightSliderValChangedCM(double val) {
-	if (changingLineHeightSlider) {
-		changingLineHeightSlider = false;
-		return;
-	}
-	changingLineHeightSlider = true;
-	// get the image resolution for distance calculation
-	float y_res = 72;		// markus: 72 dpi is the default value assumed
-
-	// >DIR: get metadata resolution if available [21.10.2014 markus]
-	if (metaData) {
-		QVector2D res = metaData->getResolution();
-		y_res = res.y();
-	}
-	// convert into cm and put into corresponding spinner
-	float length_pixel;
-
-	length_pixel = (val/2.54) * y_res;
-
-	spinnerNonExtKernelSize->setValue(length_pixel);
-}
-
-
-
-
-// class: DkLineDetectionDialog end
-
-};
\ No newline at end of file
+};
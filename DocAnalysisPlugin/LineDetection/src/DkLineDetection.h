@@ -27,44 +27,58 @@
 
 #pragma once
 
-#include <QWidget>
-#include <QDialog>
-#include <QCheckBox>
-#include <QComboBox>
-#include <QSpinBox>
-#include <QDoubleSpinBox>
-#include <QLabel>
-#include <QLayout>
-#include <QVector2D>
+#include <QPolygonF>
+#include <QRectF>
+#include <QVector>
 #include <opencv2/core/core.hpp>
-#include <opencv2/highgui/highgui.hpp>
-#include <numeric>      // std::accumulate
-#include <windows.h> 
-#include <iostream>
-#include "BorderLayout.h"
-#include "DkMetaData.h"
-
-//#include "DkImage.h"
-#include "DkImageStorage.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <string>
+#include <vector>
 
 namespace nmp {
 
-class DkLineDetectionDialog;
+/**
+* Text lines as polylines with a spatial index.
+* The polylines are binned into a uniform grid (cellSize x cellSize pixel)
+* according to their bounding boxes. Hence, only the polylines of the cells
+* overlapping a region need to be tested for intersection.
+**/
+class DkTextLineIndex {
+
+	public:
+		DkTextLineIndex(int cellSize = 256);
+
+		void setPolylines(const std::vector<std::vector<cv::Point> >& lines, const cv::Size& imgSize);
+		void clear();
+		QVector<int> intersecting(const QRectF& rect) const;
+		const QPolygonF& polyline(int idx) const { return polylines[idx]; } /** returns the polyline idx (image coordinates) **/
+		int size() const { return polylines.size(); } /** returns the number of polylines **/
+
+	private:
+		int cellSize; /**< Width and height of a grid cell in pixel **/
+		int gridCols;
+		int gridRows;
+		QVector<QPolygonF> polylines; /**< The text lines **/
+		QVector<QRectF> bounds; /**< Bounding boxes of the text lines (padded by a pixel) **/
+		QVector<QVector<int> > cells; /**< Indices of the text lines per grid cell (row-major) **/
+};
 
 /**
 * Main class implementing line detection.
+* It only depends on OpenCV and QtGui (QPolygonF) - hence it can be
+* used headless (see the lineDetectionBatch tool).
 **/
 class DkLineDetection {
 	
 	private:
-		cv::Mat image; /**< The original image **/
-		cv::Mat lpp_image; /**< Local projection profile of the image **/
+		cv::Mat image; /**< The original image (8-bit greyscale) **/
+		cv::Mat lpp_image; /**< Local projection profile of the image (CV_32FC1) **/
 		cv::Mat lowerTextLines; /**< The optimized lower text lines image mask **/
 		cv::Mat upperTextLines; /**< The optimized upper text lines image mask **/
 		cv::Mat basicLowerTextLines; /**< The basic calculated lower text lines (basis for optimization) **/
 		cv::Mat basicUpperTextLines; /**< The basic calculated upper text lines (basis for optimization) **/
-		QImage bottomLines; /**< Lower (bottom) text lines converted to an Qt image with alpha channel **/
-		QImage topLines; /**< Upper (top) text lines converted to an Qt image with alpha channel **/
+		DkTextLineIndex bottomLines; /**< Lower (bottom) text lines traced as polylines **/
+		DkTextLineIndex topLines; /**< Upper (top) text lines traced as polylines **/
 		bool hasLines; /**< True, if lines are available **/
 		bool recalc; /**< True, if recalculation neccessary **/
 
@@ -79,7 +93,7 @@ class DkLineDetection {
 			float sigma; /**< Sigma for the 1D gaussian derivative kernel used to find local minima and maxima **/
 			int nonExtremaKernelSize; /**< The kernel size for non-extrema suppression of the local minima and maxima of the LLP **/
 			float maxThresh; /**< Threshold for a local maximum to be a real maximum **/
-			float alpha; /**< Alpha value of the text line images **/
+			float alpha; /**< Alpha value of the text lines when drawn **/
 			bool optimizeImage; /**< Flag to declare if the optimization algorithm shall be run **/
 			int sobelFilterX; /**< 1 means to enable Sobel-filtering in x-direction for edge detection during optimization **/
 			int sobelFilterY; /**< 1 means to enable Sobel-filtering in y-direction for edge detection during optimization **/
@@ -91,22 +105,67 @@ class DkLineDetection {
 		};
 		parameters params; /**< Current parameters for calculation and optimization **/
 
+		/**
+		* Parameters of an edge branch (Sobel, box filter, Otsu) of the optimization
+		**/
+		struct edgeParameters {
+			int sobelFilterSize;
+			int boxFilterSizeX;
+			int boxFilterSizeY;
+			float rescale;
+
+			bool operator==(const edgeParameters& o) const {
+				return sobelFilterSize == o.sobelFilterSize && boxFilterSizeX == o.boxFilterSizeX &&
+					boxFilterSizeY == o.boxFilterSizeY && rescale == o.rescale;
+			}
+		};
+
+		/**
+		* Stage cache of the text line detection and optimization.
+		* Each stage gets a new version if it is recomputed and remembers the parameters
+		* and the versions of the stages it was computed from. Hence, a stage is only
+		* recomputed if one of its inputs changed (e.g. toggling removeShort reuses the edge maps).
+		**/
+		struct stageCache {
+			int version = 0; /**< The last version assigned **/
+			int basicVersion = 0; /**< Version of the basic text lines **/
+
+			cv::Mat edges[2]; /**< Binary edge maps (CV_32FC1) of the x- and y-branch **/
+			edgeParameters edgeParams[2]; /**< Parameters the edge maps were computed with **/
+			int edgeVersion[2] = {0, 0};
+
+			cv::Mat mixed; /**< The dilated product of the enabled edge maps (text regions) **/
+			int mixedSrc[2] = {0, 0}; /**< Versions of the edge maps mixed (0 if a branch is disabled) **/
+			int mixedVersion = 0;
+
+			cv::Mat lower; /**< Optimized lower text lines (CV_8UC1) **/
+			cv::Mat upper; /**< Optimized upper text lines (CV_8UC1) **/
+			int linesSrc[2] = {0, 0}; /**< Versions of the basic text lines and the text regions **/
+			int linesRemoveShort = -1;
+			int linesVersion = 0;
+
+			int outputVersion = 0; /**< Version of the text lines the polylines were traced from **/
+		};
+		stageCache cache; /**< Intermediate results - reset if a new image is set **/
+
 		// define
 		enum morph_border{DK_BORDER_ZERO = 0, DK_BORDER_FLIP};
 
 		void calcLocalProjectionProfile();
 		void findLocalMinima();
+		void findExtrema(const cv::Mat& filtered, cv::Mat& lower, cv::Mat& upper);
+		void findExtrema1D(const cv::Mat& filtered, cv::Mat& lower, cv::Mat& upper);
 		void nonExtremaSuppression(cv::Mat *histogram, cv::Mat *maxima, cv::Mat *minima);
 		void nonExtremaSuppression2D(cv::Mat *histogram, cv::Mat *maxima, cv::Mat *minima);
-		void createTextLineImages();
+		void traceTextLines();
 		void optimizeLineImg1(cv::Mat segLineImg, cv::Mat *lowertextLineImg, cv::Mat *uppertextLineImg);
 		void optimizeLineImg(cv::Mat *segLineImg, cv::Mat *lowertextLineImg, cv::Mat *uppertextLineImg);
+		cv::Mat edgeMap(const cv::Mat& img, int dx, int dy) const;
 		static cv::Mat convolveIntegralImage(const cv::Mat src, const int kernelSizeX, const int kernelSizeY, const int norm);
 		cv::Mat removeShortLines(cv::Mat img, int minLength);
 
 		std::string getImageType(int number);
 		void debugOutputMat(cv::Mat *mat, std::string message);
-		bool setWindow(int Width, int Height);
 		bool compareMat(cv::Mat mat1, cv::Mat mat2, std::string text = "");
 
 	public:
@@ -116,82 +175,20 @@ class DkLineDetection {
 		void setImage(cv::Mat img);
 		cv::Mat getImage();
 		void startLineDetection();
+		void setDefaultParameters();
 		void setParameters(int stripeWidth, int nonExtrKernelSize, bool optimize, 
 			bool sobelX, bool sobelY, int sobelKernelSize, int boxFilterSizeX, 
 			int boxFilterSizeY, int removeShort/*, float rescale*/);
 		bool hasTextLines() { return hasLines; } /** return wether or not text lines have been computed already in the current image **/
-		QImage getBottomLines() { return bottomLines; } /** returns the QImage which contains the calculated bottom text lines **/
-		QImage getTopLines() { return topLines; } /** returns the QImage which contains the calculated top text lines **/
-		
-
-};
-
-
-/**
-* The dialog class which allows configuration of the parameters for the line
-* detection algorithm.
-**/
-class DkLineDetectionDialog : public QDialog {
-	Q_OBJECT
-
-	public:
-		DkLineDetectionDialog(DkLineDetection *lineDetector, QSharedPointer<nmc::DkMetaDataT> metaData, QWidget* parent = 0, Qt::WindowFlags flags = 0);
-		~DkLineDetectionDialog();
-
-		void setDefaultConfiguration();
-		void setMetaData(QSharedPointer<nmc::DkMetaDataT> metaData);
-
-	protected:
-		int dialogWidth;
-		int dialogHeight;
+		const DkTextLineIndex& getBottomLines() const { return bottomLines; } /** returns the calculated bottom text lines (polylines) **/
+		const DkTextLineIndex& getTopLines() const { return topLines; } /** returns the calculated top text lines (polylines) **/
+		float getAlpha() const { return params.alpha; } /** returns the alpha value of the text lines **/
+		cv::Mat getLowerTextLines() { return lowerTextLines; } /** returns the lower (bottom) text line mask (CV_8UC1) **/
+		cv::Mat getUpperTextLines() { return upperTextLines; } /** returns the upper (top) text line mask (CV_8UC1) **/
 
-		void init();
-		void createLayout();
+		static std::vector<std::vector<cv::Point> > tracePolylines(const cv::Mat& mask);
 
-		void showEvent(QShowEvent *event);
-
-	protected slots:
-		void detectLinesPressed();
-		void cancelPressed();
-		void enableOptimizationSettings(int);
-		void stripeLengthSliderValChanged(int);
-		void stripeLengthSliderValChangedCM(double);
-		void lineHeightSliderValChanged(int);
-		void lineHeightSliderValChangedCM(double);
-
-	private:
-		DkLineDetection *lineDetector; /**< The corresponding line detector tool **/
-		QSharedPointer<nmc::DkMetaDataT> metaData; /**< metadata containing the image resolution **/
-
-		int margin;
-		// UI elements
-		QSpinBox *spinnerStripeLength; // parameter referring to the word length
-		QDoubleSpinBox *spinnerStripeLengthCM;
-		QSpinBox *spinnerNonExtKernelSize; // parameter referring to the line height
-		QDoubleSpinBox *spinnerNonExtKernelSizeCM;
-		QCheckBox *checkOptimize;
-		QCheckBox *checkSobelX;
-		QCheckBox *checkSobelY;
-		QComboBox *comboBoxSobelSize;
-		QSpinBox *spinnerFilterSizeX;
-		QSpinBox *spinnerFilterSizeY;
-		QCheckBox *checkRemoveShort;
-		//QDoubleSpinBox *spinnerRescale;
-
-		// old values for resetting on cancel
-		int oldStripeLength;
-		int oldNonExtremaKernelSize; /**< The kernel size for non-extrema suppression of the local minima and maxima of the LLP **/
-		bool oldOptimizeImage; /**< Flag to declare if the optimization algorithm shall be run **/
-		int oldSobelFilterX; /**< 1 means to enable Sobel-filtering in x-direction for edge detection during optimization **/
-		int oldSobelFilterY; /**< 1 means to enable Sobel-filtering in y-direction for edge detection during optimization **/
-		int oldSobelFilterSize; /** The size of the Sobel filter **/
-		int oldBoxFilterSizeX; /**< Width of the box filter to blur the edge images **/
-		int oldBoxFilterSizeY; /**< Height of the box filter to blur the edge images **/
-		int oldRemoveShort; /**< 1 means to remove short lines during text line detection **/
-
-
-		bool changingStripeSlider;
-		bool changingLineHeightSlider;
 };
 
+
 };
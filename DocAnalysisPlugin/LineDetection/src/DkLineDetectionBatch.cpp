@@ -0,0 +1,307 @@
+/*******************************************************************************************************
+ DkLineDetectionBatch.cpp
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2015 Markus Diem <markus@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkLineDetectionBatch.h"
+#include "DkLineDetection.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentRun>
+
+#include <opencv2/highgui/highgui.hpp>
+
+namespace nmp {
+
+// DkLineDetectionBatchStats --------------------------------------------------------------------
+double DkLineDetectionBatchStats::imagesPerSecond() const {
+
+	if (elapsedMs <= 0)
+		return 0.0;
+
+	return numImages / (elapsedMs / 1000.0);
+}
+
+QString DkLineDetectionBatchStats::toString() const {
+
+	QString msg;
+	msg += QString::number(numImages) + " images processed in " + QString::number(elapsedMs/1000.0, 'f', 2) + " sec";
+	msg += " (" + QString::number(imagesPerSecond(), 'f', 2) + " images/sec)";
+	msg += ", failed: " + QString::number(numFailed);
+	msg += ", no text lines found: " + QString::number(numNoLines);
+
+	return msg;
+}
+
+// DkLineDetectionBatch --------------------------------------------------------------------
+DkLineDetectionBatch::DkLineDetectionBatch(Mode mode) : mMode(mode) {
+}
+
+void DkLineDetectionBatch::setNumThreads(int numThreads) {
+	mNumThreads = numThreads;
+}
+
+void DkLineDetectionBatch::setOutputDir(const QString & outputDir) {
+	mOutputDir = outputDir;
+}
+
+void DkLineDetectionBatch::setStripeLength(int stripeLength) {
+	mStripeLength = stripeLength;
+}
+
+void DkLineDetectionBatch::setLineHeight(int lineHeight) {
+	mLineHeight = lineHeight;
+}
+
+void DkLineDetectionBatch::setOptimize(bool optimize) {
+	mOptimize = optimize;
+}
+
+void DkLineDetectionBatch::cancel() {
+	mCanceled.store(1);
+}
+
+bool DkLineDetectionBatch::isCanceled() const {
+	return mCanceled.load() != 0;
+}
+
+/**
+* Runs the line detection on all files.
+* This function blocks until all files are processed (or the batch is canceled).
+* If the output directory cannot be created, no file is processed and all are reported as failed.
+* @param filePaths the images to be processed
+* @return the batch statistics
+**/
+DkLineDetectionBatchStats DkLineDetectionBatch::compute(const QStringList & filePaths) {
+
+	mCanceled.store(0);
+	mNextTask.store(0);
+	mNumProcessed.store(0);
+	mNumFailed.store(0);
+	mNumNoLines.store(0);
+
+	// nothing can be written without the output directory
+	if (!mOutputDir.isEmpty() && !QDir().mkpath(mOutputDir)) {
+		qCritical() << "[DkLineDetectionBatch] could not create the output directory" << mOutputDir;
+
+		DkLineDetectionBatchStats stats;
+		stats.numFailed = filePaths.size();
+		return stats;
+	}
+
+	int numThreads = mNumThreads > 0 ? mNumThreads : QThread::idealThreadCount();
+	numThreads = qMax(qMin(numThreads, filePaths.size()), 1);
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(numThreads);
+
+	QElapsedTimer dt;
+	dt.start();
+
+	// the images have similar sizes - hence the workers simply pull the next file
+	QVector<QFuture<void> > workers;
+	for (int idx = 0; idx < numThreads; idx++)
+		workers << QtConcurrent::run(&pool, this, &DkLineDetectionBatch::work, &filePaths);
+
+	for (QFuture<void>& w : workers)
+		w.waitForFinished();
+
+	DkLineDetectionBatchStats stats;
+	stats.elapsedMs = dt.elapsed();
+	stats.numImages = mNumProcessed.load();
+	stats.numFailed = mNumFailed.load();
+	stats.numNoLines = mNumNoLines.load();
+
+	qInfo() << "[DkLineDetectionBatch]" << stats.toString() << "using" << numThreads << "threads";
+
+	return stats;
+}
+
+void DkLineDetectionBatch::work(const QStringList* filePaths) {
+
+	while (!isCanceled()) {
+
+		int task = mNextTask.fetchAndAddOrdered(1);
+
+		if (task >= filePaths->size())
+			break;
+
+		if (!processImage(filePaths->at(task)))
+			mNumFailed.ref();
+
+		mNumProcessed.ref();
+	}
+}
+
+bool DkLineDetectionBatch::processImage(const QString & filePath) {
+
+	cv::Mat img = cv::imread(filePath.toStdString(), cv::IMREAD_GRAYSCALE);
+
+	if (img.empty()) {
+		qWarning() << "[DkLineDetectionBatch] could not load" << filePath;
+		return false;
+	}
+
+	DkLineDetection lineDetection;
+	lineDetection.setImage(img);
+	lineDetection.setDefaultParameters();
+
+	if (mStripeLength > 0 || mLineHeight > 0 || !mOptimize) {
+		lineDetection.setParameters(
+			mStripeLength > 0 ? mStripeLength : img.cols/7,
+			mLineHeight > 0 ? mLineHeight : img.rows/50,
+			mOptimize, true, false, 3,
+			qMin(70, img.cols), qMin(50, img.rows), 1);
+	}
+
+	lineDetection.startLineDetection();
+
+	if (!lineDetection.hasTextLines())
+		mNumNoLines.ref();
+
+	bool success = mMode == mode_polylines ?
+		savePolylines(filePath, img.size(), lineDetection.getBottomLines(), lineDetection.getTopLines()) :
+		saveMasks(filePath, lineDetection.getLowerTextLines(), lineDetection.getUpperTextLines());
+
+	return success;
+}
+
+bool DkLineDetectionBatch::saveMasks(const QString & filePath, const cv::Mat & lower, const cv::Mat & upper) const {
+
+	QString lowerPath = outputPath(filePath, "-lower.png");
+	QString upperPath = outputPath(filePath, "-upper.png");
+
+	if (!cv::imwrite(lowerPath.toStdString(), lower)) {
+		qWarning() << "[DkLineDetectionBatch] could not save" << lowerPath;
+		return false;
+	}
+
+	if (!cv::imwrite(upperPath.toStdString(), upper)) {
+		qWarning() << "[DkLineDetectionBatch] could not save" << upperPath;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+* Writes the text lines of an image as JSON.
+* The file contains the image size and one array of polylines ([[x,y], ...])
+* for the lower and one for the upper text lines (pixel centres are at .5).
+**/
+bool DkLineDetectionBatch::savePolylines(const QString & filePath, const cv::Size & size, const DkTextLineIndex & lower, const DkTextLineIndex & upper) const {
+
+	const DkTextLineIndex* textLines[2] = {&lower, &upper};
+	QJsonArray lines[2];
+
+	for (int tIdx = 0; tIdx < 2; tIdx++) {
+
+		for (int lIdx = 0; lIdx < textLines[tIdx]->size(); lIdx++) {
+
+			QJsonArray points;
+			for (const QPointF& p : textLines[tIdx]->polyline(lIdx))
+				points.append(QJsonArray() << p.x() << p.y());
+
+			lines[tIdx].append(points);
+		}
+	}
+
+	QJsonObject o;
+	o["image"] = QFileInfo(filePath).fileName();
+	o["width"] = size.width;
+	o["height"] = size.height;
+	o["lower"] = lines[0];
+	o["upper"] = lines[1];
+
+	QString jsonPath = outputPath(filePath, "-lines.json");
+	QFile file(jsonPath);
+
+	if (!file.open(QIODevice::WriteOnly)) {
+		qWarning() << "[DkLineDetectionBatch] could not save" << jsonPath;
+		return false;
+	}
+
+	file.write(QJsonDocument(o).toJson(QJsonDocument::Compact));
+
+	return true;
+}
+
+/**
+* Returns the output file of an image: its base name + suffix,
+* written next to the image if no output directory is set.
+**/
+QString DkLineDetectionBatch::outputPath(const QString & filePath, const QString & suffix) const {
+
+	QFileInfo fi(filePath);
+	QDir dir = mOutputDir.isEmpty() ? fi.absoluteDir() : QDir(mOutputDir);
+
+	return QFileInfo(dir, fi.completeBaseName() + suffix).absoluteFilePath();
+}
+
+/**
+* Expands directories to the images they contain.
+* @param paths files or directories
+* @return sorted list of image files
+**/
+QStringList DkLineDetectionBatch::collectImages(const QStringList & paths) {
+
+	// formats decoded by OpenCV
+	QStringList filters;
+	filters << "*.png" << "*.jpg" << "*.jpeg" << "*.jp2" << "*.tif" << "*.tiff" << "*.bmp" << "*.pbm" << "*.pgm" << "*.ppm";
+
+	QStringList files;
+
+	for (const QString& p : paths) {
+
+		QFileInfo fi(p);
+
+		if (fi.isDir()) {
+
+			QStringList dirFiles;
+			QDirIterator it(fi.absoluteFilePath(), filters, QDir::Files);
+
+			while (it.hasNext())
+				dirFiles << it.next();
+
+			dirFiles.sort();
+			files << dirFiles;
+		}
+		else if (fi.isFile())
+			files << fi.absoluteFilePath();
+	}
+
+	return files;
+}
+
+};
@@ -0,0 +1,100 @@
+/*******************************************************************************************************
+ DkLineDetectionBatch.h
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2015 Markus Diem <markus@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QString>
+#include <QStringList>
+
+#include <opencv2/core/core.hpp>
+
+namespace nmp {
+
+class DkTextLineIndex;
+
+class DkLineDetectionBatchStats {
+
+public:
+	int numImages = 0;
+	int numFailed = 0;
+	int numNoLines = 0;
+	qint64 elapsedMs = 0;
+
+	double imagesPerSecond() const;
+	QString toString() const;
+};
+
+/**
+* Headless text line detection.
+* Decodes the images with OpenCV, detects the text lines and writes
+* the lower/upper masks (PNG) or polylines (JSON) for each image.
+* The images are processed in parallel (one DkLineDetection per image).
+**/
+class DkLineDetectionBatch {
+
+public:
+	enum Mode {
+		mode_masks = 0,
+		mode_polylines,
+
+		mode_end
+	};
+
+	DkLineDetectionBatch(Mode mode = mode_masks);
+
+	void setNumThreads(int numThreads);
+	void setOutputDir(const QString& outputDir);
+	void setStripeLength(int stripeLength);
+	void setLineHeight(int lineHeight);
+	void setOptimize(bool optimize);
+
+	DkLineDetectionBatchStats compute(const QStringList& filePaths);
+	void cancel();
+	bool isCanceled() const;
+
+	static QStringList collectImages(const QStringList& paths);
+
+protected:
+	Mode mMode = mode_masks;
+	int mNumThreads = 0;		// 0 -> ideal thread count
+	int mStripeLength = 0;		// 0 -> default (1/7 of the image width)
+	int mLineHeight = 0;		// 0 -> default (1/50 of the image height)
+	bool mOptimize = true;
+	QString mOutputDir;
+
+	QAtomicInt mCanceled;
+	QAtomicInt mNextTask;
+	QAtomicInt mNumProcessed;
+	QAtomicInt mNumFailed;
+	QAtomicInt mNumNoLines;
+
+	void work(const QStringList* filePaths);
+	bool processImage(const QString& filePath);
+	bool saveMasks(const QString& filePath, const cv::Mat& lower, const cv::Mat& upper) const;
+	bool savePolylines(const QString& filePath, const cv::Size& size, const DkTextLineIndex& lower, const DkTextLineIndex& upper) const;
+	QString outputPath(const QString& filePath, const QString& suffix) const;
+};
+
+};
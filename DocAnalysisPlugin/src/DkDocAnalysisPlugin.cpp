@@ -653,14 +653,15 @@ void DkDocAnalysisViewPort::paintEvent(QPaintEvent *event) {
 	if(parent()) {
 		nmc::DkBaseViewPort* viewport = dynamic_cast<nmc::DkBaseViewPort*>(parent());
 		
-		// show the bottom text lines if toggled
-		if (showBottomLines) {
-			QImage botTextLines = lineDetection->getBottomLines();
-			painter.drawImage(botTextLines.rect(), botTextLines);
-		}
-		if (showTopLines) {
-			QImage topTextLines = lineDetection->getTopLines();
-			painter.drawImage(topTextLines.rect(), topTextLines);
+		// show the text lines if toggled (only those within the exposed region)
+		if (showBottomLines || showTopLines) {
+			QRectF imgRect = painter.worldTransform().inverted().mapRect(QRectF(event->rect()));
+			int alpha = qRound(lineDetection->getAlpha()*255);
+
+			if (showBottomLines)
+				drawTextLines(&painter, lineDetection->getBottomLines(), imgRect, QColor(0, 255, 0, alpha));
+			if (showTopLines)
+				drawTextLines(&painter, lineDetection->getTopLines(), imgRect, QColor(255, 0, 0, alpha));
 		}
 
 
@@ -709,6 +710,31 @@ void DkDocAnalysisViewPort::drawContours(QPainter *painter) {
 }
 
 
+/**
+* Draws the text lines intersecting a region.
+* @param painter The painter to use
+* @param textLines The bottom or top text lines
+* @param imgRect The region to be drawn (image coordinates)
+* @param color The color of the text lines
+* \sa DkLineDetection DkTextLineIndex
+**/
+void DkDocAnalysisViewPort::drawTextLines(QPainter *painter, const DkTextLineIndex& textLines, const QRectF& imgRect, const QColor& color) {
+
+	QVector<int> visible = textLines.intersecting(imgRect);
+
+	if (visible.isEmpty())
+		return;
+
+	QPen pen = painter->pen();
+	// the masks were 2 pixel wide lines
+	painter->setPen(QPen(color, 2));
+
+	for (int idx : visible)
+		painter->drawPolyline(textLines.polyline(idx));
+
+	painter->setPen(pen);
+}
+
 /**
 * Draws lines and points referring to the distance measure tool
 * @param painter The painter to use
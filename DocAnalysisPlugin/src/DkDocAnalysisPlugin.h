@@ -51,7 +51,7 @@
 #include "DkImageStorage.h"
 #include "DkDistanceMeasure.h"
 #include "DkMagicCutWidgets.h"
-#include "DkLineDetection.h"
+#include "DkLineDetectionDialog.h"
 //#include "DkDialog.h"
 #include "DkSaveDialog.h"
 
@@ -211,6 +211,7 @@ private:
 	// line detection variables
 	DkLineDetection *lineDetection; /**< Tool for detecting text lines within an image **/
 	DkLineDetectionDialog *lineDetectionDialog;
+	void drawTextLines(QPainter *painter, const DkTextLineIndex& textLines, const QRectF& imgRect, const QColor& color);
 	QSharedPointer<nmc::DkMetaDataT> metadata;
 };
 
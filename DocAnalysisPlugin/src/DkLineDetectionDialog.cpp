@@ -0,0 +1,446 @@
+/*******************************************************************************************************
+ DkLineDetectionDialog.cpp
+ Created on:	04.06.2012
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2012 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2012 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2012 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkLineDetectionDialog.h"
+
+#include <QPushButton>
+#include <QMessageBox>
+#include <QGridLayout>
+#include <QHBoxLayout>
+
+namespace nmp {
+
+// class: DkLineDetectionDialog start
+
+/**
+* creates a new instance of the dialog responsible for setting up and executing the line detection
+* calculations
+**/
+DkLineDetectionDialog::DkLineDetectionDialog(DkLineDetection *lineDetector, QSharedPointer<nmc::DkMetaDataT> metadata,
+											 QWidget* parent, Qt::WindowFlags flags) : QDialog(parent, flags) {
+
+	this->lineDetector = lineDetector;
+	this->margin = 10;
+	this->metaData = metaData;
+	init();
+}
+
+DkLineDetectionDialog::~DkLineDetectionDialog() {
+
+}
+
+/**
+* Initiliazes the dialog and creates its layout
+**/
+void DkLineDetectionDialog::init() {
+
+	dialogWidth = 300; //700;
+	dialogHeight = 240;//160; //560;
+
+	setWindowTitle(tr("Line Detection Settings"));
+	//setFixedSize(dialogWidth, dialogHeight);
+	this->setBaseSize(dialogWidth, dialogHeight);
+	createLayout();
+}
+
+/**
+* Layouting of the dialog with default parameters
+**/
+void DkLineDetectionDialog::createLayout() {
+	
+	// widgets for the different settings
+	QWidget *centralWidget = new QWidget(this);
+	QGridLayout* centralWidgetGridLayout = new QGridLayout(centralWidget);
+
+	QLabel *labelStripeLength = new QLabel(tr("Word length in Pixel:"), centralWidget);
+	labelStripeLength->move(margin, margin);
+	spinnerStripeLength = new QSpinBox(centralWidget);
+	spinnerStripeLength->setMinimumWidth(50);
+
+	connect(spinnerStripeLength, SIGNAL(valueChanged(int)), this, SLOT(stripeLengthSliderValChanged(int)));
+
+	QLabel *labelStripeLengthCM = new QLabel(tr("                       or cm:"), centralWidget);
+	labelStripeLengthCM->move(margin, margin);
+	spinnerStripeLengthCM = new QDoubleSpinBox(centralWidget);
+	spinnerStripeLengthCM->setMinimumWidth(50);
+	spinnerStripeLengthCM->setSingleStep(0.1);
+
+	connect(spinnerStripeLengthCM, SIGNAL(valueChanged(double)), this, SLOT(stripeLengthSliderValChangedCM(double)));
+
+	QLabel *labelNonExtKernelSize = new QLabel(tr("Line height in Pixel:"), centralWidget);	
+	spinnerNonExtKernelSize = new QSpinBox(centralWidget);
+
+	connect(spinnerNonExtKernelSize, SIGNAL(valueChanged(int)), this, SLOT(lineHeightSliderValChanged(int)));
+
+	QLabel *labelNonExtKernelSizeCM = new QLabel(tr("                     or cm:"), centralWidget);	
+	spinnerNonExtKernelSizeCM = new QDoubleSpinBox(centralWidget);
+	spinnerNonExtKernelSizeCM->setSingleStep(0.1);
+
+	connect(spinnerNonExtKernelSizeCM, SIGNAL(valueChanged(double)), this, SLOT(lineHeightSliderValChangedCM(double)));
+
+	QLabel *labelOptimize = new QLabel(tr("Optimize line image:"), centralWidget);
+	labelOptimize->setToolTip("Optimizes the line image by removing noise on the borders");
+	checkOptimize = new QCheckBox(centralWidget);
+
+	QLabel *labelSobelFilterX = new QLabel("    SobelFilterX:", centralWidget);
+	checkSobelX = new QCheckBox(centralWidget);
+
+	QLabel *labelSobelFilterY = new QLabel("    SobelFilterY:", centralWidget);
+	checkSobelY = new QCheckBox(centralWidget);
+
+	QLabel *labelSobelFilterSize = new QLabel("    SobelFilterSize:", centralWidget);
+	comboBoxSobelSize = new QComboBox(centralWidget);
+	comboBoxSobelSize->addItem("3", 3);
+	comboBoxSobelSize->addItem("5", 5);
+	comboBoxSobelSize->addItem("7", 7);
+
+	QLabel *labelFilterSizeX = new QLabel("    BoxFilterSizeX:", centralWidget);
+	spinnerFilterSizeX = new QSpinBox(centralWidget);
+
+	QLabel *labelFilterSizeY = new QLabel("    BoxFilterSizeY:", centralWidget);
+	spinnerFilterSizeY = new QSpinBox(centralWidget);
+
+	QLabel *labelRemoveShort = new QLabel("    Remove Short Lines:", centralWidget);
+	checkRemoveShort = new QCheckBox(centralWidget);
+	
+
+	/*QLabel *labelRescale = new QLabel("    rescale:", centralWidget);
+	spinnerRescale = new QDoubleSpinBox(centralWidget);
+	spinnerRescale->setDecimals(1);
+	spinnerRescale->setSingleStep(0.1);*/
+
+	centralWidgetGridLayout->addWidget(labelStripeLength, 1, 1);
+	centralWidgetGridLayout->addWidget(spinnerStripeLength, 1, 2);
+	centralWidgetGridLayout->addWidget(labelStripeLengthCM, 2, 1);
+	centralWidgetGridLayout->addWidget(spinnerStripeLengthCM, 2, 2);
+	centralWidgetGridLayout->addWidget(labelNonExtKernelSize, 3, 1);
+	centralWidgetGridLayout->addWidget(spinnerNonExtKernelSize, 3, 2);
+	centralWidgetGridLayout->addWidget(labelNonExtKernelSizeCM, 4, 1);
+	centralWidgetGridLayout->addWidget(spinnerNonExtKernelSizeCM, 4, 2);
+	centralWidgetGridLayout->addWidget(labelOptimize, 5, 1);
+	centralWidgetGridLayout->addWidget(checkOptimize, 5, 2);
+	centralWidgetGridLayout->addWidget(labelSobelFilterX, 6, 1);
+	centralWidgetGridLayout->addWidget(checkSobelX, 6, 2);
+	centralWidgetGridLayout->addWidget(labelSobelFilterY, 7, 1);
+	centralWidgetGridLayout->addWidget(checkSobelY, 7, 2);
+	centralWidgetGridLayout->addWidget(labelSobelFilterSize, 8, 1);
+	centralWidgetGridLayout->addWidget(comboBoxSobelSize, 8, 2);
+	centralWidgetGridLayout->addWidget(labelFilterSizeX, 9, 1);
+	centralWidgetGridLayout->addWidget(spinnerFilterSizeX, 9, 2);
+	centralWidgetGridLayout->addWidget(labelFilterSizeY, 10, 1);
+	centralWidgetGridLayout->addWidget(spinnerFilterSizeY, 10, 2);
+	centralWidgetGridLayout->addWidget(labelRemoveShort, 11, 1);
+	centralWidgetGridLayout->addWidget(checkRemoveShort, 11, 2);
+	/*centralWidgetGridLayout->addWidget(labelRescale, 6, 1);
+	centralWidgetGridLayout->addWidget(spinnerRescale, 6, 2);*/
+	
+	// bottom widget - buttons	
+	QWidget* bottomWidget = new QWidget(this);
+	QHBoxLayout* bottomWidgetHBoxLayout = new QHBoxLayout(bottomWidget);
+
+	QPushButton* buttonSave = new QPushButton(tr("&Detect Lines"));
+	buttonSave->setDefault(true);
+	connect(buttonSave, SIGNAL(clicked()), this, SLOT(detectLinesPressed()));
+	QPushButton* buttonCancel = new QPushButton(tr("&Cancel"));
+	connect(buttonCancel, SIGNAL(clicked()), this, SLOT(cancelPressed()));
+
+	QSpacerItem* spacer = new QSpacerItem(1,1, QSizePolicy::Expanding, QSizePolicy::Expanding);
+	
+	bottomWidgetHBoxLayout->addItem(spacer);
+	bottomWidgetHBoxLayout->addWidget(buttonSave);
+	bottomWidgetHBoxLayout->addWidget(buttonCancel);	
+	
+	BorderLayout* borderLayout = new BorderLayout;
+	borderLayout->addWidget(centralWidget, BorderLayout::Center);
+	borderLayout->addWidget(bottomWidget, BorderLayout::South);
+	this->setSizeGripEnabled(false);
+
+	this->setLayout(borderLayout);
+
+	setDefaultConfiguration();
+
+	// connect optimization settings to check box
+	connect(checkOptimize, SIGNAL(stateChanged(int)), this, SLOT(enableOptimizationSettings(int)));
+}
+
+void DkLineDetectionDialog::showEvent(QShowEvent *event) {
+
+	oldOptimizeImage = checkOptimize->isChecked();
+	oldSobelFilterX = checkSobelX->isChecked();
+	oldSobelFilterY = checkSobelY->isChecked();
+
+	oldStripeLength = spinnerStripeLength->value();
+	oldNonExtremaKernelSize = spinnerNonExtKernelSize->value();
+	
+	oldSobelFilterSize = comboBoxSobelSize->currentText().toInt();
+	oldBoxFilterSizeX = spinnerFilterSizeX->value();
+	oldBoxFilterSizeY = spinnerFilterSizeY->value();
+
+	oldRemoveShort = checkRemoveShort->isChecked();
+}
+
+/**
+* Makes optimization settings clickable in the dialog
+**/
+void DkLineDetectionDialog::enableOptimizationSettings(int checked) {
+	
+	if(checked == 0) {
+		checkSobelX->setEnabled(false);
+		checkSobelY->setEnabled(false);
+		comboBoxSobelSize->setEnabled(false);
+		spinnerFilterSizeX->setEnabled(false);
+		spinnerFilterSizeY->setEnabled(false);
+		checkRemoveShort->setEnabled(false);
+		//spinnerRescale->setEnabled(false);
+	} else {
+		checkSobelX->setEnabled(true);
+		checkSobelY->setEnabled(true);
+		comboBoxSobelSize->setEnabled(true);
+		spinnerFilterSizeX->setEnabled(true);
+		spinnerFilterSizeY->setEnabled(true);
+		checkRemoveShort->setEnabled(true);
+		//spinnerRescale->setEnabled(true);
+	}
+}
+
+/**
+* Sets the default values for the input fields according to the current image
+*/
+void DkLineDetectionDialog::setDefaultConfiguration() {
+	cv::Mat img = lineDetector->getImage();
+	int defaultStripeLength = (int)(img.cols/7); // 300
+	int defaultNonExtrKernelSize = (int) (img.rows/50); //70
+	int defaultFilterSizeX = 70 < img.cols ? 70 : img.cols;
+	int defaultFilterSizeY = 50 < img.rows ? 50 : img.rows;
+	//float defaultRescale = 1.0f;
+
+
+	spinnerStripeLength->setMaximum(img.cols);
+	spinnerStripeLength->setMinimum(2);
+	spinnerStripeLength->setValue(defaultStripeLength);
+
+	spinnerNonExtKernelSize->setMaximum(img.cols);
+	spinnerNonExtKernelSize->setMinimum(2);
+	spinnerNonExtKernelSize->setValue(defaultNonExtrKernelSize);
+
+	// optimize parameters
+	checkOptimize->setChecked(true);
+
+	checkSobelX->setChecked(true);
+	checkSobelY->setChecked(false);
+
+	spinnerFilterSizeX->setMaximum(img.cols);
+	spinnerFilterSizeX->setMinimum(3);
+	spinnerFilterSizeX->setValue(defaultFilterSizeX);
+
+	spinnerFilterSizeY->setMaximum(img.rows);
+	spinnerFilterSizeY->setMinimum(3);
+	spinnerFilterSizeY->setValue(defaultFilterSizeY);
+
+	checkRemoveShort->setChecked(true);
+
+	/*spinnerRescale->setMaximum(2.0);
+	spinnerRescale->setMinimum(1.0);
+	spinnerRescale->setValue(defaultRescale);*/
+}
+
+void DkLineDetectionDialog::setMetaData(QSharedPointer<nmc::DkMetaDataT> metadata) {
+
+	this->metaData = metaData;
+}
+
+/**
+* Closes the dialog.
+**/
+void DkLineDetectionDialog::cancelPressed() {
+
+	// reset the values
+	spinnerStripeLength->setValue(oldStripeLength);
+	spinnerNonExtKernelSize->setValue(oldNonExtremaKernelSize);
+	checkOptimize->setChecked(oldOptimizeImage);
+	checkSobelX->setChecked(oldSobelFilterX ? true : false);
+	checkSobelY->setChecked(oldSobelFilterY ? true : false);
+
+	spinnerFilterSizeX->setValue(oldBoxFilterSizeX);
+	spinnerFilterSizeY->setValue(oldBoxFilterSizeY);
+
+	checkRemoveShort->setChecked(oldRemoveShort ? true : false);
+
+	int index = comboBoxSobelSize->findData(oldSobelFilterSize);
+	if ( index != -1 )
+		comboBoxSobelSize->setCurrentIndex(index);
+
+	this->close();
+}
+
+/**
+* User signals to start the line detection algorithm.
+* \sa DkLineDetection::startLineDetection()
+**/
+void DkLineDetectionDialog::detectLinesPressed() {
+
+	//start calculation with current settings
+	int sobelFilterSize = comboBoxSobelSize->currentText().toInt();
+
+	lineDetector->setParameters(spinnerStripeLength->value(), 
+		spinnerNonExtKernelSize->value(), 
+		checkOptimize->isChecked(),
+		checkSobelX->isChecked(),
+		checkSobelY->isChecked(),
+		sobelFilterSize,
+		spinnerFilterSizeX->value(), 
+		spinnerFilterSizeY->value(),
+		checkRemoveShort->isChecked()
+		/*,spinnerRescale->value()*/);
+
+	lineDetector->startLineDetection();
+
+	if(!lineDetector->hasTextLines()) {
+		QMessageBox infoDialog(this);
+		infoDialog.setWindowTitle(tr("No text lines"));
+		infoDialog.setText(tr("No text lines were detected in the image"));
+		infoDialog.setIcon(QMessageBox::Information);
+		infoDialog.setStandardButtons(QMessageBox::Ok);
+		infoDialog.show();
+		infoDialog.exec();
+	}
+	// finished - now close dialog
+	this->close();
+}
+
+/**
+* Receives the changed value of the spinner which is the strip length in pixel,
+* converts them to cm and sets the other slider to this value
+**/
+void DkLineDetectionDialog::stripeLengthSliderValChanged(int val) {
+	if (changingStripeSlider) {
+		changingStripeSlider = false;
+		return;
+	}
+	changingStripeSlider = true;
+	// get the image resolution for distance calculation
+	float x_res = 72;		// markus: 72 dpi is the default value assumed
+
+	// >DIR: get metadata resolution if available [21.10.2014 markus]
+	if (metaData) {
+		QVector2D res = metaData->getResolution();
+		x_res = res.x();
+	}
+	// convert into cm and put into corresponding spinner
+	float length_inch;
+
+	length_inch = val / x_res;
+
+	float length_cm = length_inch * 2.54;
+	spinnerStripeLengthCM->setValue(length_cm);
+}
+
+/**
+* Receives the changed value of the spinner which is the strip length in cm,
+* converts them to pixel and sets the other slider to this value
+**/
+void DkLineDetectionDialog::stripeLengthSliderValChangedCM(double val) {
+	if (changingStripeSlider) {
+		changingStripeSlider = false;
+		return;
+	}
+	changingStripeSlider = true;
+	// get the image resolution for distance calculation
+	float x_res = 72;		// markus: 72 dpi is the default value assumed
+
+	// >DIR: get metadata resolution if available [21.10.2014 markus]
+	if (metaData) {
+		QVector2D res = metaData->getResolution();
+		x_res = res.x();
+	}
+	// convert into cm and put into corresponding spinner
+	float length_pixel;
+
+	length_pixel = (val/2.54) * x_res;
+
+	spinnerStripeLength->setValue(length_pixel);
+}
+
+/**
+* Receives the changed value of the spinner which is the strip length in pixel,
+* converts them to cm and sets the other slider to this value
+**/
+void DkLineDetectionDialog::lineHeightSliderValChanged(int val) {
+	if (changingLineHeightSlider) {
+		changingLineHeightSlider = false;
+		return;
+	}
+	changingLineHeightSlider = true;
+	// get the image resolution for distance calculation
+	float y_res = 72;		// markus: 72 dpi is the default value assumed
+
+	// >DIR: get metadata resolution if available [21.10.2014 markus]
+	if (metaData) {
+		QVector2D res = metaData->getResolution();
+		y_res = res.y();
+	}
+	// convert into cm and put into corresponding spinner
+	float length_inch;
+
+	length_inch = val / y_res;
+
+	float length_cm = length_inch * 2.54;
+	spinnerNonExtKernelSizeCM->setValue(length_cm);
+}
+
+/**
+* Receives the changed value of the spinner which is the strip length in cm,
+* converts them to pixel and sets the other slider to this value
+**/
+void DkLineDetectionDialog::lineHeightSliderValChangedCM(double val) {
+	if (changingLineHeightSlider) {
+		changingLineHeightSlider = false;
+		return;
+	}
+	changingLineHeightSlider = true;
+	// get the image resolution for distance calculation
+	float y_res = 72;		// markus: 72 dpi is the default value assumed
+
+	// >DIR: get metadata resolution if available [21.10.2014 markus]
+	if (metaData) {
+		QVector2D res = metaData->getResolution();
+		y_res = res.y();
+	}
+	// convert into cm and put into corresponding spinner
+	float length_pixel;
+
+	length_pixel = (val/2.54) * y_res;
+
+	spinnerNonExtKernelSize->setValue(length_pixel);
+}
+
+
+
+
+// class: DkLineDetectionDialog end
+
+};
\ No newline at end of file
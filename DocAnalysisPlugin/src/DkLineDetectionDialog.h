@@ -0,0 +1,113 @@
+/*******************************************************************************************************
+ DkLineDetectionDialog.h
+ Created on:	20.10.2014
+ 
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2012 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2012 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2012 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#include <QWidget>
+#include <QDialog>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QLayout>
+#include <QVector2D>
+#include "BorderLayout.h"
+#include "DkMetaData.h"
+
+#include "DkLineDetection.h"
+
+namespace nmp {
+
+/**
+* The dialog class which allows configuration of the parameters for the line
+* detection algorithm.
+**/
+class DkLineDetectionDialog : public QDialog {
+	Q_OBJECT
+
+	public:
+		DkLineDetectionDialog(DkLineDetection *lineDetector, QSharedPointer<nmc::DkMetaDataT> metaData, QWidget* parent = 0, Qt::WindowFlags flags = 0);
+		~DkLineDetectionDialog();
+
+		void setDefaultConfiguration();
+		void setMetaData(QSharedPointer<nmc::DkMetaDataT> metaData);
+
+	protected:
+		int dialogWidth;
+		int dialogHeight;
+
+		void init();
+		void createLayout();
+
+		void showEvent(QShowEvent *event);
+
+	protected slots:
+		void detectLinesPressed();
+		void cancelPressed();
+		void enableOptimizationSettings(int);
+		void stripeLengthSliderValChanged(int);
+		void stripeLengthSliderValChangedCM(double);
+		void lineHeightSliderValChanged(int);
+		void lineHeightSliderValChangedCM(double);
+
+	private:
+		DkLineDetection *lineDetector; /**< The corresponding line detector tool **/
+		QSharedPointer<nmc::DkMetaDataT> metaData; /**< metadata containing the image resolution **/
+
+		int margin;
+		// UI elements
+		QSpinBox *spinnerStripeLength; // parameter referring to the word length
+		QDoubleSpinBox *spinnerStripeLengthCM;
+		QSpinBox *spinnerNonExtKernelSize; // parameter referring to the line height
+		QDoubleSpinBox *spinnerNonExtKernelSizeCM;
+		QCheckBox *checkOptimize;
+		QCheckBox *checkSobelX;
+		QCheckBox *checkSobelY;
+		QComboBox *comboBoxSobelSize;
+		QSpinBox *spinnerFilterSizeX;
+		QSpinBox *spinnerFilterSizeY;
+		QCheckBox *checkRemoveShort;
+		//QDoubleSpinBox *spinnerRescale;
+
+		// old values for resetting on cancel
+		int oldStripeLength;
+		int oldNonExtremaKernelSize; /**< The kernel size for non-extrema suppression of the local minima and maxima of the LLP **/
+		bool oldOptimizeImage; /**< Flag to declare if the optimization algorithm shall be run **/
+		int oldSobelFilterX; /**< 1 means to enable Sobel-filtering in x-direction for edge detection during optimization **/
+		int oldSobelFilterY; /**< 1 means to enable Sobel-filtering in y-direction for edge detection during optimization **/
+		int oldSobelFilterSize; /** The size of the Sobel filter **/
+		int oldBoxFilterSizeX; /**< Width of the box filter to blur the edge images **/
+		int oldBoxFilterSizeY; /**< Height of the box filter to blur the edge images **/
+		int oldRemoveShort; /**< 1 means to remove short lines during text line detection **/
+
+
+		bool changingStripeSlider;
+		bool changingLineHeightSlider;
+};
+
+};
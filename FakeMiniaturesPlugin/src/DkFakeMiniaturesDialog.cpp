@@ -26,6 +26,7 @@
  *******************************************************************************************************/
 
 #include "DkFakeMiniaturesDialog.h"
+#include "DkMiniaturesFilter.h"
 
 #define INIT_X 0
 #define INIT_Y 0.7117
@@ -52,6 +53,9 @@ DkFakeMiniaturesDialog::~DkFakeMiniaturesDialog() {
 void DkFakeMiniaturesDialog::init() {
 
 	isOk = false;
+	img = 0;
+	initSaturation = 2;
+	initLensBlur = false;
 	dialogWidth = 700;
 	dialogHeight = 510;
 	toolsWidth = 200;
@@ -59,6 +63,10 @@ void DkFakeMiniaturesDialog::init() {
 	previewWidth = dialogWidth - toolsWidth - 2 * previewMargin;
 	previewHeight = dialogHeight - previewMargin*2;
 
+	// the preview is rendered in a background thread
+	previewRenderer = new DkMiniaturesPreview(this);
+	connect(previewRenderer, SIGNAL(previewReady(const QImage&)), this, SLOT(updateImgPreview(const QImage&)));
+
 	setWindowTitle(tr("Fake Miniatures"));
 	setFixedSize(dialogWidth, dialogHeight);
 	createLayout();
@@ -87,10 +95,15 @@ void DkFakeMiniaturesDialog::createLayout() {
 	kernelSizeWidget = new DkKernelSize(eastWidget, this);
 	saturationWidget = new DkSaturation(eastWidget, this);
 	 
+	lensBlurBox = new QCheckBox(tr("Lens blur"), eastWidget);
+	lensBlurBox->setToolTip(tr("Smooth Gaussian blur instead of the box blur"));
+	connect(lensBlurBox, SIGNAL(toggled(bool)), this, SLOT(redrawImgPreview()));
+	 
 	toolsLayout->addWidget(kernelSizeWidget);
 	toolsLayout->addWidget(saturationWidget);
+	toolsLayout->addWidget(lensBlurBox);
 
-	QSpacerItem* spacer = new QSpacerItem(20,280, QSizePolicy::Minimum, QSizePolicy::Minimum);
+	QSpacerItem* spacer = new QSpacerItem(20,260, QSizePolicy::Minimum, QSizePolicy::Minimum);
 	toolsLayout->addItem(spacer);
 
 	// bottom widget - buttons	
@@ -160,9 +173,12 @@ void DkFakeMiniaturesDialog::createImgPreview() {
 	if(rMin < 1) scaledImg = img->scaled(imgSizeScaled, Qt::KeepAspectRatio, Qt::SmoothTransformation);
 	else scaledImg = *img;
 	
-	imgPreview = applyMiniaturesFilter(scaledImg, QRect(INIT_X, INIT_Y*scaledImg.height(), INIT_WIDTH*scaledImg.width(), INIT_HEIGHT*scaledImg.height())); 
+	// show the unfiltered image until the first preview is rendered
+	imgPreview = scaledImg;
+	previewRenderer->setImage(scaledImg);
 	
 	previewLabel->setImgRect(previewImgRect);
+	redrawImgPreview();
 }
 
 /**
@@ -246,70 +262,12 @@ QImage DkFakeMiniaturesDialog::applyMiniaturesFilter(QImage inImg, QRect qRoi) {
 	merge(channelsImg, imgMat);
 	*/
 
-	int kernelSize = kernelSizeWidget->getToolValue();
-	if (inImg == scaledImg) {
-		double diagO = sqrt(img->width()*img->width()+img->height()*img->height());
-		double diagP = sqrt(scaledImg.width()*scaledImg.width()+scaledImg.height()*scaledImg.height());
-		kernelSize = qRound(kernelSize*diagP/diagO);
-	}
-
-	int saturation = saturationWidget->getToolValue();
-	float satFactor = saturation/50.0f + 1; 
-
 	cv::Mat blurImg = DkFakeMiniaturesDialog::qImage2Mat(inImg);
-	cv::Mat distImg(blurImg.size(), CV_8UC1);
-	distImg = 255;
-	cv::Mat roi(distImg, Rect(qRoi.topLeft().x(), qRoi.topLeft().y(), qRoi.width(), qRoi.height()));
-	roi.setTo(0);
-	// blur plane by plane
-	std::vector<cv::Mat> planes;
-	cv::split(blurImg, planes);
-
-	// dist image based on 'some' threshold
-	//cv::Mat distImg;
-	//cv::threshold(planes.at(0), distImg, 40, 255, THRESH_BINARY);
-
-	cv::distanceTransform(distImg, distImg, CV_DIST_C, 3);
-	cv::normalize(distImg, distImg, 1.0f, 0.0f, NORM_MINMAX);
-	
-	for (size_t idx = 0; idx < planes.size(); idx++)
-		planes.at(idx) = blurPanTilt(planes.at(idx), distImg, kernelSize);		// 140 is the maximal blurring kernel size
-		//planes.at(idx) = distImg;
+	cv::Mat distImg = DkMiniaturesFilter::depthImage(blurImg.size(), Rect(qRoi.topLeft().x(), qRoi.topLeft().y(), qRoi.width(), qRoi.height()), blurMode());
 
-	cv::merge(planes, blurImg);
-	//return (DkFakeMiniaturesDialog::mat2QImage(blurImg));
-
-	if(satFactor > 1) {
-		Mat imgHsv;
-		cvtColor(blurImg, imgHsv, CV_RGB2HSV);
-		std::vector<Mat> imgHsvCh;
-		split(imgHsv, imgHsvCh);
-
-		for (int row = 0; row < imgHsv.rows; row++)
-		{
-			unsigned char *ptr = imgHsvCh[1].ptr<unsigned char>(row);
-	 	
-			for (int col = 0; col < imgHsv.cols; col++) {
-				float tmp = (float)ptr[col] * satFactor;
-				if (tmp > 255.0f) tmp = 255.0f;
-				if (tmp < 0) tmp = 0.0f;
-				ptr[col] = (unsigned char)qRound(tmp);
-			}
-		}
-	
-		merge(imgHsvCh, imgHsv);
-		Mat tempImg(blurImg);
-		cvtColor(imgHsv, blurImg, CV_HSV2RGB);
-	
-		if(tempImg.type() == CV_8UC4) {	// the retImg is always CV_8UC3, so for pics in CV_8UC4 we need to add one channel
-			std::vector<Mat> inImgCh;
-			split(tempImg, inImgCh);
-			std::vector<Mat> retImgCh;
-			split(blurImg, retImgCh);
-			retImgCh.push_back(inImgCh[3]);
-			merge(retImgCh, blurImg);
-		}
-	}
+	// blur all channels at once & boost the saturation in the same pass
+	DkMiniaturesFilter filter(kernelSize(inImg), saturationFactor(), blurMode());
+	blurImg = filter.apply(blurImg, distImg);
 	
 	return (DkFakeMiniaturesDialog::mat2QImage(blurImg));
 #else
@@ -317,87 +275,48 @@ QImage DkFakeMiniaturesDialog::applyMiniaturesFilter(QImage inImg, QRect qRoi) {
 #endif
 }
 
-#ifdef WITH_OPENCV
 /**
- * blur filter
- * @param src input Mat
- * @param depthImg distance transform based on a roi
- * @param maxKernel maximum blur kernel size 
- * @return Mat blurres mat
+ * @param inImg the image to be filtered (the original or the scaled image)
+ * @return int the blur kernel size relative to inImg
  **/
-Mat DkFakeMiniaturesDialog::blurPanTilt(Mat src, Mat depthImg, int maxKernel) {
-
-	cv::Mat integralImg;
-
-	cv::Mat blurImg(src.size(), src.depth());
-
-	// a template function would have more 'style' here
-	const double* itgrl64Ptr = 0;
-
-	// images with an area below 4000*4000 can be compuated using 32 bit 
-	cv::integral(src, integralImg, CV_32S);
-	const unsigned int* itgrl32Ptr = integralImg.ptr<unsigned int>();
-
-	for (int rIdx = 0; rIdx < src.rows; rIdx++) {
-
-		unsigned char* blurPtr = blurImg.ptr<unsigned char>(rIdx);	// assuming unsigned char
-		const float* depthPtr = depthImg.ptr<float>(rIdx);
-		const unsigned char* srcPtr = src.ptr<unsigned char>(rIdx);
-
-		for (int cIdx = 0; cIdx < src.cols; cIdx++) {
-
-			// kernel size depends on the distance transform, the user selected
-			float dpv = depthPtr[cIdx];
-			float ksf = depthPtr[cIdx]*maxKernel*0.5f;
+int DkFakeMiniaturesDialog::kernelSize(const QImage& inImg) const {
 
-			//if (!ks) {
-			//	blurPtr[cIdx] = srcPtr[cIdx];
-			//	continue;
-			//}
-			
-			int ks = qRound(ksf);
-			if (ksf > 0 && ksf < 2) ks = 2;
-			else if (ks == 0) { // early skip
-				blurPtr[cIdx] = srcPtr[cIdx];
-				continue;
-			}
-
-			// clip all coordinates
-			int left	= qMax(cIdx-ks, 0);
-			int right	= qMin(cIdx+ks+1, src.cols);	// note not cols-1 since integral img is src.cols+1
-			int bottom	= qMax(rIdx-ks, 0);				// note top bottom is flipped since -y coords
-			int top		= qMin(rIdx+ks+1, src.rows);
-			int area	= (right-left)*(top-bottom);
-
-			top *= integralImg.cols;
-			bottom *= integralImg.cols;
+	int ks = kernelSizeWidget->getToolValue();
+	if (inImg == scaledImg) {
+		double diagO = sqrt(img->width()*img->width()+img->height()*img->height());
+		double diagP = sqrt(scaledImg.width()*scaledImg.width()+scaledImg.height()*scaledImg.height());
+		ks = qRound(ks*diagP/diagO);
+	}
 
-			float tmp = 0.0f;
+	return ks;
+}
 
-			// compute mean kernel
-			if (area && itgrl32Ptr && ks > 1)
-				tmp = (*(itgrl32Ptr + top+right) + *(itgrl32Ptr + bottom+left) - *(itgrl32Ptr + top+left) - *(itgrl32Ptr + bottom+right))/area;
-			else
-				tmp = srcPtr[cIdx];
+/**
+ * @return float the saturation factor selected
+ **/
+float DkFakeMiniaturesDialog::saturationFactor() const {
 
-			if (tmp < 0)
-				tmp = 0.0f;
-			if (tmp > 255)
-				tmp = 255.0f;
+	return saturation()/50.0f + 1; 
+}
 
-			blurPtr[cIdx] = qRound(tmp);
-		}
-	}
+/**
+ * @return int the blur mode selected (DkMiniaturesFilter::BlurMode)
+ **/
+int DkFakeMiniaturesDialog::blurMode() const {
 
-	return blurImg;
-}
+#ifdef WITH_OPENCV
+	return lensBlurBox->isChecked() ? DkMiniaturesFilter::blur_lens : DkMiniaturesFilter::blur_box;
+#else
+	return 0;
 #endif
+}
 
 /**
  * on button ok pressed event
  **/
 void DkFakeMiniaturesDialog::okPressed() {
 
+	previewRenderer->cancel();
 	isOk = true;
 	this->close();
 }
@@ -407,6 +326,7 @@ void DkFakeMiniaturesDialog::okPressed() {
  **/
 void DkFakeMiniaturesDialog::cancelPressed() {
 
+	previewRenderer->cancel();
 	this->close();
 }
 
@@ -418,7 +338,36 @@ void DkFakeMiniaturesDialog::showEvent(QShowEvent *event) {
 	isOk = false;	
 	double diag = sqrt(img->width()*img->width()+img->height()*img->height());
 	kernelSizeWidget->setToolValue(qMin(qMax(int(diag * 0.02), 5), 140));
-	saturationWidget->setToolValue(2);
+	saturationWidget->setToolValue(initSaturation);
+	lensBlurBox->setChecked(initLensBlur);
+}
+
+/**
+ * sets the saturation and blur mode the dialog starts with (e.g. from the plugin's settings)
+ * the kernel size is not set since its default depends on the image size
+ * @param saturation the saturation [0 100]
+ * @param lensBlur if true, the lens blur is checked
+ **/
+void DkFakeMiniaturesDialog::setSettings(int saturation, bool lensBlur) {
+
+	initSaturation = saturation;
+	initLensBlur = lensBlur;
+}
+
+/**
+ * @return int the saturation selected [0 100]
+ **/
+int DkFakeMiniaturesDialog::saturation() const {
+
+	return saturationWidget->getToolValue();
+}
+
+/**
+ * @return bool true if the lens blur is checked
+ **/
+bool DkFakeMiniaturesDialog::lensBlur() const {
+
+	return lensBlurBox->isChecked();
 }
 
 void DkFakeMiniaturesDialog::setImage(const QImage *img) {
@@ -451,13 +400,26 @@ QImage DkFakeMiniaturesDialog::getImage() {
 };
 
 /**
- * slot that redraws preview after slider change
+ * slot that requests a new preview after slider or roi changes
+ * the preview is rendered in the background and updated by updateImgPreview
  **/
 void DkFakeMiniaturesDialog::redrawImgPreview() {
 	
-	QRect rescaledRect = previewLabel->getROI();
+	if (!img || scaledImg.isNull())
+		return;
+
+	QRect rescaledRect = previewLabel->getROI().normalized();
 	rescaledRect.moveTo(rescaledRect.topLeft().x()-previewImgRect.topLeft().x(), rescaledRect.topLeft().y()-previewImgRect.topLeft().y());
-	setImagePreview(applyMiniaturesFilter(getScaledImg(), rescaledRect));
+	previewRenderer->request(DkMiniaturesParams(rescaledRect, kernelSize(scaledImg), saturationFactor(), blurMode()));
+};
+
+/**
+ * slot that draws a (quarter resolution or final) preview
+ * @param preview the rendered preview
+ **/
+void DkFakeMiniaturesDialog::updateImgPreview(const QImage& preview) {
+
+	setImagePreview(preview);
 	drawImgPreview();
 };
 
@@ -494,6 +456,7 @@ void DkPreviewLabel::mouseMoveEvent(QMouseEvent *e) {
 			selectionRect.setBottomRight(pos);
 		}
 		repaint();
+		fmDialog->redrawImgPreview();	// coalesced by the preview renderer
     }
 };
  
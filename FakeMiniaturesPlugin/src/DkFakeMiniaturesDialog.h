@@ -33,10 +33,13 @@
 #include <QPushButton>
 #include <QSpinBox>
 #include <QSlider>
+#include <QCheckBox>
 #include <QDialog>
 #include <QPainter>
 #include <QMouseEvent>
 
+#include "DkMiniaturesPreview.h"
+
 // OpenCV
 #ifdef WITH_OPENCV
 
@@ -73,6 +76,9 @@ class DkFakeMiniaturesDialog : public QDialog {
 		QImage applyMiniaturesFilter(QImage inImg, QRect qRoi);
 		QImage getScaledImg() {return scaledImg;};
 		void drawImgPreview();	
+		void setSettings(int saturation, bool lensBlur);
+		int saturation() const;
+		bool lensBlur() const;
 
 	public slots:
 		void redrawImgPreview();
@@ -80,6 +86,7 @@ class DkFakeMiniaturesDialog : public QDialog {
 	protected slots:
 		void okPressed();
 		void cancelPressed();
+		void updateImgPreview(const QImage& preview);
 
 	protected:
 		bool isOk;
@@ -93,6 +100,10 @@ class DkFakeMiniaturesDialog : public QDialog {
 		float rMin;
 		DkKernelSize *kernelSizeWidget;
 		DkSaturation *saturationWidget;
+		QCheckBox *lensBlurBox;
+		DkMiniaturesPreview *previewRenderer;
+		int initSaturation;
+		bool initLensBlur;
 
 		int previewWidth;
 		int previewHeight;
@@ -103,9 +114,11 @@ class DkFakeMiniaturesDialog : public QDialog {
 		void createLayout();
 		void showEvent(QShowEvent *event);
 		void createImgPreview();		
+		int kernelSize(const QImage& inImg) const;
+		float saturationFactor() const;
+		int blurMode() const;
 
 #ifdef WITH_OPENCV
-		Mat blurPanTilt(Mat src, Mat depthImg, int maxKernel);
 
 	/**
 	 * Converts a QImage to a Mat
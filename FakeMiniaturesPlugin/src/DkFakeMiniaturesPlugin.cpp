@@ -26,9 +26,57 @@
  *******************************************************************************************************/
 
 #include "DkFakeMiniaturesPlugin.h"
+#include "DkMiniaturesFilter.h"
+
+#include "DkSettings.h"
+
+#include <QAction>
+#include <QApplication>
+#include <QThread>
+#include <QUuid>
 
 namespace nmp {
 
+/**
+* Constructor
+**/
+DkFakeMiniaturesPlugin::DkFakeMiniaturesPlugin(QObject* parent) : QObject(parent) {
+
+	// create run IDs
+	QVector<QString> runIds;
+	runIds.resize(id_end);
+
+	for (int idx = 0; idx < id_end; idx++)
+		runIds[idx] = QUuid::createUuid().toString();
+	mRunIDs = runIds.toList();
+
+	// create menu actions
+	QVector<QString> menuNames;
+	menuNames.resize(id_end);
+
+	menuNames[id_fake_miniatures] = tr("Fake Miniatures...");
+	menuNames[id_fake_miniatures_batch] = tr("Fake Miniatures (Batch)");
+	mMenuNames = menuNames.toList();
+
+	// create menu status tips
+	QVector<QString> statusTips;
+	statusTips.resize(id_end);
+
+	statusTips[id_fake_miniatures] = tr("Select the sharp region and the amount of blur in a preview dialog.");
+	statusTips[id_fake_miniatures_batch] = tr("Applies the fake miniatures filter with the region, blur and saturation from the settings - no dialog.");
+	mMenuStatusTips = statusTips.toList();
+
+	// the dialog's initial roi
+	mRoi = QRectF(0, 0.7117, 1, 0.1941);
+	mKernelSize = 0;
+	mSaturation = 2;
+	mLensBlur = false;
+
+	// save default settings
+	loadSettings(nmc::DkSettingsManager::instance().qSettings());
+	saveSettings(nmc::DkSettingsManager::instance().qSettings());
+}
+
 /**
 * Returns descriptive iamge for every ID
 * @param plug-in ID
@@ -38,38 +86,143 @@ QImage DkFakeMiniaturesPlugin::image() const {
    return QImage(":/nomacsPluginFakeMin/img/fakeMinDesc.png");
 };
 
+QString DkFakeMiniaturesPlugin::name() const {
+	return "Fake Miniatures Plugin";
+}
+
+QList<QAction*> DkFakeMiniaturesPlugin::createActions(QWidget* parent) {
+
+	if (mActions.empty()) {
+
+		for (int idx = 0; idx < id_end; idx++) {
+			QAction* ca = new QAction(mMenuNames[idx], parent);
+			ca->setObjectName(mMenuNames[idx]);
+			ca->setStatusTip(mMenuStatusTips[idx]);
+			ca->setData(mRunIDs[idx]);	// runID needed for calling function runPlugin()
+			mActions.append(ca);
+		}
+	}
+
+	return mActions;
+}
+
+QList<QAction*> DkFakeMiniaturesPlugin::pluginActions() const {
+
+	return mActions;
+}
+
 /**
 * Main function: runs plug-in based on its ID
 * @param plug-in ID
 * @param current imgC in the Nomacs viewport
 **/
-QSharedPointer<nmc::DkImageContainer> DkFakeMiniaturesPlugin::runPlugin(const QString &runID, QSharedPointer<nmc::DkImageContainer> imgC) const {
+QSharedPointer<nmc::DkImageContainer> DkFakeMiniaturesPlugin::runPlugin(
+	const QString &runID, 
+	QSharedPointer<nmc::DkImageContainer> imgC, 
+	const nmc::DkSaveInfo&, 
+	QSharedPointer<nmc::DkBatchInfo>&) const {
 
 	qDebug() << "run id" << runID;
-	if (imgC) {
-		QMainWindow* mainWindow = getMainWindow();
-		DkFakeMiniaturesDialog* fakeMiniaturesDialog;
-		if(mainWindow) 
-			fakeMiniaturesDialog = new DkFakeMiniaturesDialog(mainWindow);
-		else 
-			fakeMiniaturesDialog = new DkFakeMiniaturesDialog();
+	if (!imgC || !mRunIDs.contains(runID))
+		return imgC;
 
-		QImage img = imgC->image();
-		fakeMiniaturesDialog->setImage(&img);
+	// batch processing runs the plugin in worker threads - dialogs must not be shown there
+	bool guiThread = QThread::currentThread() == QApplication::instance()->thread();
 
-		bool done = fakeMiniaturesDialog->exec();
+	if (runID == mRunIDs[id_fake_miniatures] && guiThread)
+		imgC->setImage(runDialog(imgC->image()), tr("Fake Miniature"));
+	else
+		imgC->setImage(applyFilter(imgC->image()), tr("Fake Miniature"));
 
-		QImage returnImg(imgC->image());
-		if (fakeMiniaturesDialog->wasOkPressed()) 
-			returnImg = fakeMiniaturesDialog->getImage();
+	return imgC;
+};
+
+/**
+* Shows the fake miniatures dialog.
+* @param img the input image
+* @return the filtered image or img if the dialog was canceled
+**/
+QImage DkFakeMiniaturesPlugin::runDialog(const QImage& img) const {
+
+	QMainWindow* mainWindow = getMainWindow();
+	DkFakeMiniaturesDialog* fakeMiniaturesDialog;
+	if(mainWindow) 
+		fakeMiniaturesDialog = new DkFakeMiniaturesDialog(mainWindow);
+	else 
+		fakeMiniaturesDialog = new DkFakeMiniaturesDialog();
+
+	fakeMiniaturesDialog->setSettings(mSaturation, mLensBlur);
+	fakeMiniaturesDialog->setImage(&img);
+	fakeMiniaturesDialog->exec();
+
+	QImage returnImg(img);
+	if (fakeMiniaturesDialog->wasOkPressed()) {
+		returnImg = fakeMiniaturesDialog->getImage();
+
+		// remember the dialog's choice for the next run and the batch action
+		mSaturation = fakeMiniaturesDialog->saturation();
+		mLensBlur = fakeMiniaturesDialog->lensBlur();
+		saveSettings(nmc::DkSettingsManager::instance().qSettings());
+	}
+
+	fakeMiniaturesDialog->deleteLater();
+
+	return returnImg;
+}
+
+/**
+* Applies the fake miniatures filter without user interaction.
+* The parameters are read from the settings (see loadSettings).
+* @param img the input image
+* @return the filtered image
+**/
+QImage DkFakeMiniaturesPlugin::applyFilter(const QImage& img) const {
 
-		fakeMiniaturesDialog->deleteLater();
+#ifdef WITH_OPENCV
+	if (img.isNull())
+		return img;
 
-		imgC->setImage(returnImg, tr("Fake Miniature"));
+	QRect roi(qRound(mRoi.x()*img.width()), qRound(mRoi.y()*img.height()), qRound(mRoi.width()*img.width()), qRound(mRoi.height()*img.height()));
+	roi &= img.rect();
+
+	// same default as the dialog
+	int kernelSize = mKernelSize;
+	if (kernelSize <= 0) {
+		double diag = sqrt((double)img.width()*img.width()+(double)img.height()*img.height());
+		kernelSize = qMin(qMax(int(diag * 0.02), 5), 140);
 	}
 
-	return imgC;
-};
+	int mode = mLensBlur ? DkMiniaturesFilter::blur_lens : DkMiniaturesFilter::blur_box;
 
-};
+	Mat mImg = DkFakeMiniaturesDialog::qImage2Mat(img);
+	Mat depthImg = DkMiniaturesFilter::depthImage(mImg.size(), Rect(roi.x(), roi.y(), roi.width(), roi.height()), mode);
+
+	DkMiniaturesFilter filter(kernelSize, mSaturation/50.0f + 1, mode);
+	
+	return DkFakeMiniaturesDialog::mat2QImage(filter.apply(mImg, depthImg));
+#else
+	return img;
+#endif
+}
 
+void DkFakeMiniaturesPlugin::loadSettings(QSettings & settings) {
+
+	settings.beginGroup(name());
+	mRoi = settings.value("Roi", mRoi).toRectF();
+	mKernelSize = settings.value("KernelSize", mKernelSize).toInt();
+	mSaturation = qBound(0, settings.value("Saturation", mSaturation).toInt(), 100);
+	mLensBlur = settings.value("LensBlur", mLensBlur).toBool();
+	settings.endGroup();
+}
+
+void DkFakeMiniaturesPlugin::saveSettings(QSettings & settings) const {
+
+	settings.beginGroup(name());
+	settings.setValue("Roi", mRoi);
+	settings.setValue("KernelSize", mKernelSize);
+	settings.setValue("Saturation", mSaturation);
+	settings.setValue("LensBlur", mLensBlur);
+	settings.endGroup();
+}
+
+};
@@ -34,21 +34,61 @@
 #include <QStringList>
 #include <QString>
 #include <QMessageBox>
+#include <QRectF>
+#include <QSettings>
 
 #include "DkPluginInterface.h"
 #include "DkFakeMiniaturesDialog.h"
 
 namespace nmp {
 
-class DkFakeMiniaturesPlugin : public QObject, nmc::DkPluginInterface {
+class DkFakeMiniaturesPlugin : public QObject, nmc::DkBatchPluginInterface {
     Q_OBJECT
-    Q_INTERFACES(nmc::DkPluginInterface)
+    Q_INTERFACES(nmc::DkBatchPluginInterface)
 	Q_PLUGIN_METADATA(IID "com.nomacs.ImageLounge.DkFakeMiniaturesPlugin/3.2" FILE "DkFakeMiniaturesPlugin.json")
 
 public:
+	DkFakeMiniaturesPlugin(QObject* parent = 0);
+
     QImage image() const override;
+	QString name() const;
+
+	QList<QAction*> createActions(QWidget* parent) override;
+	QList<QAction*> pluginActions() const override;
+	QSharedPointer<nmc::DkImageContainer> runPlugin(
+		const QString &runID, 
+		QSharedPointer<nmc::DkImageContainer> image, 
+		const nmc::DkSaveInfo& saveInfo,
+		QSharedPointer<nmc::DkBatchInfo>& batchInfo) const override;
+
+	virtual void preLoadPlugin() const {};	// is called before batch processing
+	virtual void postLoadPlugin(const QVector<QSharedPointer<nmc::DkBatchInfo> > &) const {};	// is called after batch processing
+
+	enum {
+		id_fake_miniatures,
+		id_fake_miniatures_batch,
+		// add actions here
+
+		id_end
+	};
+
+	void loadSettings(QSettings& settings) override;
+	void saveSettings(QSettings& settings) const override;
+
+protected:
+	QList<QAction*> mActions;
+	QStringList mRunIDs;
+	QStringList mMenuNames;
+	QStringList mMenuStatusTips;
+
+	// headless parameters
+	QRectF mRoi;			// sharp region relative to the image size
+	int mKernelSize;		// 0 -> 2% of the image diagonal
+	mutable int mSaturation;	// [0 100] as in the dialog - updated by the dialog
+	mutable bool mLensBlur;
 
-	QSharedPointer<nmc::DkImageContainer> runPlugin(const QString &runID = QString(), QSharedPointer<nmc::DkImageContainer> image = QSharedPointer<nmc::DkImageContainer>()) const override;
+	QImage runDialog(const QImage& img) const;
+	QImage applyFilter(const QImage& img) const;
 };
 
 };
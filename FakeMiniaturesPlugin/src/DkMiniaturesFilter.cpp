@@ -0,0 +1,612 @@
+/*******************************************************************************************************
+ DkMiniaturesFilter.cpp
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2013 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2013 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2013 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkMiniaturesFilter.h"
+
+#include <climits>
+#include <vector>
+
+namespace nmp {
+
+#ifdef WITH_OPENCV
+/**
+ * Scales the HSV saturation in RGB space.
+ * Hue and value (the maximal channel) are kept, thus each channel
+ * is moved away from the value: c' = v - s*(v - c).
+ * @param px the pixel (at least 3 channels)
+ * @param satFactor the saturation factor
+ **/
+static inline void saturatePixel(unsigned char* px, float satFactor) {
+
+	int v = qMax(qMax(px[0], px[1]), px[2]);
+	int m = qMin(qMin(px[0], px[1]), px[2]);
+
+	if (v == m)
+		return;
+
+	// the saturation is clipped at 1 - so the minimum channel can not drop below 0
+	float s = qMin(satFactor, (float)v/(v-m));
+
+	for (int ch = 0; ch < 3; ch++)
+		px[ch] = saturate_cast<unsigned char>(v - s*(v - px[ch]));
+}
+
+/**************************************************************
+* DkPanTiltKernel: blurs and saturates bands of rows
+***************************************************************/
+template <typename T, int cn>
+class DkPanTiltKernel : public ParallelLoopBody {
+
+	public:
+		DkPanTiltKernel(const Mat& src, const Mat& depthImg, Mat& blurImg, int maxKernel, float satFactor, int halo, int bandHeight, const QAtomicInt* canceled) :
+			src(src), depthImg(depthImg), blurImg(blurImg), maxKernel(maxKernel), satFactor(satFactor), halo(halo), bandHeight(bandHeight), canceled(canceled) {};
+
+		void operator()(const Range& range) const override {
+
+			Mat integralImg;
+
+			for (int bIdx = range.start; bIdx < range.end; bIdx++) {
+
+				if (canceled && canceled->load())
+					return;
+
+				int rStart = bIdx * bandHeight;
+				int rEnd = qMin(rStart + bandHeight, src.rows);
+
+				// the band's integral image covers the halo rows too
+				int iStart = qMax(rStart - halo, 0);
+				int iEnd = qMin(rEnd + halo, src.rows);
+
+				// one interleaved integral image for all channels
+				integral(src.rowRange(iStart, iEnd), integralImg, DataType<T>::depth);
+
+				blurBand(integralImg, iStart, rStart, rEnd);
+			}
+		};
+
+	protected:
+		const Mat& src;
+		const Mat& depthImg;
+		Mat& blurImg;
+		int maxKernel;
+		float satFactor;
+		int halo;
+		int bandHeight;
+		const QAtomicInt* canceled;
+
+		void blurBand(const Mat& integralImg, int iStart, int rStart, int rEnd) const {
+
+			const T* itgrlPtr = integralImg.ptr<T>();
+			int iRows = integralImg.rows - 1;
+			int iStep = integralImg.cols*cn;
+			bool saturate = cn >= 3 && satFactor > 1.0f;
+
+			for (int rIdx = rStart; rIdx < rEnd; rIdx++) {
+
+				unsigned char* blurPtr = blurImg.ptr<unsigned char>(rIdx);
+				const float* depthPtr = depthImg.ptr<float>(rIdx);
+				const unsigned char* srcPtr = src.ptr<unsigned char>(rIdx);
+
+				for (int cIdx = 0; cIdx < src.cols; cIdx++, blurPtr += cn, srcPtr += cn) {
+
+					// kernel size depends on the distance transform, the user selected
+					float ksf = depthPtr[cIdx]*maxKernel*0.5f;
+
+					int ks = qRound(ksf);
+					if (ksf > 0 && ksf < 2) ks = 2;
+					
+					if (ks > 1) {
+
+						// clip all coordinates (band coordinates)
+						int left	= qMax(cIdx-ks, 0)*cn;
+						int right	= qMin(cIdx+ks+1, src.cols)*cn;	// note not cols-1 since integral img is src.cols+1
+						int bottom	= qMax(rIdx-ks-iStart, 0);		// note top bottom is flipped since -y coords
+						int top		= qMin(rIdx+ks+1-iStart, iRows);
+						double area	= (right-left)/cn*(top-bottom);
+
+						const T* tPtr = itgrlPtr + top*iStep;
+						const T* bPtr = itgrlPtr + bottom*iStep;
+
+						// compute mean kernel for all channels at once
+						// the differences are partial sums themselves - so int sums cannot overflow
+						for (int ch = 0; ch < cn; ch++) {
+							T sum = (tPtr[right+ch] - tPtr[left+ch]) - (bPtr[right+ch] - bPtr[left+ch]);
+							blurPtr[ch] = saturate_cast<unsigned char>(floor(sum/area));
+						}
+					}
+					else {
+						for (int ch = 0; ch < cn; ch++)
+							blurPtr[ch] = srcPtr[ch];
+					}
+
+					if (saturate)
+						saturatePixel(blurPtr, satFactor);
+				}
+			}
+		};
+
+};
+
+/**************************************************************
+* DkSaturationKernel: saturates bands of rows
+***************************************************************/
+class DkSaturationKernel : public ParallelLoopBody {
+
+	public:
+		DkSaturationKernel(Mat& img, float satFactor, int bandHeight, const QAtomicInt* canceled) :
+			img(img), satFactor(satFactor), bandHeight(bandHeight), canceled(canceled) {};
+
+		void operator()(const Range& range) const override {
+
+			int cn = img.channels();
+
+			for (int bIdx = range.start; bIdx < range.end; bIdx++) {
+
+				if (canceled && canceled->load())
+					return;
+
+				int rEnd = qMin((bIdx+1) * bandHeight, img.rows);
+
+				for (int rIdx = bIdx * bandHeight; rIdx < rEnd; rIdx++) {
+
+					unsigned char* ptr = img.ptr<unsigned char>(rIdx);
+
+					for (int cIdx = 0; cIdx < img.cols; cIdx++, ptr += cn)
+						saturatePixel(ptr, satFactor);
+				}
+			}
+		};
+
+	protected:
+		Mat& img;
+		float satFactor;
+		int bandHeight;
+		const QAtomicInt* canceled;
+};
+
+/**
+ * Coefficients of a recursive Gaussian (Young & van Vliet 1995).
+ * y[n] = B*x[n] + a1*y[n-1] + a2*y[n-2] + a3*y[n-3]
+ **/
+class DkIIRCoeffs {
+
+	public:
+		DkIIRCoeffs(double sigma = 0.0) {
+
+			B = 1.0f;
+			a1 = a2 = a3 = 0.0f;
+
+			if (sigma < 0.5)	// identity
+				return;
+
+			double q = sigma >= 2.5 ? 0.98711*sigma - 0.96330 : 3.97156 - 4.14554*sqrt(1.0 - 0.26891*sigma);
+			q = qMax(q, 0.0);
+
+			double q2 = q*q;
+			double q3 = q2*q;
+			double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+
+			a1 = (float)((2.44413*q + 2.85619*q2 + 1.26661*q3)/b0);
+			a2 = (float)(-(1.4281*q2 + 1.26661*q3)/b0);
+			a3 = (float)(0.422205*q3/b0);
+			B = 1.0f - (a1 + a2 + a3);
+		};
+
+		float B;
+		float a1;
+		float a2;
+		float a3;
+};
+
+/**************************************************************
+* DkIIRRowKernel: recursive Gaussian along rows
+***************************************************************/
+template <int cn>
+class DkIIRRowKernel : public ParallelLoopBody {
+
+	public:
+		DkIIRRowKernel(Mat& img, const Mat& depthImg, const std::vector<DkIIRCoeffs>& lut, float lutScale, const QAtomicInt* canceled) :
+			img(img), depthImg(depthImg), lut(lut), lutScale(lutScale), canceled(canceled) {};
+
+		void operator()(const Range& range) const override {
+
+			for (int rIdx = range.start; rIdx < range.end; rIdx++) {
+
+				if (canceled && canceled->load())
+					return;
+
+				float* ptr = img.ptr<float>(rIdx);
+				const float* depthPtr = depthImg.ptr<float>(rIdx);
+				float y1[cn], y2[cn], y3[cn];
+
+				// causal pass - the border is replicated (the filter's steady state)
+				for (int ch = 0; ch < cn; ch++)
+					y1[ch] = y2[ch] = y3[ch] = ptr[ch];
+
+				for (int cIdx = 0; cIdx < img.cols; cIdx++)
+					filterPixel(ptr + cIdx*cn, lut[cvRound(depthPtr[cIdx]*lutScale)], y1, y2, y3);
+
+				// anti-causal pass
+				float* lPtr = ptr + (img.cols-1)*cn;
+				for (int ch = 0; ch < cn; ch++)
+					y1[ch] = y2[ch] = y3[ch] = lPtr[ch];
+
+				for (int cIdx = img.cols-1; cIdx >= 0; cIdx--)
+					filterPixel(ptr + cIdx*cn, lut[cvRound(depthPtr[cIdx]*lutScale)], y1, y2, y3);
+			}
+		};
+
+	protected:
+		Mat& img;
+		const Mat& depthImg;
+		const std::vector<DkIIRCoeffs>& lut;
+		float lutScale;
+		const QAtomicInt* canceled;
+
+		inline void filterPixel(float* px, const DkIIRCoeffs& k, float* y1, float* y2, float* y3) const {
+
+			for (int ch = 0; ch < cn; ch++) {
+				float y = k.B*px[ch] + k.a1*y1[ch] + k.a2*y2[ch] + k.a3*y3[ch];
+				y3[ch] = y2[ch];
+				y2[ch] = y1[ch];
+				y1[ch] = y;
+				px[ch] = y;
+			}
+		};
+};
+
+/**************************************************************
+* DkIIRColKernel: recursive Gaussian along columns
+***************************************************************/
+template <int cn>
+class DkIIRColKernel : public ParallelLoopBody {
+
+	public:
+		DkIIRColKernel(Mat& img, const Mat& depthImg, Mat& dstImg, const std::vector<DkIIRCoeffs>& lut, float lutScale, float satFactor, int blockWidth, const QAtomicInt* canceled) :
+			img(img), depthImg(depthImg), dstImg(dstImg), lut(lut), lutScale(lutScale), satFactor(satFactor), blockWidth(blockWidth), canceled(canceled) {};
+
+		void operator()(const Range& range) const override {
+
+			// the columns of a block are filtered together (row by row) to keep the memory access linear
+			std::vector<float> states(blockWidth*cn*3);
+			bool saturate = cn >= 3 && satFactor > 1.0f;
+
+			for (int bIdx = range.start; bIdx < range.end; bIdx++) {
+
+				if (canceled && canceled->load())
+					return;
+
+				int cStart = bIdx*blockWidth;
+				int cEnd = qMin(cStart + blockWidth, img.cols);
+				int bw = (cEnd-cStart)*cn;
+
+				float* y1 = &states[0];
+				float* y2 = y1 + bw;
+				float* y3 = y2 + bw;
+
+				// causal pass
+				initStates(img.ptr<float>(0) + cStart*cn, bw, y1, y2, y3);
+
+				for (int rIdx = 0; rIdx < img.rows; rIdx++)
+					filterRow(img.ptr<float>(rIdx) + cStart*cn, depthImg.ptr<float>(rIdx), cStart, cEnd, y1, y2, y3);
+
+				// anti-causal pass
+				initStates(img.ptr<float>(img.rows-1) + cStart*cn, bw, y1, y2, y3);
+
+				for (int rIdx = img.rows-1; rIdx >= 0; rIdx--) {
+
+					float* ptr = img.ptr<float>(rIdx) + cStart*cn;
+					filterRow(ptr, depthImg.ptr<float>(rIdx), cStart, cEnd, y1, y2, y3);
+
+					unsigned char* dstPtr = dstImg.ptr<unsigned char>(rIdx) + cStart*cn;
+
+					for (int idx = 0; idx < bw; idx++)
+						dstPtr[idx] = saturate_cast<unsigned char>(ptr[idx]);
+
+					if (saturate) {
+						for (int idx = 0; idx < bw; idx += cn)
+							saturatePixel(dstPtr + idx, satFactor);
+					}
+				}
+			}
+		};
+
+	protected:
+		Mat& img;
+		const Mat& depthImg;
+		Mat& dstImg;
+		const std::vector<DkIIRCoeffs>& lut;
+		float lutScale;
+		float satFactor;
+		int blockWidth;
+		const QAtomicInt* canceled;
+
+		inline void initStates(const float* ptr, int bw, float* y1, float* y2, float* y3) const {
+
+			for (int idx = 0; idx < bw; idx++)
+				y1[idx] = y2[idx] = y3[idx] = ptr[idx];
+		};
+
+		inline void filterRow(float* ptr, const float* depthPtr, int cStart, int cEnd, float* y1, float* y2, float* y3) const {
+
+			for (int cIdx = cStart; cIdx < cEnd; cIdx++) {
+
+				const DkIIRCoeffs& k = lut[cvRound(depthPtr[cIdx]*lutScale)];
+
+				for (int ch = 0; ch < cn; ch++, ptr++, y1++, y2++, y3++) {
+					float y = k.B**ptr + k.a1**y1 + k.a2**y2 + k.a3**y3;
+					*y3 = *y2;
+					*y2 = *y1;
+					*y1 = y;
+					*ptr = y;
+				}
+			}
+		};
+};
+
+/**************************************************************
+* DkMiniaturesFilter: fake miniatures filter engine
+***************************************************************/
+DkMiniaturesFilter::DkMiniaturesFilter(int maxKernel, float satFactor, int mode) {
+
+	this->maxKernel = maxKernel;
+	this->satFactor = satFactor;
+	this->mode = mode;
+	minBandHeight = 32;
+	canceled = 0;
+}
+
+void DkMiniaturesFilter::setMaxKernel(int maxKernel) {
+
+	this->maxKernel = maxKernel;
+}
+
+void DkMiniaturesFilter::setSaturation(float satFactor) {
+
+	this->satFactor = satFactor;
+}
+
+/**
+ * sets the blur mode (DkMiniaturesFilter::BlurMode)
+ **/
+void DkMiniaturesFilter::setMode(int mode) {
+
+	this->mode = mode;
+}
+
+/**
+ * sets a flag which cancels the filter (e.g. if the preview's parameters changed)
+ * @param canceled the cancel flag - it must outlive the filter's calls
+ **/
+void DkMiniaturesFilter::setCancelFlag(const QAtomicInt* canceled) {
+
+	this->canceled = canceled;
+}
+
+/**
+ * @return true if the last result is incomplete since the cancel flag was raised
+ **/
+bool DkMiniaturesFilter::isCanceled() const {
+
+	return canceled && canceled->load();
+}
+
+/**
+ * @return the number of rows a band needs above and below
+ **/
+int DkMiniaturesFilter::halo() const {
+
+	return qMax(qRound(maxKernel*0.5f), 2);
+}
+
+/**
+ * computes the normalized distance to a roi
+ * the box mode uses the chessboard distance, the lens mode the (smooth) Euclidean distance
+ * @param size the image's size
+ * @param roi the region which stays sharp
+ * @param mode the blur mode
+ * @return Mat the depth image (CV_32FC1 in [0 1])
+ **/
+Mat DkMiniaturesFilter::depthImage(const Size& size, const Rect& roi, int mode) {
+
+	Mat distImg(size, CV_8UC1);
+	distImg = 255;
+	
+	Mat roiImg(distImg, roi & Rect(Point(), size));
+	roiImg.setTo(0);
+
+	if (mode == blur_lens)
+		distanceTransform(distImg, distImg, CV_DIST_L2, CV_DIST_MASK_PRECISE);
+	else
+		distanceTransform(distImg, distImg, CV_DIST_C, 3);
+	normalize(distImg, distImg, 1.0f, 0.0f, NORM_MINMAX);
+
+	return distImg;
+}
+
+/**
+ * computes the band height
+ * @param rows the image's height
+ * @param cols the image's width
+ * @param use64 true if a band's integral image needs 64 bit
+ * @return the band height in rows
+ **/
+int DkMiniaturesFilter::bandHeight(int rows, int cols, bool& use64) const {
+
+	int h = halo();
+	int numThreads = qMax(getNumThreads(), 1);
+
+	// a few bands per thread - but no more than 4 halos per band (redundant rows)
+	int bh = qBound(minBandHeight, (rows + 4*numThreads - 1) / (4*numThreads), qMax(4*h, 128));
+
+	// the largest sum of a band is 255 * cols * (bh + 2*halo)
+	qint64 maxRows32 = INT_MAX / (255 * (qint64)qMax(cols, 1));
+
+	use64 = false;
+
+	if (bh + 2*h <= maxRows32)
+		return bh;
+
+	if (maxRows32 - 2*h >= minBandHeight)
+		return (int)maxRows32 - 2*h;
+
+	use64 = true;
+	return bh;
+}
+
+/**
+ * fake miniatures filter (blur & saturation in one pass)
+ * @param img input Mat (CV_8UC1, CV_8UC3 or CV_8UC4)
+ * @param depthImg distance transform based on a roi (CV_32FC1 in [0 1])
+ * @return Mat filtered mat
+ **/
+Mat DkMiniaturesFilter::apply(const Mat& img, const Mat& depthImg) const {
+
+	return filter(img, depthImg, satFactor);
+}
+
+/**
+ * blur filter
+ * @param src input Mat (CV_8UC1, CV_8UC3 or CV_8UC4)
+ * @param depthImg distance transform based on a roi (CV_32FC1 in [0 1])
+ * @return Mat blurred mat
+ **/
+Mat DkMiniaturesFilter::blurPanTilt(const Mat& src, const Mat& depthImg) const {
+
+	return filter(src, depthImg, 1.0f);
+}
+
+/**
+ * saturation filter (without blurring)
+ * @param img input Mat (CV_8UC3 or CV_8UC4)
+ * @return Mat the saturated mat - img is returned if nothing is to be done
+ **/
+Mat DkMiniaturesFilter::saturate(const Mat& img) const {
+
+	if (img.empty() || img.channels() < 3 || satFactor <= 1.0f)
+		return img;
+
+	Mat satImg = img.clone();
+	int numThreads = qMax(getNumThreads(), 1);
+	int bh = qMax(minBandHeight, (img.rows + 4*numThreads - 1) / (4*numThreads));
+
+	parallel_for_(Range(0, (img.rows + bh - 1) / bh), DkSaturationKernel(satImg, satFactor, bh, canceled));
+
+	return satImg;
+}
+
+Mat DkMiniaturesFilter::filter(const Mat& img, const Mat& depthImg, float satFactor) const {
+
+	if (mode == blur_lens)
+		return lensFilter(img, depthImg, satFactor);
+
+	return boxFilter(img, depthImg, satFactor);
+}
+
+Mat DkMiniaturesFilter::boxFilter(const Mat& img, const Mat& depthImg, float satFactor) const {
+
+	Mat blurImg(img.size(), img.type());
+
+	if (img.empty())
+		return blurImg;
+
+	bool use64 = false;
+	int bh = bandHeight(img.rows, img.cols, use64);
+	Range bands(0, (img.rows + bh - 1) / bh);
+
+	switch (img.channels()) {
+	case 1:
+		if (use64)	parallel_for_(bands, DkPanTiltKernel<double, 1>(img, depthImg, blurImg, maxKernel, satFactor, halo(), bh, canceled));
+		else		parallel_for_(bands, DkPanTiltKernel<int, 1>(img, depthImg, blurImg, maxKernel, satFactor, halo(), bh, canceled));
+		break;
+	case 3:
+		if (use64)	parallel_for_(bands, DkPanTiltKernel<double, 3>(img, depthImg, blurImg, maxKernel, satFactor, halo(), bh, canceled));
+		else		parallel_for_(bands, DkPanTiltKernel<int, 3>(img, depthImg, blurImg, maxKernel, satFactor, halo(), bh, canceled));
+		break;
+	case 4:
+		if (use64)	parallel_for_(bands, DkPanTiltKernel<double, 4>(img, depthImg, blurImg, maxKernel, satFactor, halo(), bh, canceled));
+		else		parallel_for_(bands, DkPanTiltKernel<int, 4>(img, depthImg, blurImg, maxKernel, satFactor, halo(), bh, canceled));
+		break;
+	default:
+		CV_Error(CV_StsBadArg, "DkMiniaturesFilter: 1, 3 or 4 channels expected");
+	}
+
+	return blurImg;
+}
+/**
+ * recursive Gaussian filter with a spatially varying sigma
+ * @param img input Mat (CV_8UC1, CV_8UC3 or CV_8UC4)
+ * @param depthImg distance transform based on a roi (CV_32FC1 in [0 1])
+ * @param satFactor the saturation factor (applied in the last pass)
+ * @return Mat filtered mat
+ **/
+Mat DkMiniaturesFilter::lensFilter(const Mat& img, const Mat& depthImg, float satFactor) const {
+
+	Mat blurImg(img.size(), img.type());
+
+	if (img.empty())
+		return blurImg;
+
+	// the box radius ks = depth*maxKernel/2 has a standard deviation of ks/sqrt(3)
+	double maxSigma = maxKernel*0.5/sqrt(3.0);
+
+	// coefficients are tabulated in 1/16 sigma steps
+	float lutScale = (float)(maxSigma*16.0);
+	std::vector<DkIIRCoeffs> lut(cvRound(lutScale)+1);
+
+	for (size_t idx = 0; idx < lut.size(); idx++)
+		lut[idx] = DkIIRCoeffs(idx/16.0);
+
+	Mat fImg;
+	img.convertTo(fImg, CV_32F);
+
+	int blockWidth = 16;
+	Range rows(0, img.rows);
+	Range blocks(0, (img.cols + blockWidth - 1) / blockWidth);
+
+	switch (img.channels()) {
+	case 1:
+		parallel_for_(rows, DkIIRRowKernel<1>(fImg, depthImg, lut, lutScale, canceled));
+		parallel_for_(blocks, DkIIRColKernel<1>(fImg, depthImg, blurImg, lut, lutScale, satFactor, blockWidth, canceled));
+		break;
+	case 3:
+		parallel_for_(rows, DkIIRRowKernel<3>(fImg, depthImg, lut, lutScale, canceled));
+		parallel_for_(blocks, DkIIRColKernel<3>(fImg, depthImg, blurImg, lut, lutScale, satFactor, blockWidth, canceled));
+		break;
+	case 4:
+		parallel_for_(rows, DkIIRRowKernel<4>(fImg, depthImg, lut, lutScale, canceled));
+		parallel_for_(blocks, DkIIRColKernel<4>(fImg, depthImg, blurImg, lut, lutScale, satFactor, blockWidth, canceled));
+		break;
+	default:
+		CV_Error(CV_StsBadArg, "DkMiniaturesFilter: 1, 3 or 4 channels expected");
+	}
+
+	return blurImg;
+}
+#endif
+
+};
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*******************************************************************************************************
+ DkMiniaturesFilter.h
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2013 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2013 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2013 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#include <QtGlobal>
+#include <QAtomicInt>
+
+// OpenCV
+#ifdef WITH_OPENCV
+
+#ifdef Q_WS_WIN
+	#pragma warning(disable: 4996)
+#endif
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+using namespace cv;
+#endif
+
+namespace nmp {
+
+#ifdef WITH_OPENCV
+/**
+ * Fake miniatures filter engine (GUI-free).
+ * The depth dependent box blur is computed in horizontal bands. Every band 
+ * computes the interleaved integral image of its rows plus a halo of maxKernel/2 rows, 
+ * hence only a few bands are held in memory and the bands are processed in parallel.
+ * The band height is chosen such that a band's integral image fits into 32 bit,
+ * 64 bit integrals are only used if a single band row would overflow.
+ * The saturation boost is applied to the blurred pixels in the same pass.
+ * If a cancel flag is set, the remaining bands are skipped as soon as it is raised.
+ *
+ * The lens mode replaces the box mean by a recursive Gaussian (Young & van Vliet) 
+ * whose sigma varies per pixel with the Euclidean distance to the roi. Rows and then 
+ * columns are filtered in parallel at a constant cost per pixel - independent of sigma.
+ **/
+class DkMiniaturesFilter {
+
+	public:
+		enum BlurMode {
+			blur_box = 0,
+			blur_lens,
+
+			blur_end
+		};
+
+		DkMiniaturesFilter(int maxKernel = 0, float satFactor = 1.0f, int mode = blur_box);
+
+		void setMaxKernel(int maxKernel);
+		void setSaturation(float satFactor);
+		void setMode(int mode);
+		void setCancelFlag(const QAtomicInt* canceled);
+		bool isCanceled() const;
+
+		Mat apply(const Mat& img, const Mat& depthImg) const;
+		Mat blurPanTilt(const Mat& src, const Mat& depthImg) const;
+		Mat saturate(const Mat& img) const;
+
+		int halo() const;
+		static Mat depthImage(const Size& size, const Rect& roi, int mode = blur_box);
+
+	protected:
+		int maxKernel;
+		float satFactor;
+		int mode;
+		int minBandHeight;
+		const QAtomicInt* canceled;
+
+		int bandHeight(int rows, int cols, bool& use64) const;
+		Mat filter(const Mat& img, const Mat& depthImg, float satFactor) const;
+		Mat boxFilter(const Mat& img, const Mat& depthImg, float satFactor) const;
+		Mat lensFilter(const Mat& img, const Mat& depthImg, float satFactor) const;
+};
+#endif
+
+};
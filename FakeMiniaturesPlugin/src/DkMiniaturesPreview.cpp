@@ -0,0 +1,203 @@
+/*******************************************************************************************************
+ DkMiniaturesPreview.cpp
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2013 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2013 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2013 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkMiniaturesPreview.h"
+#include "DkMiniaturesFilter.h"
+#include "DkFakeMiniaturesDialog.h"
+
+#include <QtConcurrentRun>
+
+namespace nmp {
+
+/**************************************************************
+* DkMiniaturesPreview: background renderer of the preview
+***************************************************************/
+DkMiniaturesPreview::DkMiniaturesPreview(QObject* parent) : QObject(parent) {
+
+	renderPending = false;
+	stopped = false;
+	runningLevel = level_end;
+
+#ifdef WITH_OPENCV
+	for (int idx = 0; idx < level_end; idx++) {
+		cachedKernel[idx] = -1;
+		cachedMode[idx] = -1;
+	}
+#endif
+
+	connect(&renderWatcher, SIGNAL(finished()), this, SLOT(renderDone()));
+}
+
+DkMiniaturesPreview::~DkMiniaturesPreview() {
+
+	cancel();
+	renderWatcher.waitForFinished();
+}
+
+/**
+ * sets the (scaled) preview image and clears the cache
+ * @param img the preview image
+ **/
+void DkMiniaturesPreview::setImage(const QImage& img) {
+
+	// the render thread reads the levels & cache
+	cancel();
+	renderWatcher.waitForFinished();
+
+	levels[level_preview] = img;
+	levels[level_quarter] = img.isNull() ? QImage() : img.scaled(qMax(img.width()/4, 1), qMax(img.height()/4, 1), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+#ifdef WITH_OPENCV
+	for (int idx = 0; idx < level_end; idx++) {
+		cachedKernel[idx] = -1;
+		cachedMode[idx] = -1;
+		depthImgs[idx].release();
+		blurImgs[idx].release();
+	}
+#endif
+}
+
+/**
+ * requests a new preview - the quarter resolution preview is emitted first
+ * @param params the filter parameters
+ **/
+void DkMiniaturesPreview::request(const DkMiniaturesParams& params) {
+
+	if (levels[level_preview].isNull())
+		return;
+
+	stopped = false;
+
+	if (renderWatcher.isRunning()) {
+		pendingParams = params;
+		renderPending = true;
+		canceled.store(1);
+		return;
+	}
+
+	startRender(params, level_quarter);
+}
+
+/**
+ * cancels the running render and drops pending requests
+ * a render that has just finished (its signal is still queued) is dropped too
+ **/
+void DkMiniaturesPreview::cancel() {
+
+	renderPending = false;
+	stopped = true;
+
+	if (renderWatcher.isRunning())
+		canceled.store(1);
+}
+
+void DkMiniaturesPreview::startRender(const DkMiniaturesParams& params, int level) {
+
+	canceled.store(0);
+	runningParams = params;
+	runningLevel = level;
+
+	QFuture<QImage> future = QtConcurrent::run(this, &DkMiniaturesPreview::render, params, level);
+	renderWatcher.setFuture(future);
+}
+
+void DkMiniaturesPreview::renderDone() {
+
+	QImage preview = renderWatcher.result();
+
+	// canceled (e.g. the dialog was closed) - neither emit nor refine
+	if (stopped)
+		return;
+
+	// null previews are canceled renders
+	if (!preview.isNull() && !canceled.load())
+		emit previewReady(preview);
+
+	if (renderPending) {
+		renderPending = false;
+		startRender(pendingParams, level_quarter);
+	}
+	else if (!preview.isNull() && runningLevel == level_quarter)
+		startRender(runningParams, level_preview);
+}
+
+/**
+ * renders the preview - this function is called in the render thread
+ * @param params the filter parameters
+ * @param level the level to be rendered
+ * @return QImage the preview or a null image if the render was canceled
+ **/
+QImage DkMiniaturesPreview::render(DkMiniaturesParams params, int level) {
+
+	const QImage& img = levels[level];
+
+#ifdef WITH_OPENCV
+
+	// scale the parameters to the level
+	if (level != level_preview) {
+		double sx = (double)img.width()/levels[level_preview].width();
+		double sy = (double)img.height()/levels[level_preview].height();
+
+		params.roi = QRect(qRound(params.roi.x()*sx), qRound(params.roi.y()*sy), qRound(params.roi.width()*sx), qRound(params.roi.height()*sy));
+		params.kernelSize = qRound(params.kernelSize*qMin(sx, sy));
+	}
+
+	DkMiniaturesFilter filter(params.kernelSize, params.satFactor, params.mode);
+	filter.setCancelFlag(&canceled);
+
+	if (depthImgs[level].empty() || cachedRoi[level] != params.roi || cachedMode[level] != params.mode) {
+
+		depthImgs[level] = DkMiniaturesFilter::depthImage(Size(img.width(), img.height()), Rect(params.roi.x(), params.roi.y(), params.roi.width(), params.roi.height()), params.mode);
+		cachedRoi[level] = params.roi;
+		cachedMode[level] = params.mode;
+		blurImgs[level].release();
+	}
+
+	// only the saturation changed? -> re-use the blurred image
+	if (blurImgs[level].empty() || cachedKernel[level] != params.kernelSize) {
+
+		Mat blurImg = filter.blurPanTilt(DkFakeMiniaturesDialog::qImage2Mat(img), depthImgs[level]);
+
+		if (filter.isCanceled())
+			return QImage();
+
+		blurImgs[level] = blurImg;
+		cachedKernel[level] = params.kernelSize;
+	}
+
+	Mat satImg = filter.saturate(blurImgs[level]);
+
+	if (filter.isCanceled())
+		return QImage();
+
+	return DkFakeMiniaturesDialog::mat2QImage(satImg);
+#else
+	return img;
+#endif
+}
+
+};
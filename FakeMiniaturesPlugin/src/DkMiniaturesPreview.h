@@ -0,0 +1,124 @@
+/*******************************************************************************************************
+ DkMiniaturesPreview.h
+ Created on:	16.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2013 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2013 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2013 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QImage>
+#include <QRect>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+
+// OpenCV
+#ifdef WITH_OPENCV
+
+#ifdef Q_WS_WIN
+	#pragma warning(disable: 4996)
+#endif
+
+#include "opencv2/core/core.hpp"
+
+using namespace cv;
+#endif
+
+namespace nmp {
+
+/**
+ * Parameters of a fake miniatures preview.
+ **/
+class DkMiniaturesParams {
+
+	public:
+		DkMiniaturesParams(const QRect& roi = QRect(), int kernelSize = 0, float satFactor = 1.0f, int mode = 0) : 
+			roi(roi), kernelSize(kernelSize), satFactor(satFactor), mode(mode) {};
+
+		QRect roi;			// in preview coordinates
+		int kernelSize;		// in preview coordinates
+		float satFactor;
+		int mode;			// DkMiniaturesFilter::BlurMode
+};
+
+/**
+ * Background renderer of the fake miniatures preview.
+ * A request is first rendered at quarter resolution and then refined on the
+ * preview resolution. Requests are coalesced: if parameters change while rendering,
+ * the stale render is canceled (after the current band) and only the latest
+ * parameters are rendered next.
+ * The depth image and the blurred (not yet saturated) image are cached per level,
+ * hence changing the saturation only re-runs the saturation pass.
+ **/
+class DkMiniaturesPreview : public QObject {
+
+	Q_OBJECT
+
+	public:
+		DkMiniaturesPreview(QObject* parent = 0);
+		~DkMiniaturesPreview();
+
+		void setImage(const QImage& img);
+		void request(const DkMiniaturesParams& params);
+		void cancel();
+
+	signals:
+		void previewReady(const QImage& img);
+
+	protected slots:
+		void renderDone();
+
+	protected:
+		enum Level {
+			level_preview = 0,
+			level_quarter,
+
+			level_end
+		};
+
+		void startRender(const DkMiniaturesParams& params, int level);
+		QImage render(DkMiniaturesParams params, int level);
+
+		QImage levels[level_end];
+
+		// background rendering
+		QFutureWatcher<QImage> renderWatcher;
+		QAtomicInt canceled;
+		DkMiniaturesParams pendingParams;
+		DkMiniaturesParams runningParams;
+		bool renderPending;
+		bool stopped;		// set by cancel() - no result is emitted or refined until the next request
+		int runningLevel;
+
+#ifdef WITH_OPENCV
+		// cache - only accessed by the (single) render thread
+		QRect cachedRoi[level_end];
+		int cachedKernel[level_end];
+		int cachedMode[level_end];
+		Mat depthImgs[level_end];
+		Mat blurImgs[level_end];
+#endif
+};
+
+};
@@ -0,0 +1,89 @@
+/*******************************************************************************************************
+ main.cpp
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2015 Markus Diem
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkPageExtractionBatch.h"
+
+#pragma warning(push, 0)	// no warnings from includes - begin
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#pragma warning(pop)		// no warnings from includes - end
+
+int main(int argc, char** argv) {
+
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("pageExtractionBatch");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Finds document pages in images and crops them or saves them to the XMP metadata.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("paths", "Images or directories to be processed.", "[paths...]");
+
+	QCommandLineOption modeOpt(QStringList() << "m" << "mode", "crop (default) or metadata.", "mode", "crop");
+	QCommandLineOption methodOpt("method", "thresholds (default) or bhaskar.", "method", "thresholds");
+	QCommandLineOption outputOpt(QStringList() << "o" << "output", "Output directory for cropped pages (default: overwrite input).", "dir");
+	QCommandLineOption threadsOpt(QStringList() << "t" << "threads", "Number of worker threads (default: ideal thread count).", "n", "0");
+	QCommandLineOption decodedOpt("max-decoded", "Maximal number of decoded images held in memory (default: number of threads). Smaller values save memory but leave threads idle.", "n", "0");
+
+	parser.addOption(modeOpt);
+	parser.addOption(methodOpt);
+	parser.addOption(outputOpt);
+	parser.addOption(threadsOpt);
+	parser.addOption(decodedOpt);
+	parser.process(app);
+
+	QStringList files = nmp::DkPageExtractionBatch::collectImages(parser.positionalArguments());
+
+	if (files.isEmpty()) {
+		qWarning() << "no images found";
+		parser.showHelp(1);
+	}
+
+	QString modeName = parser.value(modeOpt);
+	QString methodName = parser.value(methodOpt);
+
+	// a typo must not fall back to crop - it overwrites the input files
+	if (modeName != "crop" && modeName != "metadata") {
+		qWarning() << "unknown mode:" << modeName;
+		parser.showHelp(1);
+	}
+
+	if (methodName != "thresholds" && methodName != "bhaskar") {
+		qWarning() << "unknown method:" << methodName;
+		parser.showHelp(1);
+	}
+
+	nmp::DkPageExtractionBatch::Mode mode = modeName == "metadata" ?
+		nmp::DkPageExtractionBatch::mode_crop_to_metadata :
+		nmp::DkPageExtractionBatch::mode_crop_to_page;
+
+	nmp::DkPageExtractionBatch batch(mode, methodName == "bhaskar");
+	batch.setOutputDir(parser.value(outputOpt));
+	batch.setNumThreads(parser.value(threadsOpt).toInt());
+	batch.setMaxDecoded(parser.value(decodedOpt).toInt());
+
+	nmp::DkPageExtractionBatchStats stats = batch.compute(files);
+
+	return stats.numFailed > 0 ? 1 : 0;
+}
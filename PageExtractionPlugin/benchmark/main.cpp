@@ -0,0 +1,229 @@
+/*******************************************************************************************************
+ main.cpp
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2015 Markus Diem
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkPageSegmentation.h"
+#include "DkPageEvaluation.h"
+#include "DkPageExtractionBatch.h"
+
+#include "DkImageContainer.h"
+#include "DkImageStorage.h"
+
+#pragma warning(push, 0)	// no warnings from includes - begin
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+#pragma warning(pop)		// no warnings from includes - end
+
+namespace nmp {
+
+/**
+* Results of one segmentation method over the whole benchmark set.
+**/
+class DkPageBenchmarkResult {
+
+public:
+	QString method;
+	QVector<double> latencies;				// ms per page (segmentation + filtering + cropping)
+	QVector<double> jaccard;				// only pages with GT
+	DkPageSegmentationStats stages;			// summed over all pages
+	QJsonArray pages;
+	int numNoPage = 0;
+
+	QJsonObject toJson() const;
+
+protected:
+	static double percentile(QVector<double> vals, double p);
+	static double mean(const QVector<double>& vals);
+};
+
+double DkPageBenchmarkResult::percentile(QVector<double> vals, double p) {
+
+	if (vals.empty())
+		return 0.0;
+
+	std::sort(vals.begin(), vals.end());
+	int idx = qBound(0, (int)std::ceil(p * vals.size()) - 1, vals.size() - 1);
+
+	return vals[idx];
+}
+
+double DkPageBenchmarkResult::mean(const QVector<double>& vals) {
+
+	if (vals.empty())
+		return 0.0;
+
+	double sum = 0;
+	for (double v : vals)
+		sum += v;
+
+	return sum / vals.size();
+}
+
+QJsonObject DkPageBenchmarkResult::toJson() const {
+
+	int n = qMax(latencies.size(), 1);
+
+	QJsonObject lat;
+	lat["mean"] = mean(latencies);
+	lat["p50"] = percentile(latencies, 0.5);
+	lat["p95"] = percentile(latencies, 0.95);
+
+	QJsonObject st;
+	st["resize"] = stages.resize / n;
+	st["edges"] = stages.edges / n;
+	st["contours"] = stages.contours / n;
+	st["filter"] = stages.filter / n;
+	st["refine"] = stages.refine / n;
+	st["crop"] = stages.crop / n;
+
+	QJsonObject ji;
+	ji["mean"] = mean(jaccard);
+	ji["evaluated"] = jaccard.size();
+
+	QJsonObject o;
+	o["method"] = method;
+	o["numPages"] = latencies.size();
+	o["numNoPage"] = numNoPage;
+	o["latencyMs"] = lat;
+	o["stagesMeanMs"] = st;
+	o["jaccard"] = ji;
+	o["pages"] = pages;
+
+	return o;
+}
+
+};
+
+int main(int argc, char** argv) {
+
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("pageExtractionBenchmark");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmarks the page segmentation methods on images with dmrz xml ground truth.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("paths", "Images or directories to be evaluated.", "[paths...]");
+
+	QCommandLineOption outputOpt(QStringList() << "o" << "output", "JSON output file (default: stdout).", "file");
+	QCommandLineOption threadsOpt(QStringList() << "t" << "threads", "Number of OpenCV threads (default: OpenCV's default).", "n", "-1");
+	parser.addOption(outputOpt);
+	parser.addOption(threadsOpt);
+	parser.process(app);
+
+	QStringList files = nmp::DkPageExtractionBatch::collectImages(parser.positionalArguments());
+
+	if (files.isEmpty()) {
+		qWarning() << "no images found";
+		parser.showHelp(1);
+	}
+
+	if (parser.value(threadsOpt).toInt() >= 0)
+		cv::setNumThreads(parser.value(threadsOpt).toInt());
+
+	QVector<nmp::DkPageBenchmarkResult> results(3);
+	results[0].method = "thresholds";
+	results[1].method = "bhaskar";
+	results[2].method = "pyramid";
+
+	for (const QString& filePath : files) {
+
+		QSharedPointer<nmc::DkImageContainer> imgC(new nmc::DkImageContainer(filePath));
+
+		if (!imgC->loadImage()) {
+			qWarning() << "could not load" << filePath;
+			continue;
+		}
+
+		QImage img = imgC->image();
+		cv::Mat mImg = nmc::DkImage::qImage2Mat(img);
+		QPolygonF gt = nmp::DkPageEvaluation::readGT(filePath);
+
+		for (int mIdx = 0; mIdx < results.size(); mIdx++) {
+
+			nmp::DkPageBenchmarkResult& r = results[mIdx];
+
+			QElapsedTimer dt;
+			dt.start();
+
+			nmp::DkPageSegmentation segM(mImg, mIdx == 1);
+			segM.pyramid = mIdx == 2;
+			segM.compute();
+			segM.filterDuplicates();
+			segM.getCropped(img);
+
+			double latency = dt.nsecsElapsed() / 1e6;
+			r.latencies << latency;
+			r.stages += segM.getStats();
+
+			QJsonObject page;
+			page["file"] = QFileInfo(filePath).fileName();
+			page["latencyMs"] = latency;
+
+			if (segM.getRects().empty())
+				r.numNoPage++;
+
+			if (!gt.isEmpty()) {
+				double ji = segM.getRects().empty() ? 0.0 : nmp::DkPageEvaluation::jaccardIndex(gt, segM.getMaxRect().toPolygon());
+				r.jaccard << ji;
+				page["jaccard"] = ji;
+			}
+
+			r.pages.append(page);
+		}
+	}
+
+	QJsonArray methods;
+	for (const nmp::DkPageBenchmarkResult& r : results)
+		methods.append(r.toJson());
+
+	QJsonObject report;
+	report["numImages"] = files.size();
+	report["methods"] = methods;
+
+	QByteArray json = QJsonDocument(report).toJson();
+
+	if (parser.isSet(outputOpt)) {
+
+		QFile file(parser.value(outputOpt));
+		if (!file.open(QIODevice::WriteOnly)) {
+			qWarning() << "could not write to" << parser.value(outputOpt);
+			return 1;
+		}
+		file.write(json);
+	}
+	else
+		QTextStream(stdout) << json;
+
+	return 0;
+}
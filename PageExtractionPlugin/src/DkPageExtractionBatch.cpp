@@ -0,0 +1,321 @@
+/*******************************************************************************************************
+ DkPageExtractionBatch.cpp
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2015 Markus Diem
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkPageExtractionBatch.h"
+#include "DkPageSegmentation.h"
+
+#include "DkImageContainer.h"
+#include "DkImageStorage.h"
+#include "DkMetaData.h"
+#include "DkMath.h"
+
+#pragma warning(push, 0)	// no warnings from includes - begin
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFuture>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#pragma warning(pop)		// no warnings from includes - end
+
+namespace nmp {
+
+// DkWorkStealingQueue --------------------------------------------------------------------
+DkWorkStealingQueue::DkWorkStealingQueue(int numWorkers) {
+
+	for (int idx = 0; idx < qMax(numWorkers, 1); idx++)
+		mDeques << QSharedPointer<TaskDeque>(new TaskDeque());
+}
+
+int DkWorkStealingQueue::numWorkers() const {
+	return mDeques.size();
+}
+
+void DkWorkStealingQueue::push(int workerIdx, int task) {
+
+	QSharedPointer<TaskDeque> d = mDeques[workerIdx % mDeques.size()];
+
+	QMutexLocker locker(&d->mutex);
+	d->tasks.push_back(task);
+}
+
+/**
+* Returns the next task of worker workerIdx.
+* If the worker's own deque is empty, a task is stolen from another worker.
+* @param workerIdx the calling worker
+* @param task the task popped
+* @return false if all deques are empty
+**/
+bool DkWorkStealingQueue::pop(int workerIdx, int& task) {
+
+	QSharedPointer<TaskDeque> d = mDeques[workerIdx];
+
+	{
+		QMutexLocker locker(&d->mutex);
+
+		if (!d->tasks.empty()) {
+			task = d->tasks.front();
+			d->tasks.pop_front();
+			return true;
+		}
+	}
+
+	return steal(workerIdx, task);
+}
+
+bool DkWorkStealingQueue::steal(int workerIdx, int& task) {
+
+	// visit the victims round robin - starting with our neighbour
+	for (int idx = 1; idx < mDeques.size(); idx++) {
+
+		QSharedPointer<TaskDeque> victim = mDeques[(workerIdx + idx) % mDeques.size()];
+		QMutexLocker locker(&victim->mutex);
+
+		// steal from the back: the victim works on the front
+		if (!victim->tasks.empty()) {
+			task = victim->tasks.back();
+			victim->tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// DkPageExtractionBatchStats --------------------------------------------------------------------
+double DkPageExtractionBatchStats::pagesPerSecond() const {
+
+	if (elapsedMs <= 0)
+		return 0.0;
+
+	return numPages / (elapsedMs / 1000.0);
+}
+
+QString DkPageExtractionBatchStats::toString() const {
+
+	QString msg;
+	msg += QString::number(numPages) + " pages processed in " + QString::number(elapsedMs/1000.0, 'f', 2) + " sec";
+	msg += " (" + QString::number(pagesPerSecond(), 'f', 2) + " pages/sec)";
+	msg += ", failed: " + QString::number(numFailed);
+	msg += ", no page found: " + QString::number(numNoPage);
+
+	return msg;
+}
+
+// DkPageExtractionBatch --------------------------------------------------------------------
+DkPageExtractionBatch::DkPageExtractionBatch(Mode mode, bool alternativeMethod) : mMode(mode), mAlternativeMethod(alternativeMethod) {
+}
+
+void DkPageExtractionBatch::setNumThreads(int numThreads) {
+	mNumThreads = numThreads;
+}
+
+void DkPageExtractionBatch::setMaxDecoded(int maxDecoded) {
+	mMaxDecoded = maxDecoded;
+}
+
+void DkPageExtractionBatch::setOutputDir(const QString & outputDir) {
+	mOutputDir = outputDir;
+}
+
+void DkPageExtractionBatch::cancel() {
+	mCanceled.store(1);
+}
+
+bool DkPageExtractionBatch::isCanceled() const {
+	return mCanceled.load() != 0;
+}
+
+/**
+* Runs the page extraction on all files.
+* This function blocks until all files are processed (or the batch is canceled).
+* If the output directory cannot be created, no file is processed and all are reported as failed.
+* @param filePaths the images to be processed
+* @return the batch statistics
+**/
+DkPageExtractionBatchStats DkPageExtractionBatch::compute(const QStringList & filePaths) {
+
+	mCanceled.store(0);
+	mNumProcessed.store(0);
+	mNumFailed.store(0);
+	mNumNoPage.store(0);
+
+	// nothing can be written without the output directory
+	if (!mOutputDir.isEmpty() && !QDir().mkpath(mOutputDir)) {
+		qCritical() << "[DkPageExtractionBatch] could not create the output directory" << mOutputDir;
+
+		DkPageExtractionBatchStats stats;
+		stats.numFailed = filePaths.size();
+		return stats;
+	}
+
+	int numThreads = mNumThreads > 0 ? mNumThreads : QThread::idealThreadCount();
+	numThreads = qMax(qMin(numThreads, filePaths.size()), 1);
+
+	// seed the deques with contiguous blocks - stealing then balances the tail
+	DkWorkStealingQueue queue(numThreads);
+	int blockSize = (filePaths.size() + numThreads - 1) / numThreads;
+
+	for (int idx = 0; idx < filePaths.size(); idx++)
+		queue.push(idx / blockSize, idx);
+
+	// every worker holds at most one decoded image - so only a smaller limit throttles
+	QSharedPointer<QSemaphore> decodeSlots;
+	if (mMaxDecoded > 0 && mMaxDecoded < numThreads)
+		decodeSlots = QSharedPointer<QSemaphore>(new QSemaphore(mMaxDecoded));
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(numThreads);
+
+	QElapsedTimer dt;
+	dt.start();
+
+	QVector<QFuture<void> > workers;
+	for (int idx = 0; idx < numThreads; idx++)
+		workers << QtConcurrent::run(&pool, this, &DkPageExtractionBatch::work, idx, &queue, &filePaths, decodeSlots.data());
+
+	for (QFuture<void>& w : workers)
+		w.waitForFinished();
+
+	DkPageExtractionBatchStats stats;
+	stats.elapsedMs = dt.elapsed();
+	stats.numPages = mNumProcessed.load();
+	stats.numFailed = mNumFailed.load();
+	stats.numNoPage = mNumNoPage.load();
+
+	qInfo() << "[DkPageExtractionBatch]" << stats.toString() << "using" << numThreads << "threads";
+
+	return stats;
+}
+
+void DkPageExtractionBatch::work(int workerIdx, DkWorkStealingQueue* queue, const QStringList* filePaths, QSemaphore* decodeSlots) {
+
+	int task = -1;
+
+	while (!isCanceled() && queue->pop(workerIdx, task)) {
+
+		if (processPage(filePaths->at(task), decodeSlots))
+			mNumProcessed.ref();
+		else
+			mNumFailed.ref();
+	}
+}
+
+bool DkPageExtractionBatch::processPage(const QString & filePath, QSemaphore* decodeSlots) {
+
+	// backpressure: do not hold more than maxDecoded images in memory
+	if (decodeSlots)
+		decodeSlots->acquire();
+
+	QSharedPointer<nmc::DkImageContainer> imgC(new nmc::DkImageContainer(filePath));
+
+	if (!imgC->loadImage()) {
+		if (decodeSlots)
+			decodeSlots->release();
+		qWarning() << "[DkPageExtractionBatch] could not load" << filePath;
+		return false;
+	}
+
+	cv::Mat img = nmc::DkImage::qImage2Mat(imgC->image());
+
+	DkPageSegmentation segM(img, mAlternativeMethod);
+	segM.compute();
+	segM.filterDuplicates();
+
+	bool success = true;
+	QString savePath = outputPath(filePath);
+
+	if (segM.getRects().empty()) {
+		mNumNoPage.ref();
+	}
+	else if (mMode == mode_crop_to_page) {
+		success = imgC->saveImage(savePath, segM.getCropped(imgC->image()));
+	}
+	else if (mMode == mode_crop_to_metadata) {
+		nmc::DkRotatingRect rect = segM.getMaxRect().toRotatingRect();
+
+		QSharedPointer<nmc::DkMetaDataT> m = imgC->getMetaData();
+		m->saveRectToXMP(rect, imgC->image().size());
+		success = imgC->saveMetaData();
+		savePath = filePath;	// the metadata is written to the input file
+	}
+
+	if (decodeSlots)
+		decodeSlots->release();
+
+	if (!success)
+		qWarning() << "[DkPageExtractionBatch] could not save" << savePath;
+
+	return success;
+}
+
+QString DkPageExtractionBatch::outputPath(const QString & filePath) const {
+
+	if (mOutputDir.isEmpty())
+		return filePath;
+
+	return QFileInfo(QDir(mOutputDir), QFileInfo(filePath).fileName()).absoluteFilePath();
+}
+
+/**
+* Expands directories to the images they contain.
+* @param paths files or directories
+* @return sorted list of image files
+**/
+QStringList DkPageExtractionBatch::collectImages(const QStringList & paths) {
+
+	QStringList filters;
+	for (const QByteArray& f : QImageReader::supportedImageFormats())
+		filters << "*." + QString::fromLatin1(f);
+
+	QStringList files;
+
+	for (const QString& p : paths) {
+
+		QFileInfo fi(p);
+
+		if (fi.isDir()) {
+
+			QStringList dirFiles;
+			QDirIterator it(fi.absoluteFilePath(), filters, QDir::Files);
+
+			while (it.hasNext())
+				dirFiles << it.next();
+
+			dirFiles.sort();
+			files << dirFiles;
+		}
+		else if (fi.isFile())
+			files << fi.absoluteFilePath();
+	}
+
+	return files;
+}
+
+};
@@ -0,0 +1,123 @@
+/*******************************************************************************************************
+ DkPageExtractionBatch.h
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2015 Markus Diem <markus@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0)	// no warnings from includes - begin
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+#include <deque>
+#pragma warning(pop)		// no warnings from includes - end
+
+namespace nmp {
+
+/**
+* Task queue with one deque per worker.
+* Workers pop from the front of their own deque and steal
+* from the back of the others' deques once they run dry.
+**/
+class DkWorkStealingQueue {
+
+public:
+	DkWorkStealingQueue(int numWorkers = 1);
+
+	void push(int workerIdx, int task);
+	bool pop(int workerIdx, int& task);
+	int numWorkers() const;
+
+protected:
+	struct TaskDeque {
+		QMutex mutex;
+		std::deque<int> tasks;
+	};
+
+	QVector<QSharedPointer<TaskDeque> > mDeques;
+
+	bool steal(int workerIdx, int& task);
+};
+
+class DkPageExtractionBatchStats {
+
+public:
+	int numPages = 0;		// pages processed successfully (including numNoPage)
+	int numFailed = 0;		// files that could not be loaded or saved
+	int numNoPage = 0;
+	qint64 elapsedMs = 0;
+
+	double pagesPerSecond() const;
+	QString toString() const;
+};
+
+/**
+* Headless page extraction.
+* Decodes, segments and writes a list of files on a bounded
+* work-stealing thread pool. Each worker holds one decoded image.
+* A maxDecoded below the number of threads limits the decoded images
+* held in memory further (backpressure on the decoder).
+**/
+class DkPageExtractionBatch {
+
+public:
+	enum Mode {
+		mode_crop_to_page = 0,
+		mode_crop_to_metadata,
+
+		mode_end
+	};
+
+	DkPageExtractionBatch(Mode mode = mode_crop_to_page, bool alternativeMethod = false);
+
+	void setNumThreads(int numThreads);
+	void setMaxDecoded(int maxDecoded);
+	void setOutputDir(const QString& outputDir);
+
+	DkPageExtractionBatchStats compute(const QStringList& filePaths);
+	void cancel();
+	bool isCanceled() const;
+
+	static QStringList collectImages(const QStringList& paths);
+
+protected:
+	Mode mMode = mode_crop_to_page;
+	bool mAlternativeMethod = false;
+	int mNumThreads = 0;		// 0 -> ideal thread count
+	int mMaxDecoded = 0;		// 0 -> number of threads (no extra limit)
+	QString mOutputDir;
+
+	QAtomicInt mCanceled;
+	QAtomicInt mNumProcessed;
+	QAtomicInt mNumFailed;
+	QAtomicInt mNumNoPage;
+
+	void work(int workerIdx, DkWorkStealingQueue* queue, const QStringList* filePaths, QSemaphore* decodeSlots);
+	bool processPage(const QString& filePath, QSemaphore* decodeSlots);
+	QString outputPath(const QString& filePath) const;
+};
+
+};
@@ -24,6 +24,7 @@
 
 #include "DkPageExtractionPlugin.h"
 #include "DkPageSegmentation.h"
+#include "DkPageEvaluation.h"
 
 #include "DkImageStorage.h"
 #include "DkMetaData.h"
@@ -39,8 +40,6 @@
 #include <QDateTime>
 #include <QDir>
 #include <QSettings>
-
-#include <QXmlStreamReader>
 #pragma warning(pop)		// no warnings from includes - end
 
 namespace nmp {
@@ -140,6 +139,8 @@ QSharedPointer<nmc::DkImageContainer> DkPageExtractionPlugin::runPlugin(
 	bool alternativeMethod = mMethod == m_bhaskar;
 	
 	DkPageSegmentation segM(img, alternativeMethod);
+	segM.singleChannel = mSingleChannel;
+	segM.pyramid = mPyramid;
 
 	// run the page segmentation
 	nmc::DkTimer dt;
@@ -174,7 +175,7 @@ QSharedPointer<nmc::DkImageContainer> DkPageExtractionPlugin::runPlugin(
 
 	//	QImage dImg = imgC->image();
 
-	//	QPolygonF gt = readGT(imgC->filePath());
+	//	QPolygonF gt = DkPageEvaluation::readGT(imgC->filePath());
 	//	
 	//	QPen pen(QColor(100, 200, 50));
 	//	pen.setWidth(10);
@@ -186,7 +187,7 @@ QSharedPointer<nmc::DkImageContainer> DkPageExtractionPlugin::runPlugin(
 	//	segM.draw(dImg);
 	//	imgC->setImage(dImg, tr("Result vs GT"));
 
-	//	double ji = jaccardIndex(imgC->image().size(), gt, segM.getMaxRect().toPolygon());
+	//	double ji = DkPageEvaluation::jaccardIndex(gt, segM.getMaxRect().toPolygon());
 
 	//	QString data = imgC->fileName() + ", " + QString::number(ji) + "\n";
 	//	qDebug() << data;
@@ -209,6 +210,8 @@ void DkPageExtractionPlugin::loadSettings(QSettings & settings) {
 	int mIdx = settings.value("Method", mMethod).toInt();
 	if (mIdx >= 0 && mIdx < m_end)
 		mMethod = (MethodIndex)mIdx;
+	mSingleChannel = settings.value("SingleChannel", mSingleChannel).toBool();
+	mPyramid = settings.value("Pyramid", mPyramid).toBool();
 	settings.endGroup();
 }
 
@@ -216,71 +219,10 @@ void DkPageExtractionPlugin::saveSettings(QSettings & settings) const {
 
 	settings.beginGroup(name());
 	settings.setValue("Method", mMethod);
+	settings.setValue("SingleChannel", mSingleChannel);
+	settings.setValue("Pyramid", mPyramid);
 	settings.endGroup();
 }
 
-QPolygonF DkPageExtractionPlugin::readGT(const QString& imgPath) const {
-
-	QFileInfo imgInfo(imgPath);
-
-	QFileInfo xmlFileI(imgInfo.absolutePath(), imgInfo.baseName() + ".xml");
-
-	if (!xmlFileI.exists()) {
-		qWarning() << "no xml file found: " << xmlFileI.absoluteFilePath();
-		return QPolygonF();
-	}
-	QFile xmlFile(xmlFileI.absoluteFilePath());
-	if (!xmlFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-		qWarning() << "could not load" << xmlFileI.absoluteFilePath();
-		return QPolygonF();
-	}
-
-	QXmlStreamReader xmlReader(&xmlFile);
-	QPolygonF rect;
-
-	while (!xmlReader.atEnd() && !xmlReader.hasError()) {
-
-		QString tag = xmlReader.qualifiedName().toString();
-
-		if (xmlReader.tokenType() == QXmlStreamReader::StartElement && tag == "dmrz") {
-			
-			for (int idx = 0; idx < 4; idx++) {
-
-				QPoint p;
-				p.setX(xmlReader.attributes().value("x" + QString::number(idx)).toInt());
-				p.setY(xmlReader.attributes().value("y" + QString::number(idx)).toInt());
-				rect << p;
-			}
-		}
-		xmlReader.readNext();
-	}
-
-	return rect;
-}
-
-double DkPageExtractionPlugin::jaccardIndex(const QSize & imgSize, const QPolygonF & gt, const QPolygonF & computed) const {
-	
-	cv::Mat gtImg = nmc::DkImage::qImage2Mat(drawPoly(imgSize, gt));
-	cv::Mat evImg = nmc::DkImage::qImage2Mat(drawPoly(imgSize, computed));
-
-	double andVal = (double)cv::sum(gtImg & evImg)[0];
-	double orVal = (double)cv::sum(gtImg | evImg)[0];
-
-	return andVal/orVal;
-}
-
-QImage DkPageExtractionPlugin::drawPoly(const QSize & imgSize, const QPolygonF & poly) const {
-
-	QImage img(imgSize, QImage::Format_RGB888);
-	img.fill(QColor(0, 0, 0));
-
-	QPainter pg(&img);
-	pg.setBrush(QColor(255, 255, 255));
-	pg.drawPolygon(poly);
-
-	return img;
-}
-
-
 };
 
@@ -81,10 +81,8 @@ protected:
 	QString mResultPath;
 
 	MethodIndex mMethod = m_thresholds;
-
-	QPolygonF readGT(const QString& imgPath) const;
-	double jaccardIndex(const QSize& imgSize, const QPolygonF& gt, const QPolygonF& computed) const;
-	QImage drawPoly(const QSize& imgSize, const QPolygonF& poly) const;
+	bool mSingleChannel = false;
+	bool mPyramid = false;
 };
 
 };
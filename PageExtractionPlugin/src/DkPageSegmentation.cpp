@@ -28,12 +28,42 @@
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QDebug>
+#include <QElapsedTimer>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <QPainter>
+
+#include <algorithm>
 #pragma warning(pop)		// no warnings from includes - end
 
 namespace nmp {
 
+// DkRectangleSearch --------------------------------------------------------------------
+/**
+* Runs DkPageSegmentation::findRectangles for a range of (channel, threshold level) tasks.
+* Every task writes to its own candidate list.
+**/
+class DkRectangleSearch : public cv::ParallelLoopBody {
+
+public:
+	DkRectangleSearch(const DkPageSegmentation& segM, const std::vector<cv::Mat>& channels, std::vector<std::vector<DkPolyRect> >& candidates, std::vector<DkPageSegmentationStats>& taskStats) :
+		segM(segM), channels(channels), candidates(candidates), taskStats(taskStats) {}
+
+	void operator()(const cv::Range& range) const override {
+
+		for (int idx = range.start; idx < range.end; idx++) {
+			int c = idx / segM.numThresh;
+			int l = idx % segM.numThresh;
+			segM.findRectangles(channels[c], l, candidates[idx], taskStats[idx]);
+		}
+	}
+
+private:
+	const DkPageSegmentation& segM;
+	const std::vector<cv::Mat>& channels;
+	std::vector<std::vector<DkPolyRect> >& candidates;
+	std::vector<DkPageSegmentationStats>& taskStats;
+};
+
 // DkSegmentBurger --------------------------------------------------------------------
 // This code is based on OpenCV's rectangle sample (squares.cpp)
 DkPageSegmentation::DkPageSegmentation(const cv::Mat& colImg /* = cv::Mat */, bool alternativeMethod /* = false */) : alternativeMethod(alternativeMethod) {
@@ -46,6 +76,11 @@ cv::Mat DkPageSegmentation::getDebugImg() const {
 	return dbgImg;	// is NULL if releaseDebug is DK_RELEASE_IMGS
 }
 
+DkPageSegmentationStats DkPageSegmentation::getStats() const {
+
+	return stats;
+}
+
 DkPolyRect DkPageSegmentation::getMaxRect() const {
 
 	// find the largest rectangle
@@ -68,8 +103,14 @@ DkPolyRect DkPageSegmentation::getMaxRect() const {
 QImage DkPageSegmentation::getCropped(const QImage & img) const {
 
 	if (!rects.empty()) {
+		QElapsedTimer dt;
+		dt.start();
+
 		nmc::DkRotatingRect rr = getMaxRect().toRotatingRect();
-		return cropToRect(img, rr);
+		QImage cImg = cropToRect(img, rr);
+		stats.crop += dt.nsecsElapsed() / 1e6;
+
+		return cImg;
 	}
 
 	return img;	// no document page found
@@ -83,131 +124,297 @@ void DkPageSegmentation::compute() {
 			scale = 700.0f / img.rows;
 			
 		lImg = findRectanglesAlternative(img, rects);
+	} else if (pyramid) {
+		computePyramid();
 	} else {
-		cv::Mat imgLab;
-		
 		if (scale == 1.0f && 960.0f/img.cols < 0.8f)
 			scale = 960.0f/img.cols;
 			
-		cv::cvtColor(img, imgLab, CV_RGB2Lab);	// boost colors
 		lImg = findRectangles(img, rects);
 	}
 
 	qDebug() << "[DkPageSegmentation] " << rects.size() << " rectangles circles found resize factor: " << scale;
 }
 
-cv::Mat DkPageSegmentation::findRectangles(const cv::Mat& img, std::vector<DkPolyRect>& rects) const {
-	
-	cv::Mat tImg, gray;
+/**
+* Coarse-to-fine page detection.
+* Candidates are detected at ~pyramidSize px. The corners of the largest
+* candidates are then refined at increasing resolutions (doubling the scale)
+* by searching the page edges close to the quadrilateral's sides only.
+* The refinement of a candidate stops once its corners move less than cornerResidual.
+**/
+void DkPageSegmentation::computePyramid() {
 
+	float coarseScale = qMin(pyramidSize / qMax(img.cols, img.rows), 1.0f);
+	scale = coarseScale;
 
-	if (scale != 1.0f)
-		cv::resize(img, tImg, cv::Size(), scale, scale, CV_INTER_AREA);	// inter nn -> assuming resize to be 1/(2^n)
+	findRectangles(img, rects);	// rects are in full resolution coordinates
+
+	QElapsedTimer dt;
+	dt.start();
+
+	filterDuplicates(rects);
+	std::sort(rects.begin(), rects.end(), &DkPolyRect::compArea);
+
+	// refine the largest candidates only
+	if ((int)rects.size() > numRefine)
+		rects.erase(rects.begin(), rects.end() - numRefine);
+
+	for (DkPolyRect& r : rects) {
+
+		// corners of the polygon approximation may be a few px off
+		int radius = 6;
+
+		for (float s = qMin(coarseScale*2.0f, 1.0f); ; s = qMin(s*2.0f, 1.0f)) {
+
+			double residual = refineCorners(r, s, radius);
+			radius = 3;
+
+			if (residual < cornerResidual || s >= 1.0f)
+				break;
+		}
+	}
+
+	stats.refine += dt.nsecsElapsed() / 1e6;
+}
+
+/**
+* Moves the rect's corners to the intersections of its refined sides.
+* @param rect the rect to be refined (full resolution coordinates)
+* @param s the scale of the pyramid level
+* @param radius the search radius in level px
+* @return the max corner displacement in full resolution px (DBL_MAX if a side could not be refined)
+**/
+double DkPageSegmentation::refineCorners(DkPolyRect& rect, float s, int radius) const {
+
+	std::vector<nmc::DkVector> corners = rect.getCorners();
+
+	if (corners.size() != 4)
+		return 0.0;
+
+	std::vector<cv::Vec4f> lines(4);
+	std::vector<bool> valid(4, false);
+
+	for (int idx = 0; idx < 4; idx++) {
+		const nmc::DkVector& a = corners[idx];
+		const nmc::DkVector& b = corners[(idx+1) % 4];
+		valid[idx] = fitEdge(cv::Point2f(a.x, a.y), cv::Point2f(b.x, b.y), s, radius, lines[idx]);
+	}
+
+	double residual = 0.0;
+	double maxShift = 2.0 * radius / s;
+
+	for (int idx = 0; idx < 4; idx++) {
+
+		int pIdx = (idx + 3) % 4;
+		cv::Point2f ip;
+
+		if (!valid[pIdx] || !valid[idx] || !intersectLines(lines[pIdx], lines[idx], ip)) {
+			residual = DBL_MAX;
+			continue;
+		}
+
+		nmc::DkVector c(ip.x, ip.y);
+		double shift = (c - corners[idx]).norm();
+
+		// we jumped to another edge
+		if (shift > maxShift) {
+			residual = DBL_MAX;
+			continue;
+		}
+
+		residual = qMax(residual, shift);
+		corners[idx] = c;
+	}
+
+	rect = DkPolyRect(corners);
+
+	return residual;
+}
+
+/**
+* Fits a line to the strongest edge close to the side a-b.
+* The search is done on a local patch that is resized to the level's scale.
+* @param a first corner (full resolution)
+* @param b second corner (full resolution)
+* @param s the scale of the pyramid level
+* @param radius the search radius (along the side's normal) in level px
+* @param line the fitted line (full resolution) as returned by cv::fitLine
+* @return false if not enough edge samples were found
+**/
+bool DkPageSegmentation::fitEdge(const cv::Point2f& a, const cv::Point2f& b, float s, int radius, cv::Vec4f& line) const {
+
+	cv::Point2f dir = b - a;
+	float len = (float)cv::norm(dir);
+
+	if (len * s < 8.0f)
+		return false;
+
+	dir *= 1.0f / len;
+	cv::Point2f n(-dir.y, dir.x);
+
+	// the local patch (full resolution)
+	int pad = cvCeil((radius + 2) / s);
+	cv::Rect roi(cv::Point(cvFloor(qMin(a.x, b.x)) - pad, cvFloor(qMin(a.y, b.y)) - pad),
+				 cv::Point(cvCeil(qMax(a.x, b.x)) + pad + 1, cvCeil(qMax(a.y, b.y)) + pad + 1));
+	roi &= cv::Rect(0, 0, img.cols, img.rows);
+
+	if (roi.width < 3 || roi.height < 3)
+		return false;
+
+	cv::Mat patch;
+	if (s < 1.0f)
+		cv::resize(img(roi), patch, cv::Size(), s, s, CV_INTER_AREA);
 	else
-		tImg = img;
+		patch = img(roi);
 
-	std::vector<std::vector<cv::Point> > contours;
+	cv::Mat gray;
+	if (patch.channels() == 4)
+		cv::cvtColor(patch, gray, CV_BGRA2GRAY);
+	else if (patch.channels() == 3)
+		cv::cvtColor(patch, gray, CV_BGR2GRAY);
+	else
+		gray = patch;
 
-	cv::Mat gray0(tImg.size(), CV_8UC1);
-	cv::Mat lImg(tImg.size(), CV_8UC1);
+	// scale factors of the patch (INTER_AREA maps pixel areas)
+	float sx = (float)gray.cols / roi.width;
+	float sy = (float)gray.rows / roi.height;
 
-	// find squares in every color plane of the image
-	for( int c = 0; c < 3; c++ ) {
+	auto toLevel = [&](const cv::Point2f& p) {
+		return cv::Point2f((p.x - roi.x + 0.5f) * sx - 0.5f, (p.y - roi.y + 0.5f) * sy - 0.5f);
+	};
 
-		int ch[] = {c, 0};
-		mixChannels(&tImg, 1, &gray0, 1, ch, 1);
-		cv::normalize(gray0, gray0, 255, 0, cv::NORM_MINMAX);
+	auto toFull = [&](const cv::Point2f& p) {
+		return cv::Point2f((p.x + 0.5f) / sx - 0.5f + roi.x, (p.y + 0.5f) / sy - 0.5f + roi.y);
+	};
 
-		if (c == 0)	// back-up the luminance channel - we use it as precomputed image for the circle detection
-			lImg = gray0.clone();
+	// bilinear interpolation - returns false outside the patch
+	auto sample = [&](const cv::Point2f& p, float& val) {
 
-		int nT = numThresh;//(c == 0) ? numThresh*2 : numThresh;	// more luminance thresholds
+		int x = cvFloor(p.x);
+		int y = cvFloor(p.y);
 
-							// try several threshold levels
-		for( int l = 0; l < nT; l++ ) {
+		if (x < 0 || y < 0 || x + 1 >= gray.cols || y + 1 >= gray.rows)
+			return false;
 
-			// hack: use Canny instead of zero threshold level.
-			// Canny helps to catch squares with gradient shading
-			if( l == 0 ) {
+		float fx = p.x - x;
+		float fy = p.y - y;
+		const unsigned char* r0 = gray.ptr<unsigned char>(y) + x;
+		const unsigned char* r1 = gray.ptr<unsigned char>(y+1) + x;
 
-				Canny(gray0, gray, thresh, thresh*3, 5);
-				// dilate canny output to remove potential
-				// holes between edge segments
-				dilate(gray, gray, cv::Mat(), cv::Point(-1,-1));
+		val = (1.0f-fy) * ((1.0f-fx) * r0[0] + fx * r0[1]) + fy * ((1.0f-fx) * r1[0] + fx * r1[1]);
+		return true;
+	};
 
-				//DkIP::imwrite("edgeImg.png", gray);
-			}
-			else {
-				gray = gray0 >= (l+1)*255/numThresh;
-			}
+	int numSamples = qBound(8, qRound(len * s / 4.0f), numEdgeSamples);
+	int profileLength = 2 * radius + 3;
 
-			// find contours and store them all as a list
-			findContours(gray, contours, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
+	std::vector<float> profile(profileLength);
+	std::vector<float> grad(profileLength, 0.0f);
+	std::vector<cv::Point2f> edgePts;
 
-			if (looseDetection) {
-				std::vector<std::vector<cv::Point> > hull;
-				for (int i = 0; i < (int)contours.size(); i++) { 
+	for (int idx = 0; idx < numSamples; idx++) {
 
-					double cArea = contourArea(cv::Mat(contours[i]));
+		// skip the corners' surroundings
+		float t = 0.1f + 0.8f * (idx + 0.5f) / numSamples;
+		cv::Point2f q0 = toLevel(a + dir * (t * len));
 
-					if (fabs(cArea) > minArea*scale*scale && (!maxArea || fabs(cArea) < maxArea*(scale*scale))) {
-						std::vector<cv::Point> cHull;
-						cv::convexHull(cv::Mat(contours[i]), cHull, false);
-						hull.push_back(cHull);
-					}
-				}
+		bool inside = true;
+		for (int k = 0; k < profileLength && inside; k++)
+			inside = sample(q0 + n * (float)(k - radius - 1), profile[k]);
 
-				contours = hull;
-			}
+		if (!inside)
+			continue;
 
-			std::vector<cv::Point> approx;
-
-			// DEBUG ------------------------
-			//cv::Mat pImg = image.clone();
-			//cv::cvtColor(pImg, pImg, CV_Lab2RGB);
-			// DEBUG ------------------------
-
-			// test each contour
-			for( size_t i = 0; i < contours.size(); i++ ) {
-				// approxicv::Mate contour with accuracy proportional
-				// to the contour perimeter
-				approxPolyDP(cv::Mat(contours[i]), approx, arcLength(cv::Mat(contours[i]), true)*0.02, true);
-
-				double cArea = contourArea(cv::Mat(approx));
-
-				// DEBUG ------------------------
-				//if (fabs(cArea) < maxArea)
-				//	fillConvexPoly(pImg, &approx[0], (int)approx.size(), DkUtils::blue);
-				// DEBUG ------------------------
-
-				// square contours should have 4 vertices after approxicv::Mation
-				// relatively large area (to filter out noisy contours)
-				// and be convex.
-				// Note: absolute value of an area is used because
-				// area may be positive or negative - in accordance with the
-				// contour orientation
-				if( approx.size() == 4 &&
-					fabs(cArea) > minArea*scale*scale &&
-					(!maxArea || fabs(cArea) < maxArea*scale*scale) && 
-					isContourConvex(cv::Mat(approx)) ) {
-
-					DkPolyRect cr(approx);
-					//moutc << minArea*scale*scale << " < " << fabs(cArea) << " < " << maxArea*scale*scale << dkendl;
-
-					// if cosines of all angles are small
-					// (all angles are ~90 degree)
-					if(/*cr.maxSide() < std::max(tImg.rows, tImg.cols)*maxSideFactor && */
-						(!maxSide || cr.maxSide() < maxSide*scale) && 
-						cr.getMaxCosine() < 0.3 ) {
-						rects.push_back(cr);
-					}
-				}
+		int maxK = -1;
+		float maxG = (float)minEdgeContrast;
+
+		for (int k = 1; k < profileLength - 1; k++) {
+			grad[k] = std::abs(profile[k+1] - profile[k-1]);
+
+			if (grad[k] > maxG) {
+				maxG = grad[k];
+				maxK = k;
 			}
-			// DEBUG ------------------------
-			//cv::cvtColor(pImg, pImg, CV_RGB2BGR);
-			//DkIP::imwrite("polyImg" + DkUtils::stringify(c) + "-" + DkUtils::stringify(l) + ".png", pImg);
-			// DEBUG ------------------------
 		}
+
+		if (maxK == -1)
+			continue;
+
+		// sub-pixel peak
+		float delta = 0.0f;
+		if (maxK > 1 && maxK < profileLength - 2) {
+			float den = grad[maxK-1] - 2.0f * grad[maxK] + grad[maxK+1];
+			if (std::abs(den) > FLT_EPSILON)
+				delta = qBound(-0.5f, 0.5f * (grad[maxK-1] - grad[maxK+1]) / den, 0.5f);
+		}
+
+		edgePts.push_back(toFull(q0 + n * (maxK - radius - 1 + delta)));
+	}
+
+	if ((int)edgePts.size() < qMax(numSamples / 2, 2))
+		return false;
+
+	cv::fitLine(edgePts, line, CV_DIST_HUBER, 0, 0.01, 0.01);
+
+	return true;
+}
+
+bool DkPageSegmentation::intersectLines(const cv::Vec4f& l1, const cv::Vec4f& l2, cv::Point2f& ip) const {
+
+	cv::Point2f v1(l1[0], l1[1]), p1(l1[2], l1[3]);
+	cv::Point2f v2(l2[0], l2[1]), p2(l2[2], l2[3]);
+
+	float cross = v1.x * v2.y - v1.y * v2.x;
+
+	// (nearly) parallel
+	if (std::abs(cross) < 1e-3f)
+		return false;
+
+	cv::Point2f d = p2 - p1;
+	float t = (d.x * v2.y - d.y * v2.x) / cross;
+	ip = p1 + v1 * t;
+
+	return true;
+}
+
+cv::Mat DkPageSegmentation::findRectangles(const cv::Mat& img, std::vector<DkPolyRect>& rects) const {
+	
+	cv::Mat tImg;
+	QElapsedTimer dt;
+	dt.start();
+
+	if (scale != 1.0f)
+		cv::resize(img, tImg, cv::Size(), scale, scale, CV_INTER_AREA);	// inter nn -> assuming resize to be 1/(2^n)
+	else
+		tImg = img;
+
+	// normalize the color planes once - they are shared (read-only) by all threshold levels
+	int numChannels = singleChannel ? 1 : 3;
+	std::vector<cv::Mat> channels;
+
+	for (int c = 0; c < numChannels; c++) {
+
+		cv::Mat gray0(tImg.size(), CV_8UC1);
+		int ch[] = {c, 0};
+		mixChannels(&tImg, 1, &gray0, 1, ch, 1);
+		cv::normalize(gray0, gray0, 255, 0, cv::NORM_MINMAX);
+		channels.push_back(gray0);
+	}
+
+	// back-up the luminance channel - we use it as precomputed image for the circle detection
+	cv::Mat lImg = channels[0];
+	stats.resize += dt.nsecsElapsed() / 1e6;
+
+	// find squares in every color plane of the image - each plane/threshold pair is an independent task
+	std::vector<std::vector<DkPolyRect> > candidates(numChannels * numThresh);
+	std::vector<DkPageSegmentationStats> taskStats(candidates.size());
+	cv::parallel_for_(cv::Range(0, (int)candidates.size()), DkRectangleSearch(*this, channels, candidates, taskStats));
+
+	// merge in the sequential (channel-major) order - so the result is deterministic
+	for (size_t idx = 0; idx < candidates.size(); idx++) {
+		rects.insert(rects.end(), candidates[idx].begin(), candidates[idx].end());
+		stats += taskStats[idx];
 	}
 
 	for (size_t idx = 0; idx < rects.size(); idx++)
@@ -231,15 +438,105 @@ cv::Mat DkPageSegmentation::findRectangles(const cv::Mat& img, std::vector<DkPol
 	return lImg;
 }
 
+void DkPageSegmentation::findRectangles(const cv::Mat& gray0, int level, std::vector<DkPolyRect>& rects, DkPageSegmentationStats& taskStats) const {
+
+	cv::Mat gray;
+	std::vector<std::vector<cv::Point> > contours;
+	QElapsedTimer dt;
+	dt.start();
+
+	// hack: use Canny instead of zero threshold level.
+	// Canny helps to catch squares with gradient shading
+	if (level == 0) {
+
+		Canny(gray0, gray, thresh, thresh*3, 5);
+		// dilate canny output to remove potential
+		// holes between edge segments
+		dilate(gray, gray, cv::Mat(), cv::Point(-1,-1));
+
+		//DkIP::imwrite("edgeImg.png", gray);
+	}
+	else {
+		gray = gray0 >= (level+1)*255/numThresh;
+	}
+
+	taskStats.edges += dt.nsecsElapsed() / 1e6;
+	dt.restart();
+
+	// find contours and store them all as a list
+	findContours(gray, contours, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
+
+	if (looseDetection) {
+		std::vector<std::vector<cv::Point> > hull;
+		for (int i = 0; i < (int)contours.size(); i++) { 
+
+			double cArea = contourArea(cv::Mat(contours[i]));
+
+			if (fabs(cArea) > minArea*scale*scale && (!maxArea || fabs(cArea) < maxArea*(scale*scale))) {
+				std::vector<cv::Point> cHull;
+				cv::convexHull(cv::Mat(contours[i]), cHull, false);
+				hull.push_back(cHull);
+			}
+		}
+
+		contours = hull;
+	}
+
+	std::vector<cv::Point> approx;
+
+	// test each contour
+	for( size_t i = 0; i < contours.size(); i++ ) {
+		// approxicv::Mate contour with accuracy proportional
+		// to the contour perimeter
+		approxPolyDP(cv::Mat(contours[i]), approx, arcLength(cv::Mat(contours[i]), true)*0.02, true);
+
+		double cArea = contourArea(cv::Mat(approx));
+
+		// square contours should have 4 vertices after approxicv::Mation
+		// relatively large area (to filter out noisy contours)
+		// and be convex.
+		// Note: absolute value of an area is used because
+		// area may be positive or negative - in accordance with the
+		// contour orientation
+		if( approx.size() == 4 &&
+			fabs(cArea) > minArea*scale*scale &&
+			(!maxArea || fabs(cArea) < maxArea*scale*scale) && 
+			isContourConvex(cv::Mat(approx)) ) {
+
+			DkPolyRect cr(approx);
+
+			// if cosines of all angles are small
+			// (all angles are ~90 degree)
+			if((!maxSide || cr.maxSide() < maxSide*scale) && 
+				cr.getMaxCosine() < 0.3 ) {
+				rects.push_back(cr);
+			}
+		}
+	}
+
+	taskStats.contours += dt.nsecsElapsed() / 1e6;
+}
+
 cv::Mat DkPageSegmentation::findRectanglesAlternative(const cv::Mat& img, std::vector<DkPolyRect>& rects) const {
 	PageExtractor extractor;
-	extractor.findPage(img, scale, rects);
+	extractor.findPage(img, scale, rects, &stats);
 
 	return img;
 }
 
 QImage DkPageSegmentation::cropToRect(const QImage & img, const nmc::DkRotatingRect & rect, const QColor & bgCol) const {
 	
+	QImage cImg = DkRectCropper::crop(img, rect, bgCol);
+
+	// fall back to QPainter if the cropper cannot handle the image
+	if (cImg.isNull())
+		cImg = renderToRect(img, rect, bgCol);
+
+	return cImg;
+}
+
+QImage DkPageSegmentation::renderToRect(const QImage & img, const nmc::DkRotatingRect & rect, const QColor & bgCol) const {
+	
 	QTransform tForm; 
 	QPointF cImgSize;
 
@@ -249,9 +546,6 @@ QImage DkPageSegmentation::cropToRect(const QImage & img, const nmc::DkRotatingR
 		return img;
 	}
 
-	qDebug() << cImgSize;
-	qDebug() << "transform: " << tForm;
-
 	double angle = nmc::DkMath::normAngleRad(rect.getAngle(), 0, CV_PI*0.5);
 	double minD = qMin(abs(angle), abs(angle-CV_PI*0.5));
 
@@ -270,67 +564,81 @@ QImage DkPageSegmentation::cropToRect(const QImage & img, const nmc::DkRotatingR
 	painter.end();
 
 	return cImg;
-
-	//QImage dImg = img;
-	//QPainter p1(&dImg);
-	//p1.drawPolygon(rect.getPoly());
-
-	//return dImg;
 }
 
 void DkPageSegmentation::filterDuplicates(float overlap, float areaRatio) {
 
+	QElapsedTimer dt;
+	dt.start();
+
 	filterDuplicates(rects, overlap, areaRatio);
+	stats.filter += dt.nsecsElapsed() / 1e6;
 }
 
 void DkPageSegmentation::filterDuplicates(std::vector<DkPolyRect>& rects, float overlap, float areaRatio) const {
 
-	std::vector<int> delIdx;
 	std::sort(rects.rbegin(), rects.rend(), &DkPolyRect::compArea);	// rbegin() -> sort descending
 
-	for (int idx = 0; idx < (int)rects.size(); idx++) {
+	const int numRects = (int)rects.size();
+	std::vector<double> areas(numRects);
+	std::vector<DkBox> boxes(numRects);
+
+	for (int idx = 0; idx < numRects; idx++) {
+		areas[idx] = rects[idx].getArea();
+		boxes[idx] = rects[idx].getBBox();
+	}
+
+	// only rectangles with overlapping bounding boxes can be duplicates (if overlap >= 0)
+	std::vector<std::vector<int> > candidates = overlap >= 0 ? overlappingBoxes(boxes) : std::vector<std::vector<int> >(numRects);
+
+	if (overlap < 0) {
+		for (int idx = 0; idx < numRects; idx++)
+			for (int oIdx = idx+1; oIdx < numRects; oIdx++)
+				candidates[idx].push_back(oIdx);
+	}
+
+	std::vector<bool> deleted(numRects, false);
+	int numDeleted = 0;
+
+	for (int idx = 0; idx < numRects; idx++) {
 
 		// if we already deleted a rectangle, we can safely skip it
-		if (std::find(delIdx.begin(), delIdx.end(), idx) != delIdx.end())
+		if (deleted[idx])
 			continue;
 
 		DkPolyRect& cR = rects[idx];
-		double cA = cR.getArea();
+		double cA = areas[idx];
 
 		std::vector<int> tmpDelIdx;
 
-		for (int oIdx = idx+1; oIdx < (int)rects.size(); oIdx++) {
+		// candidates are sorted ascending - hence we visit them in the same order as the full pairwise comparison
+		for (int oIdx : candidates[idx]) {
 
 			// if we already deleted a rectangle, we can safely skip it
-			if (idx == oIdx || std::find(delIdx.begin(), delIdx.end(), oIdx) != delIdx.end())
+			if (deleted[oIdx])
 				continue;
 
 			DkPolyRect& oR = rects[oIdx];
-			double oA = oR.getArea();
+			double oA = areas[oIdx];
 
 			// ignore rectangles with totally different area
-			if (oA/cA < areaRatio)	// since we sort, we know that oA is larger
+			if (oA/cA < areaRatio)	// since we sort, we know that all remaining rects are smaller
+				break;
+
+			// cheap reject: the intersection cannot be larger than the bounding boxes' intersection
+			// (the tolerance accounts for DkIntersectPoly's integer grid)
+			double boxIntersection = intersectArea(boxes[idx], boxes[oIdx]);
+			if (boxIntersection < overlap * std::min(cA, oA) * (1.0 - 1e-3))
 				continue;
 
 			double intersection = abs(oR.intersectArea(cR));
 
-			if (std::max(intersection/cR.getArea(), intersection/oR.getArea()) > overlap) {
-
-				double cVal, oVal;
-
-				// if the cosine is more or less the same, take the larger rectangle
-				//if (fabs(cR.getMaxCosine() - oR.getMaxCosine()) < 0.02) {
-				//	cVal = oA;	// inverse since we want to prefer larger areas
-				//	oVal = cA;
-				//}
-				//else {
-				cVal = cR.getMaxCosine();
-				oVal = oR.getMaxCosine();
-				//}
+			if (std::max(intersection/cA, intersection/oA) > overlap) {
 
 				// delete the rect which has an inferior cosine value
-				if (cVal > oVal) {
-					delIdx.push_back(idx);
+				if (cR.getMaxCosine() > oR.getMaxCosine()) {
+					deleted[idx] = true;
+					numDeleted++;
 					tmpDelIdx.clear();
 					break; // we're done if we delete the current rect
 				}
@@ -340,15 +648,18 @@ void DkPageSegmentation::filterDuplicates(std::vector<DkPolyRect>& rects, float
 			}
 		}
 
-		delIdx.insert(delIdx.end(), tmpDelIdx.begin(), tmpDelIdx.end());
+		for (int dIdx : tmpDelIdx) {
+			deleted[dIdx] = true;
+			numDeleted++;
+		}
 	}
 
-	if (!delIdx.empty()) {
+	if (numDeleted > 0) {
 		std::vector<DkPolyRect> filtered;
 
-		for (int idx = 0; idx < (int)rects.size(); idx++) {
+		for (int idx = 0; idx < numRects; idx++) {
 
-			if (std::find(delIdx.begin(), delIdx.end(), idx) == delIdx.end())
+			if (!deleted[idx])
 				filtered.push_back(rects[idx]);
 		}
 
@@ -357,6 +668,55 @@ void DkPageSegmentation::filterDuplicates(std::vector<DkPolyRect>& rects, float
 	}
 }
 
+/**
+* Finds all pairs of overlapping boxes using a sweep along the x axis.
+* @param boxes the bounding boxes
+* @return for every box the (ascending) indices of all boxes with a larger index it overlaps with
+**/
+std::vector<std::vector<int> > DkPageSegmentation::overlappingBoxes(const std::vector<DkBox>& boxes) const {
+
+	std::vector<std::vector<int> > pairs(boxes.size());
+
+	std::vector<int> order(boxes.size());
+	for (int idx = 0; idx < (int)order.size(); idx++)
+		order[idx] = idx;
+
+	std::sort(order.begin(), order.end(), [&boxes](int l, int r) { return boxes[l].uc.x < boxes[r].uc.x; });
+
+	std::vector<int> active;
+
+	for (int idx : order) {
+
+		const DkBox& b = boxes[idx];
+
+		// remove boxes that end before the current one starts
+		active.erase(std::remove_if(active.begin(), active.end(), [&](int a) { return boxes[a].lc.x <= b.uc.x; }), active.end());
+
+		for (int a : active) {
+
+			const DkBox& ab = boxes[a];
+
+			if (ab.uc.y < b.lc.y && b.uc.y < ab.lc.y)
+				pairs[std::min(a, idx)].push_back(std::max(a, idx));
+		}
+
+		active.push_back(idx);
+	}
+
+	for (std::vector<int>& p : pairs)
+		std::sort(p.begin(), p.end());
+
+	return pairs;
+}
+
+double DkPageSegmentation::intersectArea(const DkBox& b1, const DkBox& b2) const {
+
+	double w = std::min(b1.lc.x, b2.lc.x) - std::max(b1.uc.x, b2.uc.x);
+	double h = std::min(b1.lc.y, b2.lc.y) - std::max(b1.uc.y, b2.uc.y);
+
+	return (w > 0 && h > 0) ? w*h : 0.0;
+}
+
 void DkPageSegmentation::draw(cv::Mat& img, const cv::Scalar& col) const {
 
 	draw(img, rects, col);
@@ -35,9 +35,12 @@
 namespace nmp {
 
 class DkRotatingRect;
+class DkRectangleSearch;
 
 class DkPageSegmentation {
 
+	friend class DkRectangleSearch;
+
 public:
 	DkPageSegmentation(const cv::Mat& colImg = cv::Mat(), bool alternativeMethod = false);
 
@@ -52,8 +55,11 @@ public:
 	virtual void draw(QImage& img, const QColor& col = QColor(255, 222, 0)) const;
 	virtual void draw(cv::Mat& img, const std::vector<DkPolyRect>& rects, const cv::Scalar& col = cv::Scalar(255, 222, 0)) const;
 	DkPolyRect getMaxRect() const;
+	DkPageSegmentationStats getStats() const;
 
-	bool looseDetection;
+	bool looseDetection = false;
+	bool singleChannel = false;	// if true, all thresholds run on the first (normalized) color plane only
+	bool pyramid = false;		// if true, pages are detected at ~pyramidSize px and refined coarse-to-fine
 
 protected:
 	cv::Mat img;
@@ -68,11 +74,26 @@ protected:
 	float scale = 1.0f;
 	bool alternativeMethod;
 
+	float pyramidSize = 240.0f;		// max side of the coarse level
+	int numRefine = 3;				// number of candidates refined
+	int numEdgeSamples = 32;		// max number of edge samples per side
+	double cornerResidual = 1.0;	// stop refining if corners move less (full resolution px)
+	double minEdgeContrast = 10.0;	// min gradient of an edge sample
+
 	std::vector<DkPolyRect> rects;
+	mutable DkPageSegmentationStats stats;
 
 	virtual cv::Mat findRectangles(const cv::Mat& img, std::vector<DkPolyRect>& squares) const;
+	void findRectangles(const cv::Mat& gray0, int level, std::vector<DkPolyRect>& squares, DkPageSegmentationStats& taskStats) const;
+	virtual void computePyramid();
+	double refineCorners(DkPolyRect& rect, float s, int radius) const;
+	bool fitEdge(const cv::Point2f& a, const cv::Point2f& b, float s, int radius, cv::Vec4f& line) const;
+	bool intersectLines(const cv::Vec4f& l1, const cv::Vec4f& l2, cv::Point2f& ip) const;
 	virtual cv::Mat findRectanglesAlternative(const cv::Mat& img, std::vector<DkPolyRect>& squares) const;
+	std::vector<std::vector<int> > overlappingBoxes(const std::vector<DkBox>& boxes) const;
+	double intersectArea(const DkBox& b1, const DkBox& b2) const;
 	QImage cropToRect(const QImage& img, const nmc::DkRotatingRect& rect, const QColor& bgCol = QColor(0,0,0)) const;
+	QImage renderToRect(const QImage& img, const nmc::DkRotatingRect& rect, const QColor& bgCol = QColor(0,0,0)) const;
 	void drawRects(QPainter* p, const std::vector<DkPolyRect>& rects, const QColor& col = QColor(100, 100, 100)) const;
 };
 
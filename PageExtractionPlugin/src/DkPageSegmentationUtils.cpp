@@ -23,16 +23,244 @@
  *******************************************************************************************************/
 
 #include <algorithm>
+#include <climits>
 
 #include "DkPageSegmentationUtils.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QTransform>
 #include <opencv2/imgproc/imgproc.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DK_HOUGH_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 #pragma warning(pop)		// no warnings from includes - end
 
 namespace nmp {
 
+// DkEdgePlaneDecomposition --------------------------------------------------------------------
+/**
+* Fused edge plane decomposition of PageExtractor::removeText.
+* Every edge pixel gets a bitmask with the bit of its gradient octant set.
+* OR-ing these masks over the structuring element dilates all 8 edge
+* planes at once. H (the number of octants in the neighbourhood) is then
+* the popcount of the dilated mask. Tiles only hold tileHeight + halo rows.
+**/
+class DkEdgePlaneDecomposition : public cv::ParallelLoopBody {
+
+public:
+	DkEdgePlaneDecomposition(const cv::Mat& gray, const cv::Mat& bw, const cv::Mat& selem, int threshold, int tileHeight, cv::Mat& dst) :
+		gray(gray), bw(bw), threshold(threshold), tileHeight(tileHeight), dst(dst) {
+
+		anchorY = selem.rows / 2;
+		int anchorX = selem.cols / 2;
+
+		// the extent of each structuring element row (ellipse rows are contiguous)
+		for (int ky = 0; ky < selem.rows; ky++) {
+
+			cv::Point e(INT_MAX, INT_MIN);
+			const unsigned char* sp = selem.ptr<unsigned char>(ky);
+
+			for (int kx = 0; kx < selem.cols; kx++) {
+				if (sp[kx]) {
+					e.x = std::min(e.x, kx - anchorX);
+					e.y = std::max(e.y, kx - anchorX);
+				}
+			}
+			extents.push_back(e);
+		}
+
+		for (int idx = 0; idx < 256; idx++) {
+			int cnt = 0;
+			for (int b = idx; b; b >>= 1)
+				cnt += b & 1;
+			popCount[idx] = (unsigned char)cnt;
+		}
+	}
+
+	/**
+	* Returns the octant of atan2(v, h) mapped to [0, 2pi) using sign and magnitude comparisons only.
+	**/
+	static inline int gradientOctant(float h, float v) {
+
+		// upper half plane [0, pi) - note that atan2(0, h < 0) = pi
+		if (v > 0 || (v == 0 && h >= 0)) {
+			if (h > 0)
+				return v < h ? 0 : 1;
+			return v > -h ? 2 : 3;
+		}
+
+		if (h < 0)
+			return v > h ? 4 : 5;
+		return -v > h ? 6 : 7;
+	}
+
+	void operator()(const cv::Range& range) const override {
+
+		static const float eps = 0.001f;
+		const int cols = gray.cols;
+
+		cv::Mat sobel_h, sobel_v, codes;
+		std::vector<unsigned char> acc(cols);
+
+		for (int t = range.start; t < range.end; t++) {
+
+			int y0 = t * tileHeight;
+			int y1 = std::min(y0 + tileHeight, gray.rows);
+			int sy0 = std::max(y0 - anchorY, 0);
+			int sy1 = std::min(y1 + (int)extents.size() - 1 - anchorY, gray.rows);
+
+			// filters on a ROI read the parent's border rows - hence identical to the full frame
+			cv::Sobel(gray.rowRange(sy0, sy1), sobel_h, CV_32F, 0, 1, 3);
+			cv::Sobel(gray.rowRange(sy0, sy1), sobel_v, CV_32F, 1, 0, 3);
+
+			// octant codes of all edge pixels
+			codes.create(sy1 - sy0, cols, CV_8U);
+			for (int r = 0; r < codes.rows; r++) {
+
+				const float* hp = sobel_h.ptr<float>(r);
+				const float* vp = sobel_v.ptr<float>(r);
+				const unsigned char* bp = bw.ptr<unsigned char>(sy0 + r);
+				unsigned char* cp = codes.ptr<unsigned char>(r);
+
+				for (int c = 0; c < cols; c++) {
+					bool isEdge = bp[c] && (std::abs(hp[c]) > eps || std::abs(vp[c]) > eps);
+					cp[c] = isEdge ? (unsigned char)(1 << gradientOctant(hp[c], vp[c])) : 0;
+				}
+			}
+
+			for (int y = y0; y < y1; y++) {
+
+				std::fill(acc.begin(), acc.end(), (unsigned char)0);
+
+				// dilate all octant planes at once
+				for (int ky = 0; ky < (int)extents.size(); ky++) {
+
+					int sy = y + ky - anchorY;
+					const cv::Point& e = extents[ky];
+
+					if (sy < 0 || sy >= gray.rows || e.x > e.y)
+						continue;
+
+					const unsigned char* cp = codes.ptr<unsigned char>(sy - sy0);
+
+					for (int dx = e.x; dx <= e.y; dx++) {
+
+						int cs = std::max(-dx, 0);
+						int ce = std::min(cols - dx, cols);
+
+						for (int c = cs; c < ce; c++)
+							acc[c] |= cp[c + dx];
+					}
+				}
+
+				// remove text regions: keep edges which see at most threshold orientations
+				const unsigned char* cp = codes.ptr<unsigned char>(y - sy0);
+				unsigned char* dp = dst.ptr<unsigned char>(y);
+
+				for (int c = 0; c < cols; c++)
+					dp[c] = (cp[c] && popCount[acc[c]] <= threshold) ? 255 : 0;
+			}
+		}
+	}
+
+private:
+	const cv::Mat& gray;
+	const cv::Mat& bw;
+	int threshold;
+	int tileHeight;
+	cv::Mat& dst;
+
+	int anchorY = 0;
+	std::vector<cv::Point> extents;
+	unsigned char popCount[256];
+};
+
+// DkHoughAccumulator --------------------------------------------------------------------
+/**
+* Fills the hough accumulator for a range of angles.
+* The accumulator is stored angle-major (numAngle x numRho) so that
+* every stripe of angles writes to its own rows and no merge is needed.
+* The rho index is computed with exactly the same double precision
+* expression as before and the SIMD conversions round to nearest even
+* (just like cvRound) - hence the accumulator is bit identical.
+**/
+class DkHoughAccumulator : public cv::ParallelLoopBody {
+
+public:
+	DkHoughAccumulator(cv::Mat& accumT, const std::vector<double>& xs, const std::vector<double>& ys,
+		const std::vector<double>& tabCos, const std::vector<double>& tabSin, double rho, int rhoOffset) :
+		accumT(accumT), xs(xs), ys(ys), tabCos(tabCos), tabSin(tabSin), rho(rho), rhoOffset(rhoOffset) {}
+
+	void operator()(const cv::Range& range) const override {
+
+		const int numPts = (int)xs.size();
+		const double* px = xs.data();
+		const double* py = ys.data();
+
+		for (int n = range.start; n < range.end; n++) {
+
+			std::uint16_t* acc = accumT.ptr<std::uint16_t>(n + 1) + rhoOffset + 1;
+			const double c = tabCos[n];
+			const double s = tabSin[n];
+			int k = 0;
+
+#if defined(__AVX__)
+			const __m256d vc = _mm256_set1_pd(c);
+			const __m256d vs = _mm256_set1_pd(s);
+			const __m256d vr = _mm256_set1_pd(rho);
+			alignas(16) int r[4];
+
+			for (; k <= numPts - 4; k += 4) {
+				__m256d v = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(px + k), vc), _mm256_mul_pd(_mm256_loadu_pd(py + k), vs));
+				_mm_store_si128((__m128i*)r, _mm256_cvtpd_epi32(_mm256_div_pd(v, vr)));
+				acc[r[0]]++; acc[r[1]]++; acc[r[2]]++; acc[r[3]]++;
+			}
+#elif defined(DK_HOUGH_SSE2)
+			const __m128d vc = _mm_set1_pd(c);
+			const __m128d vs = _mm_set1_pd(s);
+			const __m128d vr = _mm_set1_pd(rho);
+
+			for (; k <= numPts - 2; k += 2) {
+				__m128d v = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(px + k), vc), _mm_mul_pd(_mm_loadu_pd(py + k), vs));
+				__m128i r = _mm_cvtpd_epi32(_mm_div_pd(v, vr));
+				acc[_mm_cvtsi128_si32(r)]++;
+				acc[_mm_cvtsi128_si32(_mm_srli_si128(r, 4))]++;
+			}
+#elif defined(__aarch64__)
+			const float64x2_t vc = vdupq_n_f64(c);
+			const float64x2_t vs = vdupq_n_f64(s);
+			const float64x2_t vr = vdupq_n_f64(rho);
+
+			for (; k <= numPts - 2; k += 2) {
+				float64x2_t v = vaddq_f64(vmulq_f64(vld1q_f64(px + k), vc), vmulq_f64(vld1q_f64(py + k), vs));
+				int64x2_t r = vcvtnq_s64_f64(vdivq_f64(v, vr));	// round to nearest even
+				acc[vgetq_lane_s64(r, 0)]++;
+				acc[vgetq_lane_s64(r, 1)]++;
+			}
+#endif
+			for (; k < numPts; k++)
+				acc[cvRound((px[k] * c + py[k] * s) / rho)]++;
+		}
+	}
+
+private:
+	cv::Mat& accumT;
+	const std::vector<double>& xs;
+	const std::vector<double>& ys;
+	const std::vector<double>& tabCos;
+	const std::vector<double>& tabSin;
+	double rho;
+	int rhoOffset;
+};
+
 
 // DkIntersectPoly --------------------------------------------------------------------
 DkIntersectPoly::DkIntersectPoly() {};
@@ -209,6 +437,157 @@ void DkIntersectPoly::computeBoundingBox(std::vector<nmc::DkVector> vec, nmc::Dk
 	}
 };
 
+// DkRectCropper --------------------------------------------------------------------
+/**
+* Crops the rotating rect from img.
+* The output has the same pixel format as img (unsupported formats are converted to ARGB32).
+* @param img the source image
+* @param rect the rect to be cropped
+* @param bgCol the color of pixels outside the source image
+* @param interpolation cv::INTER_LINEAR or cv::INTER_CUBIC (used for rotated rects only)
+* @return the cropped image
+**/
+QImage DkRectCropper::crop(const QImage& img, const nmc::DkRotatingRect& rect, const QColor& bgCol, int interpolation) {
+
+	QTransform tForm;
+	QPointF cImgSize;
+
+	rect.getTransform(tForm, cImgSize);
+
+	if (cImgSize.x() < 0.5f || cImgSize.y() < 0.5f)
+		return img;
+
+	QImage src = isSupported(img.format()) ? img : img.convertToFormat(QImage::Format_ARGB32);
+	QSize size(qRound(cImgSize.x()), qRound(cImgSize.y()));
+
+	// axis-aligned with integer offset? -> plain copy
+	const double eps = 1e-6;
+	QPointF offset(tForm.dx(), tForm.dy());
+
+	if (qAbs(tForm.m11() - 1.0) < eps && qAbs(tForm.m22() - 1.0) < eps &&
+		qAbs(tForm.m12()) < eps && qAbs(tForm.m21()) < eps &&
+		qAbs(offset.x() - qRound(offset.x())) < eps && qAbs(offset.y() - qRound(offset.y())) < eps) {
+
+		return copyRows(src, size, offset.toPoint(), bgCol);
+	}
+
+	// remap uses short coordinates internally
+	if (src.width() > SHRT_MAX || src.height() > SHRT_MAX) {
+		qWarning() << "[DkRectCropper] image is too large for warping:" << src.size();
+		return QImage();
+	}
+
+	return warp(src, size, tForm, bgCol, interpolation);
+}
+
+bool DkRectCropper::isSupported(QImage::Format format) {
+
+	return cvType(format) != -1;
+}
+
+int DkRectCropper::cvType(QImage::Format format) {
+
+	switch (format) {
+	case QImage::Format_Grayscale8:
+	case QImage::Format_Indexed8:
+		return CV_8UC1;
+	case QImage::Format_RGB888:
+		return CV_8UC3;
+	case QImage::Format_RGB32:
+	case QImage::Format_ARGB32:
+	case QImage::Format_ARGB32_Premultiplied:
+		return CV_8UC4;
+	default:
+		return -1;
+	}
+}
+
+cv::Scalar DkRectCropper::bgValue(const QImage& img, const QColor& bgCol) {
+
+	switch (img.format()) {
+	case QImage::Format_Grayscale8:
+		return cv::Scalar(qGray(bgCol.rgb()));
+	case QImage::Format_Indexed8:
+		return cv::Scalar(qMax(img.colorTable().indexOf(bgCol.rgb()), 0));
+	case QImage::Format_RGB888:
+		return cv::Scalar(bgCol.red(), bgCol.green(), bgCol.blue());
+	case QImage::Format_RGB32:
+		return cv::Scalar(bgCol.blue(), bgCol.green(), bgCol.red(), 255);
+	default: {
+		// (A)RGB32 is stored as BGRA (little endian)
+		QRgb c = img.format() == QImage::Format_ARGB32_Premultiplied ? qPremultiply(bgCol.rgba()) : bgCol.rgba();
+		return cv::Scalar(qBlue(c), qGreen(c), qRed(c), qAlpha(c));
+	}
+	}
+}
+
+QImage DkRectCropper::copyRows(const QImage& img, const QSize& size, const QPoint& offset, const QColor& bgCol) {
+
+	QImage cImg(size, img.format());
+	cImg.setColorTable(img.colorTable());
+
+	cv::Mat cMat(cImg.height(), cImg.width(), cvType(cImg.format()), cImg.bits(), cImg.bytesPerLine());
+	cMat.setTo(bgValue(img, bgCol));
+
+	// destination coordinates = source coordinates + offset
+	QRect srcRect = QRect(-offset, size).intersected(img.rect());
+
+	if (srcRect.isEmpty())
+		return cImg;
+
+	int bpp = img.depth() / 8;
+	int numBytes = srcRect.width() * bpp;
+
+	for (int y = srcRect.top(); y <= srcRect.bottom(); y++) {
+
+		const uchar* sp = img.constScanLine(y) + srcRect.left() * bpp;
+		uchar* dp = cImg.scanLine(y + offset.y()) + (srcRect.left() + offset.x()) * bpp;
+		memcpy(dp, sp, numBytes);
+	}
+
+	return cImg;
+}
+
+QImage DkRectCropper::warp(const QImage& img, const QSize& size, const QTransform& tForm, const QColor& bgCol, int interpolation) {
+
+	QImage cImg(size, img.format());
+	cImg.setColorTable(img.colorTable());
+
+	// no interpolation of palette indices
+	if (img.format() == QImage::Format_Indexed8)
+		interpolation = cv::INTER_NEAREST;
+
+	const cv::Mat src(img.height(), img.width(), cvType(img.format()), const_cast<uchar*>(img.constBits()), img.bytesPerLine());
+	cv::Mat dst(cImg.height(), cImg.width(), cvType(cImg.format()), cImg.bits(), cImg.bytesPerLine());
+
+	// QTransform maps pixel areas, OpenCV maps pixel centers: x' = A(x + 0.5) + t - 0.5
+	cv::Mat M = (cv::Mat_<double>(2, 3) <<
+		tForm.m11(), tForm.m21(), tForm.dx() + 0.5 * (tForm.m11() + tForm.m21()) - 0.5,
+		tForm.m12(), tForm.m22(), tForm.dy() + 0.5 * (tForm.m12() + tForm.m22()) - 0.5);
+
+	// warpAffine is tiled & parallel and only computes the destination pixels
+	cv::warpAffine(src, dst, M, dst.size(), interpolation, cv::BORDER_CONSTANT, bgValue(img, bgCol));
+
+	return cImg;
+}
+
+// DkPageSegmentationStats --------------------------------------------------------------------
+DkPageSegmentationStats& DkPageSegmentationStats::operator+=(const DkPageSegmentationStats& o) {
+
+	resize += o.resize;
+	edges += o.edges;
+	contours += o.contours;
+	filter += o.filter;
+	refine += o.refine;
+	crop += o.crop;
+
+	return *this;
+}
+
+double DkPageSegmentationStats::total() const {
+	return resize + edges + contours + filter + refine + crop;
+}
+
 // DkPolyRect --------------------------------------------------------------------
 DkPolyRect::DkPolyRect(const std::vector<cv::Point>& pts) {
 
@@ -427,14 +806,20 @@ QPolygonF DkPolyRect::toPolygon() const {
 	return poly;
 }
 
-void PageExtractor::findPage(cv::Mat img, float scale, std::vector<DkPolyRect>& rects) {
+void PageExtractor::findPage(cv::Mat img, float scale, std::vector<DkPolyRect>& rects, DkPageSegmentationStats* stats) {
 	cv::Mat gray, bw;
+	QElapsedTimer dt;
+	dt.start();
 
 	cv::cvtColor(img, gray, CV_RGB2GRAY);
 	if (scale != 1.0f) {
 		cv::resize(gray, gray, cv::Size(), scale, scale, CV_INTER_AREA);	// inter nn -> assuming resize to be 1/(2^n)
 	}
 	const int smallerSide = std::min(gray.size().width, gray.size().height);
+
+	if (stats)
+		stats->resize += dt.nsecsElapsed() / 1e6;
+	dt.restart();
 	
 	cv::equalizeHist(gray, gray);
 	bw = removeText(gray, 2.0f, 5, 2);
@@ -442,6 +827,17 @@ void PageExtractor::findPage(cv::Mat img, float scale, std::vector<DkPolyRect>&
 //	cv::waitKey(0);
 	
 	cv::dilate(bw, bw, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3)));
+
+	if (stats)
+		stats->edges += dt.nsecsElapsed() / 1e6;
+	dt.restart();
+
+	// the remaining steps (hough, line segments and rectangle fitting) are accounted for as contours
+	struct StageTimer {
+		QElapsedTimer& dt;
+		DkPageSegmentationStats* stats;
+		~StageTimer() { if (stats) stats->contours += dt.nsecsElapsed() / 1e6; }
+	} stageTimer {dt, stats};
 	
 	cv::Mat lineImg;
 	int accMin = (int)(houghPeakThresholdRel * std::min(bw.size().width, bw.size().height));
@@ -585,7 +981,7 @@ std::vector<PageExtractor::HoughLine> PageExtractor::houghTransform(cv::Mat bwIm
 
 	int numAngle = cvRound(CV_PI / theta) + 2;
 	int numRho = (width + height) * 2 + 2; // always even
-	cv::Mat accum = cv::Mat::zeros(numRho, numAngle, CV_16U);
+	cv::Mat accum;
 	std::vector<double> tabSin(numAngle - 2);
 	std::vector<double> tabCos(numAngle - 2);
 	
@@ -595,17 +991,26 @@ std::vector<PageExtractor::HoughLine> PageExtractor::houghTransform(cv::Mat bwIm
 		tabCos[n] = cos(static_cast<double>(angle));
 	}
 	
-	// fill the accumulator
+	// gather the edge pixels into a compact array (structure of arrays for SIMD)
+	std::vector<double> xs, ys;
+	xs.reserve(cv::countNonZero(bwImg));
+	ys.reserve(xs.capacity());
+
 	for (int i = 0; i < height; i++) {
+		const unsigned char* ptr = bwImg.ptr<unsigned char>(i);
+
 		for (int j = 0; j < width; j++) {
-			if (bwImg.at<unsigned char>(i, j) != 0) {
-				for (int n = 0; n < numAngle - 2; n++) {
-					int r = cvRound((j * tabCos[n] + i * tabSin[n]) / rho) + numRho / 2;
-					accum.at<std::uint16_t>(r + 1, n + 1)++;
-				}
+			if (ptr[j] != 0) {
+				xs.push_back(j);
+				ys.push_back(i);
 			}
 		}
 	}
+
+	// fill the accumulator - every thread owns a range of angles
+	cv::Mat accumT = cv::Mat::zeros(numAngle, numRho, CV_16U);
+	cv::parallel_for_(cv::Range(0, numAngle - 2), DkHoughAccumulator(accumT, xs, ys, tabCos, tabSin, rho, numRho / 2));
+	cv::transpose(accumT, accum);
 	
 	// find local maxima
 	for (int r = 1; r < numRho - 1; r++) {
@@ -801,59 +1206,17 @@ cv::Mat PageExtractor::removeText(cv::Mat gray, float sigma, int selemSize, int
 		return gray;
 	}
 	
-	static const float eps = 0.001f;
 	cv::Mat bw;
-	cv::Mat sobel_h;
-	cv::Mat sobel_v;
-	cv::Mat sobel_angle = cv::Mat::zeros(gray.size(), CV_32F);
 	cv::GaussianBlur(gray, gray, cv::Size((int)(2 * floor(sigma * 3) + 1), (int)(2 * floor(sigma * 3) + 1)), sigma);
 	cv::Canny(gray, bw, 0.1 * 255, 0.2 * 255);
-	cv::Sobel(gray, sobel_h, CV_32F, 0, 1, 3);
-	cv::Sobel(gray, sobel_v, CV_32F, 1, 0, 3);
 	
-	for (int i = 0; i < sobel_angle.rows; i++) {
-		for (int j = 0; j < sobel_angle.cols; j++) {
-			// calculate gradient angle
-			float angle = (atan2(sobel_v.at<float>(i, j), sobel_h.at<float>(i, j)));
-			// shift [-pi, 0] to [pi, 2pi]
-			if (angle < 0.0f) {
-				angle += (float)(2.0f * CV_PI);
-			}
-			// set 2pi to 0
-			if (angle >= 2 * CV_PI) {
-				angle = 0.0f;
-			}
-			sobel_angle.at<float>(i, j) = angle;
-		}
-	}
-	
-	// edge plane decomposition
-	
-	std::vector<cv::Mat> E_i(8);
-	std::vector<cv::Mat> E_i_ex(8);
-	cv::Mat H = cv::Mat::zeros(gray.size(), CV_8U);
-	cv::Mat mask;
-	cv::Mat mask_factor = (cv::abs(sobel_h) > eps | cv::abs(sobel_v) > eps);
-	cv::Mat M_text_inv;
-	float rangeStart;
-	float rangeEnd;
-	// go through angles in pi/4 steps
-	for (int i = 0; i < 8; i++) {
-		rangeStart = (float)(CV_PI / 4.0f * i);
-		rangeEnd = (float)(CV_PI / 4.0f * (i + 1));
-		mask = ((sobel_angle >= rangeStart) & (sobel_angle < rangeEnd)) & mask_factor;
-		E_i[i] = mask & bw;
-		cv::dilate(E_i[i], E_i_ex[i], cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2 * selemSize, 2 * selemSize)));
-		cv::threshold(E_i_ex[i], E_i_ex[i], 1, 1, cv::THRESH_TRUNC); // E_i_ex is binary, true pixels are 255, we have to truncate them to 1
-		H += E_i_ex[i];
-	}
-	
-	// remove text regions
-	M_text_inv = H <= threshold;
-	cv::Mat E_i_hat = cv::Mat::zeros(bw.size(), CV_8U);
-	for (int i = 0; i < 8; i++) {
-		E_i_hat = E_i_hat | (E_i[i] & M_text_inv); // equals (E_i[i] AND M_text) XOR E_i[i]
-	}
+	// edge plane decomposition - fused and processed in row tiles
+	cv::Mat selem = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2 * selemSize, 2 * selemSize));
+	cv::Mat E_i_hat(bw.size(), CV_8U);
+
+	const int tileHeight = 64;
+	int numTiles = (gray.rows + tileHeight - 1) / tileHeight;
+	cv::parallel_for_(cv::Range(0, numTiles), DkEdgePlaneDecomposition(gray, bw, selem, threshold, tileHeight, E_i_hat));
 	
 	return E_i_hat;
 }
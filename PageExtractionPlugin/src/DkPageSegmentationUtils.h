@@ -28,6 +28,9 @@
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <QColor>
+#include <QImage>
 #include <QString>
 #pragma warning(pop)		// no warnings from includes - end
 
@@ -454,12 +457,48 @@ protected:
 	void computeMaxCosine();
 };
 
+/**
+* Crops rotating rects from images without rendering the whole source.
+* Axis-aligned rects are copied row by row, rotated rects are warped
+* (destination pixels only) in the source's pixel format.
+**/
+class DkRectCropper {
+
+public:
+	static QImage crop(const QImage& img, const nmc::DkRotatingRect& rect, const QColor& bgCol = QColor(0,0,0), int interpolation = cv::INTER_LINEAR);
+
+protected:
+	static bool isSupported(QImage::Format format);
+	static int cvType(QImage::Format format);
+	static cv::Scalar bgValue(const QImage& img, const QColor& bgCol);
+	static QImage copyRows(const QImage& img, const QSize& size, const QPoint& offset, const QColor& bgCol);
+	static QImage warp(const QImage& img, const QSize& size, const QTransform& tForm, const QColor& bgCol, int interpolation);
+};
+
+/**
+* Timings of the page segmentation stages in ms.
+* Stages which run in parallel tasks are summed over all tasks.
+**/
+class DkPageSegmentationStats {
+
+public:
+	double resize = 0;		// resizing & color conversion
+	double edges = 0;		// Canny & thresholds
+	double contours = 0;	// contours & polygon approximation (hough & line segments for the alternative method)
+	double filter = 0;		// duplicate filtering
+	double refine = 0;		// corner refinement (pyramid mode)
+	double crop = 0;		// cropping
+
+	DkPageSegmentationStats& operator+=(const DkPageSegmentationStats& o);
+	double total() const;
+};
+
 class PageExtractor {
 	
 public:
 	PageExtractor() {}
 	
-	void findPage(cv::Mat img, float scale, std::vector<DkPolyRect>& rects);
+	void findPage(cv::Mat img, float scale, std::vector<DkPolyRect>& rects, DkPageSegmentationStats* stats = 0);
 	
 protected:
 	const int maxLinesHough = 30;